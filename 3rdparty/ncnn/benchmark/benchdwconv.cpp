@@ -0,0 +1,177 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2026 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// time the 5x5 depthwise convolutions of the ppocr mobilenetv3 detector backbone
+// fp32 and int8, pack1 and packed layout
+// usage: benchdwconv [loop count] [num threads]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "benchmark.h"
+#include "cpu.h"
+#include "layer.h"
+#include "mat.h"
+#include "modelbin.h"
+#include "paramdict.h"
+
+static int g_loop_count = 50;
+
+struct DetectorDwShape
+{
+    int w;
+    int h;
+    int c;
+    int stride;
+    int activation_type;
+};
+
+// input shapes at a 960x544 detection input
+static const DetectorDwShape g_shapes[] = {
+    {240, 136, 40, 2, 1},
+    {120, 68, 64, 1, 1},
+    {60, 34, 336, 2, 0},
+    {30, 17, 480, 1, 0},
+};
+
+static ncnn::Mat random_mat(int w, int h, int c)
+{
+    ncnn::Mat m(w, h, c);
+    for (int q = 0; q < c; q++)
+    {
+        float* ptr = m.channel(q);
+        for (int i = 0; i < w * h; i++)
+        {
+            ptr[i] = ((q * 131 + i * 17) % 255) / 127.f - 1.f;
+        }
+    }
+    return m;
+}
+
+// the elempack the x86 and arm layers expect for packed fp32 input
+static int packed_elempack(int c)
+{
+#if NCNN_AVX512
+    if (c % 16 == 0 && ncnn::cpu_support_x86_avx512())
+        return 16;
+#endif
+#if NCNN_AVX
+    if (c % 8 == 0 && ncnn::cpu_support_x86_avx())
+        return 8;
+#endif
+    return c % 4 == 0 ? 4 : 1;
+}
+
+static double bench_dw(const DetectorDwShape& s, bool int8, bool packing, int num_threads)
+{
+    ncnn::Option opt;
+    opt.num_threads = num_threads;
+    opt.use_packing_layout = packing;
+    opt.use_int8_inference = int8;
+    opt.use_bf16_storage = false;
+    opt.use_fp16_storage = false;
+    opt.use_fp16_arithmetic = false;
+
+    ncnn::Layer* op = ncnn::create_layer("ConvolutionDepthWise");
+
+    const int weight_size = s.c * 25;
+
+    ncnn::ParamDict pd;
+    pd.set(0, s.c);               // num_output
+    pd.set(1, 5);                 // kernel_w
+    pd.set(3, s.stride);          // stride_w
+    pd.set(4, 2);                 // pad_w
+    pd.set(5, 1);                 // bias_term
+    pd.set(6, weight_size);       // weight_data_size
+    pd.set(7, s.c);               // group
+    pd.set(8, int8 ? 1 : 0);      // int8_scale_term
+    pd.set(9, s.activation_type); // activation_type
+    op->load_param(pd);
+
+    ncnn::Mat weights[4];
+    weights[0] = random_mat(weight_size, 1, 1).reshape(weight_size);
+    weights[1] = random_mat(s.c, 1, 1).reshape(s.c);
+    weights[2] = ncnn::Mat(s.c);
+    weights[2].fill(127.f);
+    weights[3] = ncnn::Mat(1);
+    weights[3].fill(127.f);
+    op->load_model(ncnn::ModelBinFromMatArray(weights));
+
+    op->create_pipeline(opt);
+
+    ncnn::Mat in = random_mat(s.w, s.h, s.c);
+    if (packing && op->support_packing)
+    {
+        ncnn::Mat in_packed;
+        ncnn::convert_packing(in, in_packed, packed_elempack(s.c), opt);
+        in = in_packed;
+    }
+
+    ncnn::Mat out;
+    op->forward(in, out, opt); // warmup
+
+    double start = ncnn::get_current_time();
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        op->forward(in, out, opt);
+    }
+    double time = (ncnn::get_current_time() - start) / g_loop_count;
+
+    op->destroy_pipeline(opt);
+    delete op;
+
+    return time;
+}
+
+int main(int argc, char** argv)
+{
+    int num_threads = 1;
+    if (argc > 1)
+    {
+        g_loop_count = atoi(argv[1]);
+        if (g_loop_count <= 0)
+            g_loop_count = 1;
+    }
+    if (argc > 2)
+    {
+        num_threads = atoi(argv[2]);
+        if (num_threads <= 0)
+            num_threads = 1;
+    }
+
+    fprintf(stderr, "loop_count = %d  num_threads = %d\n", g_loop_count, num_threads);
+    fprintf(stderr, "%-22s %12s %12s %12s %12s\n", "shape", "fp32 pack1", "fp32 packed", "int8 pack1", "int8 packed");
+
+    for (size_t i = 0; i < sizeof(g_shapes) / sizeof(g_shapes[0]); i++)
+    {
+        const DetectorDwShape& s = g_shapes[i];
+
+        char name[64];
+        sprintf(name, "%dx%dx%d s%d", s.w, s.h, s.c, s.stride);
+
+        double fp32_pack1 = bench_dw(s, false, false, num_threads);
+        double fp32_packed = bench_dw(s, false, true, num_threads);
+#if NCNN_INT8
+        double int8_pack1 = bench_dw(s, true, false, num_threads);
+        double int8_packed = bench_dw(s, true, true, num_threads);
+#else
+        double int8_pack1 = 0;
+        double int8_packed = 0;
+#endif
+
+        fprintf(stderr, "%-22s %9.3f ms %9.3f ms %9.3f ms %9.3f ms\n", name, fp32_pack1, fp32_packed, int8_pack1, int8_packed);
+    }
+
+    return 0;
+}
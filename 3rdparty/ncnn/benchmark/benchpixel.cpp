@@ -0,0 +1,119 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2026 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// compare the pixel conversion, resize and warpaffine routines at every simd level against the scalar path
+// usage: benchpixel [loop count]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "benchmark.h"
+#include "mat.h"
+
+static int g_loop_count = 50;
+
+static const char* level_name(int level)
+{
+    return level == 2 ? "avx2" : level == 1 ? "sse2" : "scalar";
+}
+
+template<typename Func>
+static double bench(Func func)
+{
+    func(); // warmup
+
+    double start = ncnn::get_current_time();
+    for (int i = 0; i < g_loop_count; i++)
+    {
+        func();
+    }
+    return (ncnn::get_current_time() - start) / g_loop_count;
+}
+
+template<typename Func>
+static void bench_levels(const char* name, Func func)
+{
+    const int max_level = ncnn::get_pixel_simd_level();
+
+    double scalar = 0;
+    for (int level = 0; level <= max_level; level++)
+    {
+        ncnn::set_pixel_simd_level(level);
+        double time = bench(func);
+        if (level == 0)
+            scalar = time;
+
+        fprintf(stderr, "%-40s %6s  %8.3f ms  x%.2f\n", name, level_name(level), time, scalar / time);
+    }
+
+    ncnn::set_pixel_simd_level(-1);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+    {
+        g_loop_count = atoi(argv[1]);
+        if (g_loop_count <= 0)
+            g_loop_count = 1;
+    }
+
+    std::vector<unsigned char> image(1920 * 1080 * 3);
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        image[i] = (unsigned char)(i * 7 + i / 1920);
+    }
+    std::vector<unsigned char> dst(1920 * 1080 * 3);
+
+    fprintf(stderr, "loop_count = %d\n", g_loop_count);
+
+    // detection input and recognition input
+    bench_levels("from_pixels rgb 960x544", [&]() {
+        ncnn::Mat m = ncnn::Mat::from_pixels(image.data(), ncnn::Mat::PIXEL_RGB, 960, 544);
+    });
+    bench_levels("from_pixels rgb 320x48", [&]() {
+        ncnn::Mat m = ncnn::Mat::from_pixels(image.data(), ncnn::Mat::PIXEL_RGB, 320, 48);
+    });
+    bench_levels("from_pixels rgb2bgr 960x544", [&]() {
+        ncnn::Mat m = ncnn::Mat::from_pixels(image.data(), ncnn::Mat::PIXEL_RGB2BGR, 960, 544);
+    });
+    bench_levels("from_pixels gray 1920x1080", [&]() {
+        ncnn::Mat m = ncnn::Mat::from_pixels(image.data(), ncnn::Mat::PIXEL_GRAY, 1920, 1080);
+    });
+
+    bench_levels("resize_bilinear_c3 1920x1080>960x544", [&]() {
+        ncnn::resize_bilinear_c3(image.data(), 1920, 1080, dst.data(), 960, 544);
+    });
+    bench_levels("resize_bilinear_c3 200x32>320x48", [&]() {
+        ncnn::resize_bilinear_c3(image.data(), 200, 32, dst.data(), 320, 48);
+    });
+    bench_levels("resize_bilinear_c1 1920x1080>960x544", [&]() {
+        ncnn::resize_bilinear_c1(image.data(), 1920, 1080, dst.data(), 960, 544);
+    });
+
+    // text line crop with a slight rotation
+    float tm[6];
+    ncnn::get_rotation_matrix(3.f, 1.f, 960, 540, tm);
+    bench_levels("warpaffine_bilinear_c3 1920x1080", [&]() {
+        ncnn::warpaffine_bilinear_c3(image.data(), 1920, 1080, dst.data(), 1920, 1080, tm, 0);
+    });
+    ncnn::get_rotation_matrix(-5.f, 0.2f, 960, 540, tm);
+    bench_levels("warpaffine_bilinear_c3 320x48", [&]() {
+        ncnn::warpaffine_bilinear_c3(image.data(), 1920, 1080, dst.data(), 320, 48, tm, 0);
+    });
+
+    return 0;
+}
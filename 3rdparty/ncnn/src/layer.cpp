@@ -54,6 +54,8 @@ Layer::Layer()
 
     typeindex = -1;
 
+    featmask = 0;
+
 #if NCNN_VULKAN
     vkdev = 0;
 #endif // NCNN_VULKAN
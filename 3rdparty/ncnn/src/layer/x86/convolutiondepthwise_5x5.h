@@ -0,0 +1,213 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2024 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if __SSE2__
+static NCNN_FORCEINLINE __m128 convdw5x5s1_row_sse(__m128 _sum, const float* r, const float* k)
+{
+    _sum = _mm_comp_fmadd_ps(_mm_loadu_ps(r), _mm_set1_ps(k[0]), _sum);
+    _sum = _mm_comp_fmadd_ps(_mm_loadu_ps(r + 1), _mm_set1_ps(k[1]), _sum);
+    _sum = _mm_comp_fmadd_ps(_mm_loadu_ps(r + 2), _mm_set1_ps(k[2]), _sum);
+    _sum = _mm_comp_fmadd_ps(_mm_loadu_ps(r + 3), _mm_set1_ps(k[3]), _sum);
+    _sum = _mm_comp_fmadd_ps(_mm_loadu_ps(r + 4), _mm_set1_ps(k[4]), _sum);
+    return _sum;
+}
+
+// reads r[0..11], produces 4 outputs from columns 0 2 4 6 .. 10
+static NCNN_FORCEINLINE __m128 convdw5x5s2_row_sse(__m128 _sum, const float* r, const float* k)
+{
+    __m128 _r0 = _mm_loadu_ps(r);
+    __m128 _r2 = _mm_loadu_ps(r + 2);
+    __m128 _r4 = _mm_loadu_ps(r + 4);
+    __m128 _r6 = _mm_loadu_ps(r + 6);
+    __m128 _r8 = _mm_loadu_ps(r + 8);
+
+    __m128 _c0 = _mm_shuffle_ps(_r0, _r4, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 _c1 = _mm_shuffle_ps(_r0, _r4, _MM_SHUFFLE(3, 1, 3, 1));
+    __m128 _c2 = _mm_shuffle_ps(_r2, _r6, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 _c3 = _mm_shuffle_ps(_r2, _r6, _MM_SHUFFLE(3, 1, 3, 1));
+    __m128 _c4 = _mm_shuffle_ps(_r4, _r8, _MM_SHUFFLE(2, 0, 2, 0));
+
+    _sum = _mm_comp_fmadd_ps(_c0, _mm_set1_ps(k[0]), _sum);
+    _sum = _mm_comp_fmadd_ps(_c1, _mm_set1_ps(k[1]), _sum);
+    _sum = _mm_comp_fmadd_ps(_c2, _mm_set1_ps(k[2]), _sum);
+    _sum = _mm_comp_fmadd_ps(_c3, _mm_set1_ps(k[3]), _sum);
+    _sum = _mm_comp_fmadd_ps(_c4, _mm_set1_ps(k[4]), _sum);
+    return _sum;
+}
+#endif // __SSE2__
+
+#if __AVX__
+static NCNN_FORCEINLINE __m256 convdw5x5s1_row_avx(__m256 _sum, const float* r, const float* k)
+{
+    _sum = _mm256_comp_fmadd_ps(_mm256_loadu_ps(r), _mm256_set1_ps(k[0]), _sum);
+    _sum = _mm256_comp_fmadd_ps(_mm256_loadu_ps(r + 1), _mm256_set1_ps(k[1]), _sum);
+    _sum = _mm256_comp_fmadd_ps(_mm256_loadu_ps(r + 2), _mm256_set1_ps(k[2]), _sum);
+    _sum = _mm256_comp_fmadd_ps(_mm256_loadu_ps(r + 3), _mm256_set1_ps(k[3]), _sum);
+    _sum = _mm256_comp_fmadd_ps(_mm256_loadu_ps(r + 4), _mm256_set1_ps(k[4]), _sum);
+    return _sum;
+}
+#endif // __AVX__
+
+static void convdw5x5s1_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, const Option& opt)
+{
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+
+    const int group = bottom_blob.c;
+
+    const float* kernel = _kernel;
+    const float* bias = _bias;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int g = 0; g < group; g++)
+    {
+        Mat out = top_blob.channel(g);
+
+        const float bias0 = bias ? bias[g] : 0.f;
+
+        const float* k0 = kernel + g * 25;
+
+        const Mat img0 = bottom_blob.channel(g);
+
+        for (int i = 0; i < outh; i++)
+        {
+            const float* r0 = img0.row(i);
+            const float* r1 = img0.row(i + 1);
+            const float* r2 = img0.row(i + 2);
+            const float* r3 = img0.row(i + 3);
+            const float* r4 = img0.row(i + 4);
+
+            float* outptr = out.row(i);
+
+            int j = 0;
+#if __SSE2__
+#if __AVX__
+            for (; j + 7 < outw; j += 8)
+            {
+                __m256 _sum = _mm256_set1_ps(bias0);
+
+                _sum = convdw5x5s1_row_avx(_sum, r0 + j, k0);
+                _sum = convdw5x5s1_row_avx(_sum, r1 + j, k0 + 5);
+                _sum = convdw5x5s1_row_avx(_sum, r2 + j, k0 + 10);
+                _sum = convdw5x5s1_row_avx(_sum, r3 + j, k0 + 15);
+                _sum = convdw5x5s1_row_avx(_sum, r4 + j, k0 + 20);
+
+                _mm256_storeu_ps(outptr + j, _sum);
+            }
+#endif // __AVX__
+            for (; j + 3 < outw; j += 4)
+            {
+                __m128 _sum = _mm_set1_ps(bias0);
+
+                _sum = convdw5x5s1_row_sse(_sum, r0 + j, k0);
+                _sum = convdw5x5s1_row_sse(_sum, r1 + j, k0 + 5);
+                _sum = convdw5x5s1_row_sse(_sum, r2 + j, k0 + 10);
+                _sum = convdw5x5s1_row_sse(_sum, r3 + j, k0 + 15);
+                _sum = convdw5x5s1_row_sse(_sum, r4 + j, k0 + 20);
+
+                _mm_storeu_ps(outptr + j, _sum);
+            }
+#endif // __SSE2__
+            for (; j < outw; j++)
+            {
+                float sum = bias0;
+
+                const float* rows[5] = {r0 + j, r1 + j, r2 + j, r3 + j, r4 + j};
+                for (int y = 0; y < 5; y++)
+                {
+                    const float* r = rows[y];
+                    const float* k = k0 + y * 5;
+                    sum += r[0] * k[0];
+                    sum += r[1] * k[1];
+                    sum += r[2] * k[2];
+                    sum += r[3] * k[3];
+                    sum += r[4] * k[4];
+                }
+
+                outptr[j] = sum;
+            }
+        }
+    }
+}
+
+static void convdw5x5s2_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Mat& _bias, const Option& opt)
+{
+    int w = bottom_blob.w;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+
+    const int group = bottom_blob.c;
+
+    const float* kernel = _kernel;
+    const float* bias = _bias;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int g = 0; g < group; g++)
+    {
+        Mat out = top_blob.channel(g);
+
+        const float bias0 = bias ? bias[g] : 0.f;
+
+        const float* k0 = kernel + g * 25;
+
+        const Mat img0 = bottom_blob.channel(g);
+
+        for (int i = 0; i < outh; i++)
+        {
+            const float* r0 = img0.row(i * 2);
+            const float* r1 = img0.row(i * 2 + 1);
+            const float* r2 = img0.row(i * 2 + 2);
+            const float* r3 = img0.row(i * 2 + 3);
+            const float* r4 = img0.row(i * 2 + 4);
+
+            float* outptr = out.row(i);
+
+            int j = 0;
+#if __SSE2__
+            // 4 outputs read 12 columns, keep the loads inside the row
+            for (; j + 3 < outw && j * 2 + 11 < w; j += 4)
+            {
+                __m128 _sum = _mm_set1_ps(bias0);
+
+                _sum = convdw5x5s2_row_sse(_sum, r0 + j * 2, k0);
+                _sum = convdw5x5s2_row_sse(_sum, r1 + j * 2, k0 + 5);
+                _sum = convdw5x5s2_row_sse(_sum, r2 + j * 2, k0 + 10);
+                _sum = convdw5x5s2_row_sse(_sum, r3 + j * 2, k0 + 15);
+                _sum = convdw5x5s2_row_sse(_sum, r4 + j * 2, k0 + 20);
+
+                _mm_storeu_ps(outptr + j, _sum);
+            }
+#endif // __SSE2__
+            for (; j < outw; j++)
+            {
+                float sum = bias0;
+
+                const float* rows[5] = {r0 + j * 2, r1 + j * 2, r2 + j * 2, r3 + j * 2, r4 + j * 2};
+                for (int y = 0; y < 5; y++)
+                {
+                    const float* r = rows[y];
+                    const float* k = k0 + y * 5;
+                    sum += r[0] * k[0];
+                    sum += r[1] * k[1];
+                    sum += r[2] * k[2];
+                    sum += r[3] * k[3];
+                    sum += r[4] * k[4];
+                }
+
+                outptr[j] = sum;
+            }
+        }
+    }
+}
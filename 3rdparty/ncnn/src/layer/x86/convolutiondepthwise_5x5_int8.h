@@ -0,0 +1,243 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2024 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#if NCNN_RUNTIME_CPU && NCNN_AVX2 && __AVX__ && !__AVX2__
+void convdw5x5s1_int8_sse_avx2(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel, const Option& opt);
+void convdw5x5s2_int8_sse_avx2(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel, const Option& opt);
+#endif
+
+#if __SSE2__
+static NCNN_FORCEINLINE __m128i convdw5x5_int8_loadl_epi16(const signed char* r)
+{
+    __m128i _v = _mm_loadl_epi64((const __m128i*)r);
+#if __AVX__
+    return _mm_cvtepi8_epi16(_v);
+#else
+    return _mm_unpacklo_epi8(_v, _mm_cmpgt_epi8(_mm_setzero_si128(), _v));
+#endif
+}
+
+// multiply two adjacent taps at once, (a0 b0 a1 b1 ..) x (k0 k1 k0 k1 ..)
+static NCNN_FORCEINLINE void convdw5x5_int8_madd2(__m128i& _sum0, __m128i& _sum1, __m128i _a, __m128i _b, __m128i _k01)
+{
+    _sum0 = _mm_add_epi32(_sum0, _mm_madd_epi16(_mm_unpacklo_epi16(_a, _b), _k01));
+    _sum1 = _mm_add_epi32(_sum1, _mm_madd_epi16(_mm_unpackhi_epi16(_a, _b), _k01));
+}
+
+static NCNN_FORCEINLINE __m128i convdw5x5_int8_kpair(const signed char* k, int k0, int k1)
+{
+    return _mm_set1_epi32(((int)k[k1] << 16) | ((int)k[k0] & 0xffff));
+}
+#endif // __SSE2__
+
+#if __AVX2__
+static NCNN_FORCEINLINE void convdw5x5s1_int8_row_avx2(__m256i& _sum0, __m256i& _sum1, const signed char* r, const signed char* k)
+{
+    __m256i _r0 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)r));
+    __m256i _r1 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(r + 1)));
+    __m256i _r2 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(r + 2)));
+    __m256i _r3 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(r + 3)));
+    __m256i _r4 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(r + 4)));
+
+    __m256i _k01 = _mm256_set1_epi32(((int)k[1] << 16) | ((int)k[0] & 0xffff));
+    __m256i _k23 = _mm256_set1_epi32(((int)k[3] << 16) | ((int)k[2] & 0xffff));
+    __m256i _k4 = _mm256_set1_epi32((int)k[4] & 0xffff);
+    __m256i _zero = _mm256_setzero_si256();
+
+    // in-lane unpack, sum0 holds outputs 0-3 8-11 and sum1 holds 4-7 12-15
+    _sum0 = _mm256_add_epi32(_sum0, _mm256_madd_epi16(_mm256_unpacklo_epi16(_r0, _r1), _k01));
+    _sum1 = _mm256_add_epi32(_sum1, _mm256_madd_epi16(_mm256_unpackhi_epi16(_r0, _r1), _k01));
+    _sum0 = _mm256_add_epi32(_sum0, _mm256_madd_epi16(_mm256_unpacklo_epi16(_r2, _r3), _k23));
+    _sum1 = _mm256_add_epi32(_sum1, _mm256_madd_epi16(_mm256_unpackhi_epi16(_r2, _r3), _k23));
+    _sum0 = _mm256_add_epi32(_sum0, _mm256_madd_epi16(_mm256_unpacklo_epi16(_r4, _zero), _k4));
+    _sum1 = _mm256_add_epi32(_sum1, _mm256_madd_epi16(_mm256_unpackhi_epi16(_r4, _zero), _k4));
+}
+#endif // __AVX2__
+
+static void convdw5x5s1_int8_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Option& opt)
+{
+#if NCNN_RUNTIME_CPU && NCNN_AVX2 && __AVX__ && !__AVX2__
+    if (ncnn::cpu_support_x86_avx2())
+    {
+        convdw5x5s1_int8_sse_avx2(bottom_blob, top_blob, _kernel, opt);
+        return;
+    }
+#endif
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    const signed char* kernel = _kernel;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = 0; p < outch; p++)
+    {
+        Mat out = top_blob.channel(p);
+
+        const signed char* kernel0 = kernel + p * 25;
+
+        const Mat img0 = bottom_blob.channel(p);
+
+        for (int i = 0; i < outh; i++)
+        {
+            int* outptr = out.row<int>(i);
+
+            int j = 0;
+#if __SSE2__
+#if __AVX2__
+            for (; j + 15 < outw; j += 16)
+            {
+                __m256i _sum0 = _mm256_setzero_si256();
+                __m256i _sum1 = _mm256_setzero_si256();
+
+                for (int y = 0; y < 5; y++)
+                {
+                    convdw5x5s1_int8_row_avx2(_sum0, _sum1, img0.row<const signed char>(i + y) + j, kernel0 + y * 5);
+                }
+
+                _mm256_storeu_si256((__m256i*)(outptr + j), _mm256_permute2x128_si256(_sum0, _sum1, _MM_SHUFFLE(0, 2, 0, 0)));
+                _mm256_storeu_si256((__m256i*)(outptr + j + 8), _mm256_permute2x128_si256(_sum0, _sum1, _MM_SHUFFLE(0, 3, 0, 1)));
+            }
+#endif // __AVX2__
+            for (; j + 7 < outw; j += 8)
+            {
+                __m128i _sum0 = _mm_setzero_si128();
+                __m128i _sum1 = _mm_setzero_si128();
+
+                for (int y = 0; y < 5; y++)
+                {
+                    const signed char* r = img0.row<const signed char>(i + y) + j;
+                    const signed char* k = kernel0 + y * 5;
+
+                    __m128i _r0 = convdw5x5_int8_loadl_epi16(r);
+                    __m128i _r1 = convdw5x5_int8_loadl_epi16(r + 1);
+                    __m128i _r2 = convdw5x5_int8_loadl_epi16(r + 2);
+                    __m128i _r3 = convdw5x5_int8_loadl_epi16(r + 3);
+                    __m128i _r4 = convdw5x5_int8_loadl_epi16(r + 4);
+
+                    convdw5x5_int8_madd2(_sum0, _sum1, _r0, _r1, convdw5x5_int8_kpair(k, 0, 1));
+                    convdw5x5_int8_madd2(_sum0, _sum1, _r2, _r3, convdw5x5_int8_kpair(k, 2, 3));
+                    convdw5x5_int8_madd2(_sum0, _sum1, _r4, _mm_setzero_si128(), _mm_set1_epi32((int)k[4] & 0xffff));
+                }
+
+                _mm_storeu_si128((__m128i*)(outptr + j), _sum0);
+                _mm_storeu_si128((__m128i*)(outptr + j + 4), _sum1);
+            }
+#endif // __SSE2__
+            for (; j < outw; j++)
+            {
+                int sum = 0;
+
+                for (int y = 0; y < 5; y++)
+                {
+                    const signed char* r = img0.row<const signed char>(i + y) + j;
+                    const signed char* k = kernel0 + y * 5;
+                    sum += (int)r[0] * (int)k[0];
+                    sum += (int)r[1] * (int)k[1];
+                    sum += (int)r[2] * (int)k[2];
+                    sum += (int)r[3] * (int)k[3];
+                    sum += (int)r[4] * (int)k[4];
+                }
+
+                outptr[j] = sum;
+            }
+        }
+    }
+}
+
+static void convdw5x5s2_int8_sse(const Mat& bottom_blob, Mat& top_blob, const Mat& _kernel, const Option& opt)
+{
+#if NCNN_RUNTIME_CPU && NCNN_AVX2 && __AVX__ && !__AVX2__
+    if (ncnn::cpu_support_x86_avx2())
+    {
+        convdw5x5s2_int8_sse_avx2(bottom_blob, top_blob, _kernel, opt);
+        return;
+    }
+#endif
+
+    int w = bottom_blob.w;
+
+    int outw = top_blob.w;
+    int outh = top_blob.h;
+    int outch = top_blob.c;
+
+    const signed char* kernel = _kernel;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = 0; p < outch; p++)
+    {
+        Mat out = top_blob.channel(p);
+
+        const signed char* kernel0 = kernel + p * 25;
+
+        const Mat img0 = bottom_blob.channel(p);
+
+        for (int i = 0; i < outh; i++)
+        {
+            int* outptr = out.row<int>(i);
+
+            int j = 0;
+#if __SSE2__
+            // 8 outputs read 20 columns, keep the loads inside the row
+            for (; j + 7 < outw && j * 2 + 19 < w; j += 8)
+            {
+                __m128i _sum0 = _mm_setzero_si128();
+                __m128i _sum1 = _mm_setzero_si128();
+
+                for (int y = 0; y < 5; y++)
+                {
+                    const signed char* r = img0.row<const signed char>(i * 2 + y) + j * 2;
+                    const signed char* k = kernel0 + y * 5;
+
+                    __m128i _v0 = _mm_loadu_si128((const __m128i*)r);
+                    __m128i _v2 = _mm_loadu_si128((const __m128i*)(r + 2));
+                    __m128i _v4 = _mm_loadu_si128((const __m128i*)(r + 4));
+
+                    // even bytes are the low halves of each 16bit lane, odd bytes the high halves
+                    __m128i _r0 = _mm_srai_epi16(_mm_slli_epi16(_v0, 8), 8);
+                    __m128i _r1 = _mm_srai_epi16(_v0, 8);
+                    __m128i _r2 = _mm_srai_epi16(_mm_slli_epi16(_v2, 8), 8);
+                    __m128i _r3 = _mm_srai_epi16(_v2, 8);
+                    __m128i _r4 = _mm_srai_epi16(_mm_slli_epi16(_v4, 8), 8);
+
+                    convdw5x5_int8_madd2(_sum0, _sum1, _r0, _r1, convdw5x5_int8_kpair(k, 0, 1));
+                    convdw5x5_int8_madd2(_sum0, _sum1, _r2, _r3, convdw5x5_int8_kpair(k, 2, 3));
+                    convdw5x5_int8_madd2(_sum0, _sum1, _r4, _mm_setzero_si128(), _mm_set1_epi32((int)k[4] & 0xffff));
+                }
+
+                _mm_storeu_si128((__m128i*)(outptr + j), _sum0);
+                _mm_storeu_si128((__m128i*)(outptr + j + 4), _sum1);
+            }
+#endif // __SSE2__
+            for (; j < outw; j++)
+            {
+                int sum = 0;
+
+                for (int y = 0; y < 5; y++)
+                {
+                    const signed char* r = img0.row<const signed char>(i * 2 + y) + j * 2;
+                    const signed char* k = kernel0 + y * 5;
+                    sum += (int)r[0] * (int)k[0];
+                    sum += (int)r[1] * (int)k[1];
+                    sum += (int)r[2] * (int)k[2];
+                    sum += (int)r[3] * (int)k[3];
+                    sum += (int)r[4] * (int)k[4];
+                }
+
+                outptr[j] = sum;
+            }
+        }
+    }
+}
@@ -24,6 +24,7 @@
 #include "x86_activation.h"
 #include "x86_usability.h"
 
+#include "cpu.h"
 #include "layer_type.h"
 
 namespace ncnn {
@@ -41,9 +42,11 @@ namespace ncnn {
 #endif // __AVX__
 #endif // __SSE2__
 #include "convolutiondepthwise_3x3.h"
+#include "convolutiondepthwise_5x5.h"
 
 #if NCNN_INT8
 #include "convolutiondepthwise_3x3_int8.h"
+#include "convolutiondepthwise_5x5_int8.h"
 #endif // NCNN_INT8
 
 ConvolutionDepthWise_x86::ConvolutionDepthWise_x86()
@@ -132,6 +135,14 @@ int ConvolutionDepthWise_x86::create_pipeline(const Option& opt)
             {
                 return 0;
             }
+            if (kernel_w == 5 && kernel_h == 5 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+            {
+                return 0;
+            }
+            if (kernel_w == 5 && kernel_h == 5 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+            {
+                return 0;
+            }
         }
     }
 
@@ -665,6 +676,28 @@ int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, con
                     activation->forward_inplace(top_blob, opt);
                 }
 
+                return 0;
+            }
+            if (kernel_w == 5 && kernel_h == 5 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
+            {
+                convdw5x5s1_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, opt);
+
+                if (activation)
+                {
+                    activation->forward_inplace(top_blob, opt);
+                }
+
+                return 0;
+            }
+            if (kernel_w == 5 && kernel_h == 5 && dilation_w == 1 && dilation_h == 1 && stride_w == 2 && stride_h == 2)
+            {
+                convdw5x5s2_sse(bottom_blob_bordered, top_blob, weight_data, bias_data, opt);
+
+                if (activation)
+                {
+                    activation->forward_inplace(top_blob, opt);
+                }
+
                 return 0;
             }
         }
@@ -1104,6 +1137,56 @@ int ConvolutionDepthWise_x86::forward_int8_x86(const Mat& bottom_blob, Mat& top_
                     activation->forward_inplace(top_blob, opt);
                 }
             }
+            else if (kernel_w == 5 && kernel_h == 5 && dilation_w == 1 && dilation_h == 1 && ((stride_w == 1 && stride_h == 1) || (stride_w == 2 && stride_h == 2)))
+            {
+                // int32 sums first, then the same scale/bias/activation epilogue as the generic path
+                Mat top_blob_int32(outw, outh, group, (size_t)4u, opt.workspace_allocator);
+                if (top_blob_int32.empty())
+                    return -100;
+
+                if (stride_w == 1)
+                    convdw5x5s1_int8_sse(bottom_blob_bordered, top_blob_int32, weight_data, opt);
+                else
+                    convdw5x5s2_int8_sse(bottom_blob_bordered, top_blob_int32, weight_data, opt);
+
+                const int size = outw * outh;
+
+                #pragma omp parallel for num_threads(opt.num_threads)
+                for (int g = 0; g < group; g++)
+                {
+                    const int* sumptr = top_blob_int32.channel(g);
+                    signed char* outptr_s8 = top_blob.channel(g);
+                    float* outptr_f32 = top_blob.channel(g);
+
+                    float scale_in;
+                    if (weight_data_int8_scales[g] == 0)
+                        scale_in = 0;
+                    else
+                        scale_in = 1.f / (bottom_blob_int8_scales[g] * weight_data_int8_scales[g]);
+
+                    for (int i = 0; i < size; i++)
+                    {
+                        float sumfp32 = sumptr[i] * scale_in;
+
+                        if (bias_term)
+                            sumfp32 += bias_data[g];
+
+                        sumfp32 = activation_ss(sumfp32, activation_type, activation_params);
+
+                        if (use_int8_requantize)
+                        {
+                            // requantize
+                            float scale_out = top_blob_int8_scales[g];
+                            outptr_s8[i] = float2int8(sumfp32 * scale_out);
+                        }
+                        else
+                        {
+                            // dequantize
+                            outptr_f32[i] = sumfp32;
+                        }
+                    }
+                }
+            }
             else
             {
                 const int maxk = kernel_w * kernel_h;
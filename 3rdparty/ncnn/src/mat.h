@@ -631,6 +631,10 @@ NCNN_EXPORT void resize_bilinear_c3(const unsigned char* src, int srcw, int srch
 NCNN_EXPORT void resize_bilinear_c4(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride);
 // image pixel bilinear resize, convenient wrapper for yuv420sp(nv21/nv12)
 NCNN_EXPORT void resize_bilinear_yuv420sp(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h);
+// simd level of the x86 pixel conversion, resize and warpaffine routines, 0 = scalar 1 = sse2 2 = avx2
+NCNN_EXPORT int get_pixel_simd_level();
+// cap the simd level for benchmark and verification, clamped to what the cpu supports, -1 restores the default
+NCNN_EXPORT void set_pixel_simd_level(int level);
 #endif // NCNN_PIXEL
 #if NCNN_PIXEL_ROTATE
 // type is the from type, 6 means rotating from 6 to 1
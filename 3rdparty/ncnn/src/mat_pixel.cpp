@@ -19,11 +19,50 @@
 #if __ARM_NEON
 #include <arm_neon.h>
 #endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX2__
+#include <immintrin.h>
+#endif
+#include <string.h>
+#endif // __SSE2__
+#include "cpu.h"
 #include "platform.h"
 
 namespace ncnn {
 
 #if NCNN_PIXEL
+static int g_pixel_simd_level = -1;
+
+static int pixel_simd_level_supported()
+{
+#if __SSE2__
+#if __AVX2__ || (NCNN_RUNTIME_CPU && NCNN_AVX2)
+    if (cpu_support_x86_avx2())
+        return 2;
+#endif
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int get_pixel_simd_level()
+{
+    if (g_pixel_simd_level < 0)
+        g_pixel_simd_level = pixel_simd_level_supported();
+
+    return g_pixel_simd_level;
+}
+
+void set_pixel_simd_level(int level)
+{
+    const int supported = pixel_simd_level_supported();
+    g_pixel_simd_level = level < 0 || level > supported ? supported : level;
+}
+
+#include "mat_pixel_x86.h"
+
 static int from_rgb(const unsigned char* rgb, int w, int h, int stride, Mat& m, Allocator* allocator)
 {
     m.create(w, h, 3, 4u, allocator);
@@ -46,6 +85,13 @@ static int from_rgb(const unsigned char* rgb, int w, int h, int stride, Mat& m,
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = from_rgb_x86(rgb, w, ptr0, ptr1, ptr2);
+        int remain = w - nn;
+        rgb += nn * 3;
+        ptr0 += nn;
+        ptr1 += nn;
+        ptr2 += nn;
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -228,6 +274,11 @@ static int from_gray(const unsigned char* gray, int w, int h, int stride, Mat& m
 #if __ARM_NEON
         int nn = w >> 4;
         int remain = w - (nn << 4);
+#elif __SSE2__
+        int nn = from_gray_x86(gray, w, ptr);
+        int remain = w - nn;
+        gray += nn;
+        ptr += nn;
 #else
         int remain = w;
 #endif // __ARM_NEON
@@ -583,6 +634,13 @@ static int from_rgb2bgr(const unsigned char* rgb, int w, int h, int stride, Mat&
 #if __ARM_NEON
         int nn = w >> 3;
         int remain = w - (nn << 3);
+#elif __SSE2__
+        int nn = from_rgb_x86(rgb, w, ptr2, ptr1, ptr0);
+        int remain = w - nn;
+        rgb += nn * 3;
+        ptr0 += nn;
+        ptr1 += nn;
+        ptr2 += nn;
 #else
         int remain = w;
 #endif // __ARM_NEON
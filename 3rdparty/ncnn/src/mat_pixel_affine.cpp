@@ -16,6 +16,13 @@
 #if __ARM_NEON
 #include <arm_neon.h>
 #endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX2__
+#include <immintrin.h>
+#endif
+#include <string.h>
+#endif // __SSE2__
 #include <limits.h>
 #include <math.h>
 #include "platform.h"
@@ -23,6 +30,10 @@
 namespace ncnn {
 
 #if NCNN_PIXEL_AFFINE
+#if NCNN_PIXEL
+#include "mat_pixel_x86.h"
+#endif // NCNN_PIXEL
+
 void get_rotation_matrix(float angle, float scale, float dx, float dy, float* tm)
 {
     angle *= (float)(3.14159265358979323846 / 180);
@@ -822,6 +833,10 @@ void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int srch, int sr
         bdelta[x] = SATURATE_CAST_INT(tm[3] * x * (1 << 10));
     }
 
+#if __SSE2__ && NCNN_PIXEL
+    const int simd_level = get_pixel_simd_level();
+#endif
+
     int y = 0;
     for (; y < h; y++)
     {
@@ -978,6 +993,13 @@ void warpaffine_bilinear_c3(const unsigned char* src, int srcw, int srch, int sr
 
                 dst0 += 3 * 8;
 #else
+#if __SSE2__ && NCNN_PIXEL
+                if (simd_level >= 1)
+                {
+                    dst0 += 3 * warpaffine_bilinear_c3_x86(simd_level, src0, srcstride, X0, Y0, adelta.data() + x, bdelta.data() + x, dst0);
+                    continue;
+                }
+#endif
                 for (int xi = 0; xi < 8; xi++)
                 {
                     int X = X0 + adelta[x + xi];
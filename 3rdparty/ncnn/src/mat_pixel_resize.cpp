@@ -19,11 +19,20 @@
 #if __ARM_NEON
 #include <arm_neon.h>
 #endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX2__
+#include <immintrin.h>
+#endif
+#include <string.h>
+#endif // __SSE2__
 #include "platform.h"
 
 namespace ncnn {
 
 #if NCNN_PIXEL
+#include "mat_pixel_x86.h"
+
 void resize_bilinear_c1(const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
 {
     return resize_bilinear_c1(src, srcw, srch, srcw, dst, w, h, w);
@@ -196,6 +205,15 @@ void resize_bilinear_c1(const unsigned char* src, int srcw, int srch, int srcstr
 
 #if __ARM_NEON
         int nn = w >> 3;
+#elif __SSE2__
+        int nn = 0;
+        {
+            int done = vresize_x86(rows0p, rows1p, b0, b1, Dp, w);
+            rows0p += done;
+            rows1p += done;
+            Dp += done;
+            nn = done >> 3; // done is always a multiple of 16
+        }
 #else
         int nn = 0;
 #endif
@@ -505,6 +523,15 @@ void resize_bilinear_c2(const unsigned char* src, int srcw, int srch, int srcstr
 
 #if __ARM_NEON
         int nn = (w * 2) >> 3;
+#elif __SSE2__
+        int nn = 0;
+        {
+            int done = vresize_x86(rows0p, rows1p, b0, b1, Dp, (w * 2));
+            rows0p += done;
+            rows1p += done;
+            Dp += done;
+            nn = done >> 3; // done is always a multiple of 16
+        }
 #else
         int nn = 0;
 #endif
@@ -607,6 +634,18 @@ void resize_bilinear_c2(const unsigned char* src, int srcw, int srch, int srcstr
     delete[] buf;
 }
 
+#if __SSE2__
+// horizontal blend of one rgb pixel pair, writes 4 shorts and the 4th is overwritten by the next pixel
+static inline __m128i hresize_c3_sse2(const unsigned char* Sp, __m128i _a01)
+{
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _S0 = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)load_u32_x86(Sp)), _zero);
+    __m128i _S1 = _mm_unpacklo_epi8(_mm_srli_epi32(_mm_cvtsi32_si128((int)load_u32_x86(Sp + 2)), 8), _zero);
+    __m128i _rows = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(_S0, _S1), _a01), 4);
+    return _mm_packs_epi32(_rows, _rows);
+}
+#endif // __SSE2__
+
 void resize_bilinear_c3(const unsigned char* src, int srcw, int srch, int srcstride, unsigned char* dst, int w, int h, int stride)
 {
     const int INTER_RESIZE_COEF_BITS = 11;
@@ -691,6 +730,10 @@ void resize_bilinear_c3(const unsigned char* src, int srcw, int srch, int srcstr
     short* rows0 = (short*)rowsbuf0.data;
     short* rows1 = (short*)rowsbuf1.data;
 
+#if __SSE2__
+    const int simd_level = get_pixel_simd_level();
+#endif
+
     int prev_sy1 = -2;
 
     for (int dy = 0; dy < h; dy++)
@@ -737,6 +780,18 @@ void resize_bilinear_c3(const unsigned char* src, int srcw, int srch, int srcstr
                 _rows1 = vmlal_s16(_rows1, _S1high, _a1);
                 int16x4_t _rows1_sr4 = vshrn_n_s32(_rows1, 4);
                 vst1_s16(rows1p, _rows1_sr4);
+#elif __SSE2__
+                if (simd_level >= 1)
+                {
+                    __m128i _a01 = _mm_set1_epi32((int)((unsigned short)a0 | ((unsigned int)(unsigned short)a1 << 16)));
+                    _mm_storel_epi64((__m128i*)rows1p, hresize_c3_sse2(S1p, _a01));
+                }
+                else
+                {
+                    rows1p[0] = (S1p[0] * a0 + S1p[3] * a1) >> 4;
+                    rows1p[1] = (S1p[1] * a0 + S1p[4] * a1) >> 4;
+                    rows1p[2] = (S1p[2] * a0 + S1p[5] * a1) >> 4;
+                }
 #else
                 rows1p[0] = (S1p[0] * a0 + S1p[3] * a1) >> 4;
                 rows1p[1] = (S1p[1] * a0 + S1p[4] * a1) >> 4;
@@ -798,6 +853,22 @@ void resize_bilinear_c3(const unsigned char* src, int srcw, int srch, int srcstr
                 int16x4_t _rows1_sr4 = vshrn_n_s32(_rows1, 4);
                 vst1_s16(rows0p, _rows0_sr4);
                 vst1_s16(rows1p, _rows1_sr4);
+#elif __SSE2__
+                if (simd_level >= 1)
+                {
+                    __m128i _a01 = _mm_set1_epi32((int)((unsigned short)a0 | ((unsigned int)(unsigned short)a1 << 16)));
+                    _mm_storel_epi64((__m128i*)rows0p, hresize_c3_sse2(S0p, _a01));
+                    _mm_storel_epi64((__m128i*)rows1p, hresize_c3_sse2(S1p, _a01));
+                }
+                else
+                {
+                    rows0p[0] = (S0p[0] * a0 + S0p[3] * a1) >> 4;
+                    rows0p[1] = (S0p[1] * a0 + S0p[4] * a1) >> 4;
+                    rows0p[2] = (S0p[2] * a0 + S0p[5] * a1) >> 4;
+                    rows1p[0] = (S1p[0] * a0 + S1p[3] * a1) >> 4;
+                    rows1p[1] = (S1p[1] * a0 + S1p[4] * a1) >> 4;
+                    rows1p[2] = (S1p[2] * a0 + S1p[5] * a1) >> 4;
+                }
 #else
                 rows0p[0] = (S0p[0] * a0 + S0p[3] * a1) >> 4;
                 rows0p[1] = (S0p[1] * a0 + S0p[4] * a1) >> 4;
@@ -825,6 +896,15 @@ void resize_bilinear_c3(const unsigned char* src, int srcw, int srch, int srcstr
 
 #if __ARM_NEON
         int nn = (w * 3) >> 3;
+#elif __SSE2__
+        int nn = 0;
+        {
+            int done = vresize_x86(rows0p, rows1p, b0, b1, Dp, (w * 3));
+            rows0p += done;
+            rows1p += done;
+            Dp += done;
+            nn = done >> 3; // done is always a multiple of 16
+        }
 #else
         int nn = 0;
 #endif
@@ -1125,6 +1205,15 @@ void resize_bilinear_c4(const unsigned char* src, int srcw, int srch, int srcstr
 
 #if __ARM_NEON
         int nn = (w * 4) >> 3;
+#elif __SSE2__
+        int nn = 0;
+        {
+            int done = vresize_x86(rows0p, rows1p, b0, b1, Dp, (w * 4));
+            rows0p += done;
+            rows1p += done;
+            Dp += done;
+            nn = done >> 3; // done is always a multiple of 16
+        }
 #else
         int nn = 0;
 #endif
@@ -0,0 +1,301 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2026 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// x86 kernels shared by mat_pixel*.cpp (sse2) and mat_pixel_x86_avx2.cpp (avx2)
+// every kernel returns how many elements it handled, the caller finishes the tail with the scalar loop
+// results are bit exact with the scalar path
+
+// included inside namespace ncnn, the including file provides emmintrin.h / immintrin.h and string.h
+
+#if __SSE2__
+#if NCNN_RUNTIME_CPU && NCNN_AVX2 && !__AVX2__
+int from_rgb_x86_avx2(const unsigned char* rgb, int w, float* ptr0, float* ptr1, float* ptr2);
+int from_gray_x86_avx2(const unsigned char* gray, int w, float* ptr);
+int vresize_x86_avx2(const short* rows0p, const short* rows1p, short b0, short b1, unsigned char* Dp, int n);
+int warpaffine_bilinear_c3_x86_avx2(const unsigned char* src0, int srcstride, int X0, int Y0, const int* adelta, const int* bdelta, unsigned char* dst0);
+#endif
+
+static inline unsigned int load_u32_x86(const unsigned char* p)
+{
+    unsigned int v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// split 16 interleaved rgb pixels into three planes with unpack only
+static inline void deinterleave_rgb_sse2(const unsigned char* rgb, __m128i& _r, __m128i& _g, __m128i& _b)
+{
+    __m128i _t00 = _mm_loadu_si128((const __m128i*)rgb);
+    __m128i _t01 = _mm_loadu_si128((const __m128i*)(rgb + 16));
+    __m128i _t02 = _mm_loadu_si128((const __m128i*)(rgb + 32));
+
+    __m128i _t10 = _mm_unpacklo_epi8(_t00, _mm_unpackhi_epi64(_t01, _t01));
+    __m128i _t11 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(_t00, _t00), _t02);
+    __m128i _t12 = _mm_unpacklo_epi8(_t01, _mm_unpackhi_epi64(_t02, _t02));
+
+    __m128i _t20 = _mm_unpacklo_epi8(_t10, _mm_unpackhi_epi64(_t11, _t11));
+    __m128i _t21 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(_t10, _t10), _t12);
+    __m128i _t22 = _mm_unpacklo_epi8(_t11, _mm_unpackhi_epi64(_t12, _t12));
+
+    __m128i _t30 = _mm_unpacklo_epi8(_t20, _mm_unpackhi_epi64(_t21, _t21));
+    __m128i _t31 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(_t20, _t20), _t22);
+    __m128i _t32 = _mm_unpacklo_epi8(_t21, _mm_unpackhi_epi64(_t22, _t22));
+
+    _r = _mm_unpacklo_epi8(_t30, _mm_unpackhi_epi64(_t31, _t31));
+    _g = _mm_unpacklo_epi8(_mm_unpackhi_epi64(_t30, _t30), _t32);
+    _b = _mm_unpacklo_epi8(_t31, _mm_unpackhi_epi64(_t32, _t32));
+}
+
+// widen 16 u8 to 16 fp32
+static inline void store_u8_as_fp32_x86(__m128i _v, float* ptr)
+{
+#if __AVX2__
+    _mm256_storeu_ps(ptr, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_v)));
+    _mm256_storeu_ps(ptr + 8, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_unpackhi_epi64(_v, _v))));
+#else
+    __m128i _zero = _mm_setzero_si128();
+    __m128i _v16l = _mm_unpacklo_epi8(_v, _zero);
+    __m128i _v16h = _mm_unpackhi_epi8(_v, _zero);
+    _mm_storeu_ps(ptr, _mm_cvtepi32_ps(_mm_unpacklo_epi16(_v16l, _zero)));
+    _mm_storeu_ps(ptr + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(_v16l, _zero)));
+    _mm_storeu_ps(ptr + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(_v16h, _zero)));
+    _mm_storeu_ps(ptr + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(_v16h, _zero)));
+#endif
+}
+
+static inline int from_rgb_x86_kernel(const unsigned char* rgb, int w, float* ptr0, float* ptr1, float* ptr2)
+{
+    int i = 0;
+    for (; i + 15 < w; i += 16)
+    {
+        __m128i _r, _g, _b;
+        deinterleave_rgb_sse2(rgb, _r, _g, _b);
+
+        store_u8_as_fp32_x86(_r, ptr0);
+        store_u8_as_fp32_x86(_g, ptr1);
+        store_u8_as_fp32_x86(_b, ptr2);
+
+        rgb += 48;
+        ptr0 += 16;
+        ptr1 += 16;
+        ptr2 += 16;
+    }
+
+    return i;
+}
+
+static inline int from_gray_x86_kernel(const unsigned char* gray, int w, float* ptr)
+{
+    int i = 0;
+    for (; i + 15 < w; i += 16)
+    {
+        store_u8_as_fp32_x86(_mm_loadu_si128((const __m128i*)gray), ptr);
+
+        gray += 16;
+        ptr += 16;
+    }
+
+    return i;
+}
+
+// D[x] = ((rows0[x] * b0 >> 16) + (rows1[x] * b1 >> 16) + 2) >> 2
+static inline int vresize_x86_kernel(const short* rows0p, const short* rows1p, short b0, short b1, unsigned char* Dp, int n)
+{
+    int i = 0;
+#if __AVX2__
+    {
+        __m256i _b0 = _mm256_set1_epi16(b0);
+        __m256i _b1 = _mm256_set1_epi16(b1);
+        __m256i _v2 = _mm256_set1_epi16(2);
+        for (; i + 31 < n; i += 32)
+        {
+            __m256i _acc0 = _mm256_add_epi16(_mm256_mulhi_epi16(_mm256_loadu_si256((const __m256i*)(rows0p + i)), _b0), _mm256_mulhi_epi16(_mm256_loadu_si256((const __m256i*)(rows1p + i)), _b1));
+            __m256i _acc1 = _mm256_add_epi16(_mm256_mulhi_epi16(_mm256_loadu_si256((const __m256i*)(rows0p + i + 16)), _b0), _mm256_mulhi_epi16(_mm256_loadu_si256((const __m256i*)(rows1p + i + 16)), _b1));
+            _acc0 = _mm256_srai_epi16(_mm256_add_epi16(_acc0, _v2), 2);
+            _acc1 = _mm256_srai_epi16(_mm256_add_epi16(_acc1, _v2), 2);
+
+            // packus works per 128bit lane, restore the element order afterwards
+            __m256i _D = _mm256_permute4x64_epi64(_mm256_packus_epi16(_acc0, _acc1), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256((__m256i*)(Dp + i), _D);
+        }
+    }
+#endif // __AVX2__
+    __m128i _b0 = _mm_set1_epi16(b0);
+    __m128i _b1 = _mm_set1_epi16(b1);
+    __m128i _v2 = _mm_set1_epi16(2);
+    for (; i + 15 < n; i += 16)
+    {
+        __m128i _acc0 = _mm_add_epi16(_mm_mulhi_epi16(_mm_loadu_si128((const __m128i*)(rows0p + i)), _b0), _mm_mulhi_epi16(_mm_loadu_si128((const __m128i*)(rows1p + i)), _b1));
+        __m128i _acc1 = _mm_add_epi16(_mm_mulhi_epi16(_mm_loadu_si128((const __m128i*)(rows0p + i + 8)), _b0), _mm_mulhi_epi16(_mm_loadu_si128((const __m128i*)(rows1p + i + 8)), _b1));
+        _acc0 = _mm_srai_epi16(_mm_add_epi16(_acc0, _v2), 2);
+        _acc1 = _mm_srai_epi16(_mm_add_epi16(_acc1, _v2), 2);
+
+        _mm_storeu_si128((__m128i*)(Dp + i), _mm_packus_epi16(_acc0, _acc1));
+    }
+
+    return i;
+}
+
+// one channel of the bilinear blend on 32bit lanes
+// the a0/a1 lanes hold 4 source bytes starting at the top-left pixel and 2 bytes later,
+// so channel c of the left pixel is byte c of a0 and of the right pixel is byte c+1 of a1
+#if __AVX2__
+static inline __m256i warpaffine_c3_channel_avx2(__m256i _a0, __m256i _a1, __m256i _b0, __m256i _b1, __m256i _alpha, __m256i _beta, int c)
+{
+    __m256i _mask = _mm256_set1_epi32(0xff);
+    __m256i _pa = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(_a0, c * 8), _mask), _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(_a1, c * 8 + 8), _mask), 16));
+    __m256i _pb = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(_b0, c * 8), _mask), _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(_b1, c * 8 + 8), _mask), 16));
+    __m256i _ta = _mm256_srli_epi32(_mm256_madd_epi16(_pa, _alpha), 5);
+    __m256i _tb = _mm256_srli_epi32(_mm256_madd_epi16(_pb, _alpha), 5);
+    return _mm256_srli_epi32(_mm256_madd_epi16(_mm256_or_si256(_ta, _mm256_slli_epi32(_tb, 16)), _beta), 15);
+}
+#endif // __AVX2__
+
+static inline __m128i warpaffine_c3_channel_sse2(__m128i _a0, __m128i _a1, __m128i _b0, __m128i _b1, __m128i _alpha, __m128i _beta, int c)
+{
+    __m128i _mask = _mm_set1_epi32(0xff);
+    __m128i _pa = _mm_or_si128(_mm_and_si128(_mm_srl_epi32(_a0, _mm_cvtsi32_si128(c * 8)), _mask), _mm_slli_epi32(_mm_and_si128(_mm_srl_epi32(_a1, _mm_cvtsi32_si128(c * 8 + 8)), _mask), 16));
+    __m128i _pb = _mm_or_si128(_mm_and_si128(_mm_srl_epi32(_b0, _mm_cvtsi32_si128(c * 8)), _mask), _mm_slli_epi32(_mm_and_si128(_mm_srl_epi32(_b1, _mm_cvtsi32_si128(c * 8 + 8)), _mask), 16));
+    __m128i _ta = _mm_srli_epi32(_mm_madd_epi16(_pa, _alpha), 5);
+    __m128i _tb = _mm_srli_epi32(_mm_madd_epi16(_pb, _alpha), 5);
+    return _mm_srli_epi32(_mm_madd_epi16(_mm_or_si128(_ta, _mm_slli_epi32(_tb, 16)), _beta), 15);
+}
+
+// 8 destination pixels whose source quads are all inside the image
+static inline int warpaffine_bilinear_c3_x86_kernel(const unsigned char* src0, int srcstride, int X0, int Y0, const int* adelta, const int* bdelta, unsigned char* dst0)
+{
+#if __AVX2__
+    __m256i _X = _mm256_add_epi32(_mm256_set1_epi32(X0), _mm256_loadu_si256((const __m256i*)adelta));
+    __m256i _Y = _mm256_add_epi32(_mm256_set1_epi32(Y0), _mm256_loadu_si256((const __m256i*)bdelta));
+
+    __m256i _v1024m1 = _mm256_set1_epi32((1 << 10) - 1);
+    __m256i _fx = _mm256_and_si256(_X, _v1024m1);
+    __m256i _fy = _mm256_and_si256(_Y, _v1024m1);
+    __m256i _v1024 = _mm256_set1_epi32(1 << 10);
+    __m256i _alpha = _mm256_or_si256(_mm256_sub_epi32(_v1024, _fx), _mm256_slli_epi32(_fx, 16));
+    __m256i _beta = _mm256_or_si256(_mm256_sub_epi32(_v1024, _fy), _mm256_slli_epi32(_fy, 16));
+
+    __m256i _offset = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(_Y, 10), _mm256_set1_epi32(srcstride)), _mm256_mullo_epi32(_mm256_srai_epi32(_X, 10), _mm256_set1_epi32(3)));
+
+    __m256i _a0 = _mm256_i32gather_epi32((const int*)src0, _offset, 1);
+    __m256i _a1 = _mm256_i32gather_epi32((const int*)(src0 + 2), _offset, 1);
+    __m256i _b0 = _mm256_i32gather_epi32((const int*)(src0 + srcstride), _offset, 1);
+    __m256i _b1 = _mm256_i32gather_epi32((const int*)(src0 + srcstride + 2), _offset, 1);
+
+    __m256i _d0 = warpaffine_c3_channel_avx2(_a0, _a1, _b0, _b1, _alpha, _beta, 0);
+    __m256i _d1 = warpaffine_c3_channel_avx2(_a0, _a1, _b0, _b1, _alpha, _beta, 1);
+    __m256i _d2 = warpaffine_c3_channel_avx2(_a0, _a1, _b0, _b1, _alpha, _beta, 2);
+    __m256i _rgbx = _mm256_or_si256(_d0, _mm256_or_si256(_mm256_slli_epi32(_d1, 8), _mm256_slli_epi32(_d2, 16)));
+
+    // drop the 4th byte of every pixel, 12 valid bytes per 128bit lane
+    __m256i _shuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    _rgbx = _mm256_shuffle_epi8(_rgbx, _shuffle);
+    __m128i _lo = _mm256_castsi256_si128(_rgbx);
+    __m128i _hi = _mm256_extracti128_si256(_rgbx, 1);
+    _mm_storel_epi64((__m128i*)dst0, _lo);
+    unsigned int _lo8 = (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(_lo, 8));
+    memcpy(dst0 + 8, &_lo8, 4);
+    _mm_storel_epi64((__m128i*)(dst0 + 12), _hi);
+    unsigned int _hi8 = (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(_hi, 8));
+    memcpy(dst0 + 20, &_hi8, 4);
+#else
+    for (int k = 0; k < 8; k += 4)
+    {
+        int a0[4];
+        int a1[4];
+        int b0[4];
+        int b1[4];
+        for (int xi = 0; xi < 4; xi++)
+        {
+            int X = X0 + adelta[k + xi];
+            int Y = Y0 + bdelta[k + xi];
+            const unsigned char* a = src0 + srcstride * (Y >> 10) + (X >> 10) * 3;
+            a0[xi] = (int)load_u32_x86(a);
+            a1[xi] = (int)load_u32_x86(a + 2);
+            b0[xi] = (int)load_u32_x86(a + srcstride);
+            b1[xi] = (int)load_u32_x86(a + srcstride + 2);
+        }
+
+        __m128i _X = _mm_add_epi32(_mm_set1_epi32(X0), _mm_loadu_si128((const __m128i*)(adelta + k)));
+        __m128i _Y = _mm_add_epi32(_mm_set1_epi32(Y0), _mm_loadu_si128((const __m128i*)(bdelta + k)));
+
+        __m128i _v1024m1 = _mm_set1_epi32((1 << 10) - 1);
+        __m128i _fx = _mm_and_si128(_X, _v1024m1);
+        __m128i _fy = _mm_and_si128(_Y, _v1024m1);
+        __m128i _v1024 = _mm_set1_epi32(1 << 10);
+        __m128i _alpha = _mm_or_si128(_mm_sub_epi32(_v1024, _fx), _mm_slli_epi32(_fx, 16));
+        __m128i _beta = _mm_or_si128(_mm_sub_epi32(_v1024, _fy), _mm_slli_epi32(_fy, 16));
+
+        __m128i _a0 = _mm_loadu_si128((const __m128i*)a0);
+        __m128i _a1 = _mm_loadu_si128((const __m128i*)a1);
+        __m128i _b0 = _mm_loadu_si128((const __m128i*)b0);
+        __m128i _b1 = _mm_loadu_si128((const __m128i*)b1);
+
+        __m128i _d0 = warpaffine_c3_channel_sse2(_a0, _a1, _b0, _b1, _alpha, _beta, 0);
+        __m128i _d1 = warpaffine_c3_channel_sse2(_a0, _a1, _b0, _b1, _alpha, _beta, 1);
+        __m128i _d2 = warpaffine_c3_channel_sse2(_a0, _a1, _b0, _b1, _alpha, _beta, 2);
+
+        unsigned int rgbx[4];
+        _mm_storeu_si128((__m128i*)rgbx, _mm_or_si128(_d0, _mm_or_si128(_mm_slli_epi32(_d1, 8), _mm_slli_epi32(_d2, 16))));
+        for (int xi = 0; xi < 4; xi++)
+        {
+            memcpy(dst0 + (k + xi) * 3, &rgbx[xi], 3);
+        }
+    }
+#endif // __AVX2__
+
+    return 8;
+}
+
+// dispatch by get_pixel_simd_level(), 0 means the caller runs everything scalar
+static inline int from_rgb_x86(const unsigned char* rgb, int w, float* ptr0, float* ptr1, float* ptr2)
+{
+    const int level = get_pixel_simd_level();
+#if NCNN_RUNTIME_CPU && NCNN_AVX2 && !__AVX2__
+    if (level >= 2)
+        return from_rgb_x86_avx2(rgb, w, ptr0, ptr1, ptr2);
+#endif
+    return level >= 1 ? from_rgb_x86_kernel(rgb, w, ptr0, ptr1, ptr2) : 0;
+}
+
+static inline int from_gray_x86(const unsigned char* gray, int w, float* ptr)
+{
+    const int level = get_pixel_simd_level();
+#if NCNN_RUNTIME_CPU && NCNN_AVX2 && !__AVX2__
+    if (level >= 2)
+        return from_gray_x86_avx2(gray, w, ptr);
+#endif
+    return level >= 1 ? from_gray_x86_kernel(gray, w, ptr) : 0;
+}
+
+static inline int vresize_x86(const short* rows0p, const short* rows1p, short b0, short b1, unsigned char* Dp, int n)
+{
+    const int level = get_pixel_simd_level();
+#if NCNN_RUNTIME_CPU && NCNN_AVX2 && !__AVX2__
+    if (level >= 2)
+        return vresize_x86_avx2(rows0p, rows1p, b0, b1, Dp, n);
+#endif
+    return level >= 1 ? vresize_x86_kernel(rows0p, rows1p, b0, b1, Dp, n) : 0;
+}
+
+static inline int warpaffine_bilinear_c3_x86(int level, const unsigned char* src0, int srcstride, int X0, int Y0, const int* adelta, const int* bdelta, unsigned char* dst0)
+{
+#if NCNN_RUNTIME_CPU && NCNN_AVX2 && !__AVX2__
+    if (level >= 2)
+        return warpaffine_bilinear_c3_x86_avx2(src0, srcstride, X0, Y0, adelta, bdelta, dst0);
+#endif
+    return level >= 1 ? warpaffine_bilinear_c3_x86_kernel(src0, srcstride, X0, Y0, adelta, bdelta, dst0) : 0;
+}
+
+#endif // __SSE2__
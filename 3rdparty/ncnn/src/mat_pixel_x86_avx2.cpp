@@ -0,0 +1,46 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2026 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "mat.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+namespace ncnn {
+
+#if NCNN_PIXEL
+#include "mat_pixel_x86.h"
+
+int from_rgb_x86_avx2(const unsigned char* rgb, int w, float* ptr0, float* ptr1, float* ptr2)
+{
+    return from_rgb_x86_kernel(rgb, w, ptr0, ptr1, ptr2);
+}
+
+int from_gray_x86_avx2(const unsigned char* gray, int w, float* ptr)
+{
+    return from_gray_x86_kernel(gray, w, ptr);
+}
+
+int vresize_x86_avx2(const short* rows0p, const short* rows1p, short b0, short b1, unsigned char* Dp, int n)
+{
+    return vresize_x86_kernel(rows0p, rows1p, b0, b1, Dp, n);
+}
+
+int warpaffine_bilinear_c3_x86_avx2(const unsigned char* src0, int srcstride, int X0, int Y0, const int* adelta, const int* bdelta, unsigned char* dst0)
+{
+    return warpaffine_bilinear_c3_x86_kernel(src0, srcstride, X0, Y0, adelta, bdelta, dst0);
+}
+#endif // NCNN_PIXEL
+
+} // namespace ncnn
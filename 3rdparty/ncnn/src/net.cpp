@@ -35,6 +35,25 @@
 
 namespace ncnn {
 
+static Option get_masked_option(const Option& opt, int featmask)
+{
+    // mask option usage as layer specific featmask
+    Option opt1 = opt;
+    opt1.use_fp16_arithmetic = opt1.use_fp16_arithmetic && !(featmask & (1 << 0));
+    opt1.use_fp16_storage = opt1.use_fp16_storage && !(featmask & (1 << 1));
+    opt1.use_fp16_packed = opt1.use_fp16_packed && !(featmask & (1 << 1));
+    opt1.use_bf16_storage = opt1.use_bf16_storage && !(featmask & (1 << 2));
+    opt1.use_int8_packed = opt1.use_int8_packed && !(featmask & (1 << 3));
+    opt1.use_int8_storage = opt1.use_int8_storage && !(featmask & (1 << 3));
+    opt1.use_int8_arithmetic = opt1.use_int8_arithmetic && !(featmask & (1 << 3));
+    opt1.use_vulkan_compute = opt1.use_vulkan_compute && !(featmask & (1 << 4));
+    opt1.use_image_storage = opt1.use_image_storage && !(featmask & (1 << 4));
+    opt1.use_tensor_storage = opt1.use_tensor_storage && !(featmask & (1 << 4));
+    opt1.use_sgemm_convolution = opt1.use_sgemm_convolution && !(featmask & (1 << 5));
+    opt1.use_winograd_convolution = opt1.use_winograd_convolution && !(featmask & (1 << 6));
+    return opt1;
+}
+
 class NetPrivate
 {
 public:
@@ -195,7 +214,7 @@ int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, cons
         bottom_blob.elemsize = blob_mats[bottom_blob_index].elemsize;
     }
 #endif
-    int ret = do_forward_layer(layer, blob_mats, opt);
+    int ret = do_forward_layer(layer, blob_mats, get_masked_option(opt, layer->featmask));
 #if NCNN_BENCHMARK
     double end = get_current_time();
     if (layer->one_blob_only)
@@ -368,7 +387,7 @@ int NetPrivate::forward_layer(int layer_index, std::vector<Mat>& blob_mats, std:
             bottom_blob = blob_mats[bottom_blob_index].shape();
         }
 #endif
-        ret = do_forward_layer(layer, blob_mats, opt);
+        ret = do_forward_layer(layer, blob_mats, get_masked_option(opt, layer->featmask));
 #if NCNN_BENCHMARK
         double end = get_current_time();
         if (layer->one_blob_only)
@@ -703,7 +722,7 @@ IMAGE_ALLOCATION_FAILED:
             bottom_blob = blob_mats[bottom_blob_index].shape();
         }
 #endif
-        ret = do_forward_layer(layer, blob_mats, opt);
+        ret = do_forward_layer(layer, blob_mats, get_masked_option(opt, layer->featmask));
 #if NCNN_BENCHMARK
         double end = get_current_time();
         if (layer->one_blob_only)
@@ -1571,6 +1590,9 @@ int Net::load_param(const DataReader& dr)
             layer->top_shapes[j] = d->blobs[layer->tops[j]].shape;
         }
 
+        // pull out layer specific feature disabled set
+        layer->featmask = pd.get(31, 0);
+
         int lr = layer->load_param(pd);
         if (lr != 0)
         {
@@ -1774,6 +1796,9 @@ int Net::load_param_bin(const DataReader& dr)
             layer->top_shapes[j] = d->blobs[layer->tops[j]].shape;
         }
 
+        // pull out layer specific feature disabled set
+        layer->featmask = pd.get(31, 0);
+
         int lr = layer->load_param(pd);
         if (lr != 0)
         {
@@ -1855,7 +1880,7 @@ int Net::load_model(const DataReader& dr)
     {
         Layer* layer = d->layers[i];
 
-        Option opt1 = opt;
+        Option opt1 = get_masked_option(opt, layer->featmask);
 #if NCNN_VULKAN
         if (opt.use_vulkan_compute)
         {
@@ -2066,7 +2091,7 @@ void Net::clear()
     {
         Layer* layer = d->layers[i];
 
-        Option opt1 = opt;
+        Option opt1 = get_masked_option(opt, layer->featmask);
         if (!layer->support_image_storage)
         {
             opt1.use_image_storage = false;
@@ -2166,6 +2191,62 @@ const std::vector<Layer*>& Net::layers() const
     return d->layers;
 }
 
+int Net::set_layer_featmask(int layer_index, int featmask)
+{
+    if (layer_index < 0 || layer_index >= (int)d->layers.size())
+        return -1;
+
+    Layer* layer = d->layers[layer_index];
+    if (layer->featmask == featmask)
+        return 0;
+
+    int dret = layer->destroy_pipeline(get_masked_option(opt, layer->featmask));
+    if (dret != 0)
+    {
+        NCNN_LOGE("layer destroy_pipeline %d failed", layer_index);
+        return -1;
+    }
+
+    layer->featmask = featmask;
+
+    int cret = layer->create_pipeline(get_masked_option(opt, layer->featmask));
+    if (cret != 0)
+    {
+        NCNN_LOGE("layer create_pipeline %d failed", layer_index);
+        return -1;
+    }
+
+    return 0;
+}
+
+int Net::forward_layer(int layer_index, const Mat& bottom_blob, Mat& top_blob) const
+{
+    if (layer_index < 0 || layer_index >= (int)d->layers.size())
+        return -1;
+
+    const Layer* layer = d->layers[layer_index];
+    if (!layer->one_blob_only)
+        return -1;
+
+    Option opt1 = get_masked_option(opt, layer->featmask);
+
+    Mat bottom_blob_converted = bottom_blob;
+    int ret = d->convert_layout(bottom_blob_converted, layer, opt1);
+    if (ret != 0)
+        return ret;
+
+    if (layer->support_inplace)
+    {
+        top_blob = bottom_blob_converted.clone(opt1.blob_allocator);
+        if (top_blob.empty())
+            return -100;
+
+        return layer->forward_inplace(top_blob, opt1);
+    }
+
+    return layer->forward(bottom_blob_converted, top_blob, opt1);
+}
+
 std::vector<Blob>& Net::mutable_blobs()
 {
     return d->blobs;
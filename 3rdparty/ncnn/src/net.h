@@ -143,6 +143,17 @@ public:
     std::vector<Blob>& mutable_blobs();
     std::vector<Layer*>& mutable_layers();
 
+    // change the feature disabled set of one loaded layer and recreate its pipeline
+    // featmask bits: 0 fp16 arithmetic, 1 fp16 storage, 2 bf16 storage, 3 int8,
+    //                4 vulkan, 5 sgemm convolution, 6 winograd convolution
+    // return 0 if success
+    int set_layer_featmask(int layer_index, int featmask);
+
+    // run one single-blob layer standalone, converting the bottom blob layout
+    // the same way as in extractor forward, useful for per-layer benchmark
+    // return 0 if success
+    int forward_layer(int layer_index, const Mat& bottom_blob, Mat& top_blob) const;
+
 protected:
     friend class Extractor;
 #if NCNN_STRING
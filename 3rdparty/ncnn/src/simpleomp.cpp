@@ -286,6 +286,9 @@ static void init_g_kmp_global()
     g_kmp_global.init();
 }
 
+static kmp_fork_backend g_fork_backend = 0;
+static void* g_fork_backend_data = 0;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -330,6 +333,12 @@ void kmp_set_blocktime(int /*blocktime*/)
     // always passive, ignore
 }
 
+void kmp_set_fork_backend(kmp_fork_backend backend, void* backend_data)
+{
+    g_fork_backend_data = backend_data;
+    g_fork_backend = backend;
+}
+
 static int kmp_invoke_microtask(kmpc_micro fn, int gtid, int tid, int argc, void** argv)
 {
     // fprintf(stderr, "__kmp_invoke_microtask %d %d %d\n", gtid, tid, argc);
@@ -475,6 +484,31 @@ static void* kmp_threadfunc(void* args)
     return 0;
 }
 
+struct KMPTeam
+{
+    kmpc_micro fn;
+    int argc;
+    void** argv;
+    int num_threads;
+};
+
+static void kmp_team_member_func(void* ctx, int thread_num)
+{
+    const KMPTeam* team = (const KMPTeam*)ctx;
+
+    // the backend may run this member on a thread that is itself inside another team
+    void* outer_num_threads = tls_num_threads.get();
+    void* outer_thread_num = tls_thread_num.get();
+
+    tls_num_threads.set(reinterpret_cast<void*>((size_t)team->num_threads));
+    tls_thread_num.set(reinterpret_cast<void*>((size_t)thread_num));
+
+    kmp_invoke_microtask(team->fn, thread_num, thread_num, team->argc, team->argv);
+
+    tls_num_threads.set(outer_num_threads);
+    tls_thread_num.set(outer_thread_num);
+}
+
 int32_t __kmpc_global_thread_num(void* /*loc*/)
 {
     // NCNN_LOGE("__kmpc_global_thread_num");
@@ -489,8 +523,6 @@ void __kmpc_push_num_threads(void* /*loc*/, int32_t /*gtid*/, int32_t num_thread
 
 void __kmpc_fork_call(void* /*loc*/, int32_t argc, kmpc_micro fn, ...)
 {
-    g_kmp_global.try_init();
-
     // NCNN_LOGE("__kmpc_fork_call %d", argc);
     int num_threads = omp_get_num_threads();
 
@@ -504,6 +536,22 @@ void __kmpc_fork_call(void* /*loc*/, int32_t argc, kmpc_micro fn, ...)
         va_end(ap);
     }
 
+    kmp_fork_backend fork_backend = g_fork_backend;
+    if (fork_backend && num_threads > 1)
+    {
+        KMPTeam team;
+        team.fn = fn;
+        team.argc = argc;
+        team.argv = argv;
+        team.num_threads = num_threads;
+
+        fork_backend(g_fork_backend_data, num_threads, kmp_team_member_func, &team);
+
+        return;
+    }
+
+    g_kmp_global.try_init();
+
     if (g_kmp_global.kmp_max_threads == 1 || num_threads == 1)
     {
         for (int i = 0; i < num_threads; i++)
@@ -555,6 +603,21 @@ void __kmpc_fork_call(void* /*loc*/, int32_t argc, kmpc_micro fn, ...)
     }
 }
 
+// gcc outlines the parallel region as fn(data) and splits static loops itself
+// with omp_get_num_threads() and omp_get_thread_num(), wrap it as a two argument microtask
+static void gomp_microtask(int32_t* /*gtid*/, int32_t* /*tid*/, void* fn, void* data)
+{
+    ((void (*)(void*))fn)(data);
+}
+
+void GOMP_parallel(void (*fn)(void*), void* data, unsigned int num_threads, unsigned int /*flags*/)
+{
+    // NCNN_LOGE("GOMP_parallel %u", num_threads);
+    omp_set_num_threads(num_threads ? (int)num_threads : omp_get_max_threads());
+
+    __kmpc_fork_call(0, 2, (kmpc_micro)gomp_microtask, (void*)fn, data);
+}
+
 void __kmpc_for_static_init_4(void* /*loc*/, int32_t gtid, int32_t /*sched*/, int32_t* last, int32_t* lower, int32_t* upper, int32_t* /*stride*/, int32_t /*incr*/, int32_t /*chunk*/)
 {
     // NCNN_LOGE("__kmpc_for_static_init_4");
@@ -21,7 +21,8 @@
 
 #include <stdint.h>
 
-// This minimal openmp runtime implementation only supports the llvm openmp abi
+// This minimal openmp runtime implementation supports the llvm openmp abi and
+// the GOMP_parallel entry of the gcc openmp abi
 // and only supports #pragma omp parallel for num_threads(X)
 
 #ifdef __cplusplus
@@ -44,6 +45,15 @@ NCNN_EXPORT int kmp_get_blocktime();
 
 NCNN_EXPORT void kmp_set_blocktime(int blocktime);
 
+// run parallel regions on an external task scheduler instead of the builtin thread pool
+// the backend must call member(ctx, thread_num) once for every thread_num in [0, num_threads)
+// and return after all of them finished, members may run in any order or on any thread
+// pass a null backend to restore the builtin thread pool
+typedef void (*kmp_team_member)(void* ctx, int thread_num);
+typedef void (*kmp_fork_backend)(void* backend_data, int num_threads, kmp_team_member member, void* ctx);
+
+NCNN_EXPORT void kmp_set_fork_backend(kmp_fork_backend backend, void* backend_data);
+
 #ifdef __cplusplus
 }
 #endif
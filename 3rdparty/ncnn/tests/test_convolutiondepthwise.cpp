@@ -334,13 +334,38 @@ static int test_convolutiondepthwise_1()
 }
 #endif // NCNN_INT8
 
+static int test_convolutiondepthwise_3()
+{
+    // wide rows for the 5x5 pack1 vector loops and their tails
+    int ret = 0
+              || test_convolutiondepthwise(37, 9, 3, 3, 5, 1, 1, 2, 1, 3)
+              || test_convolutiondepthwise(40, 9, 5, 5, 5, 1, 2, 2, 1, 5)
+              || test_convolutiondepthwise(41, 8, 7, 7, 5, 1, 2, 2, 0, 7);
+
+    if (ret != 0)
+        return -1;
+
+#if NCNN_INT8
+    ret = 0
+          || test_convolutiondepthwise_int8(37, 9, 3, 3, 5, 1, 1, 2, 1, 3)
+          || test_convolutiondepthwise_int8(40, 9, 5, 5, 5, 1, 2, 2, 1, 5)
+          || test_convolutiondepthwise_int8(41, 8, 7, 7, 5, 1, 2, 2, 0, 7, true)
+          || test_convolutiondepthwise_int8(37, 9, 7, 7, 5, 1, 1, 2, 1, 7, true);
+
+    if (ret != 0)
+        return -1;
+#endif // NCNN_INT8
+
+    return 0;
+}
+
 int main()
 {
     SRAND(7767517);
 
 #if NCNN_INT8
-    return test_convolutiondepthwise_0() || test_convolutiondepthwise_1() || test_convolutiondepthwise_2();
+    return test_convolutiondepthwise_0() || test_convolutiondepthwise_1() || test_convolutiondepthwise_2() || test_convolutiondepthwise_3();
 #else
-    return test_convolutiondepthwise_0() || test_convolutiondepthwise_2();
+    return test_convolutiondepthwise_0() || test_convolutiondepthwise_2() || test_convolutiondepthwise_3();
 #endif
 }
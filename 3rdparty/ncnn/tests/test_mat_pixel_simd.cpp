@@ -0,0 +1,154 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2026 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "mat.h"
+#include "prng.h"
+
+#include <string.h>
+#include <vector>
+
+static struct prng_rand_t g_prng_rand_state;
+#define SRAND(seed) prng_srand(seed, &g_prng_rand_state)
+#define RAND()      prng_rand(&g_prng_rand_state)
+
+static std::vector<unsigned char> RandomPixels(int size)
+{
+    std::vector<unsigned char> p(size);
+    for (int i = 0; i < size; i++)
+    {
+        p[i] = RAND() % 256;
+    }
+
+    return p;
+}
+
+// every simd level must produce exactly what the scalar path produces
+static int test_mat_pixel_simd_from_pixels(int w, int h, int level)
+{
+    const int types[3] = {ncnn::Mat::PIXEL_RGB, ncnn::Mat::PIXEL_RGB2BGR, ncnn::Mat::PIXEL_GRAY};
+    for (int t = 0; t < 3; t++)
+    {
+        const int c = types[t] == ncnn::Mat::PIXEL_GRAY ? 1 : 3;
+        const int stride = w * c + (w % 2) * 5;
+        std::vector<unsigned char> pixels = RandomPixels(stride * h);
+
+        ncnn::set_pixel_simd_level(0);
+        ncnn::Mat m0 = ncnn::Mat::from_pixels(pixels.data(), types[t], w, h, stride);
+        ncnn::set_pixel_simd_level(level);
+        ncnn::Mat m1 = ncnn::Mat::from_pixels(pixels.data(), types[t], w, h, stride);
+
+        for (int q = 0; q < c; q++)
+        {
+            if (memcmp(m0.channel(q), m1.channel(q), w * h * sizeof(float)) != 0)
+            {
+                fprintf(stderr, "test_mat_pixel_simd_from_pixels failed w=%d h=%d type=%d level=%d\n", w, h, types[t], level);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void resize_bilinear(int c, const unsigned char* src, int srcw, int srch, unsigned char* dst, int w, int h)
+{
+    if (c == 1)
+        ncnn::resize_bilinear_c1(src, srcw, srch, dst, w, h);
+    if (c == 2)
+        ncnn::resize_bilinear_c2(src, srcw, srch, dst, w, h);
+    if (c == 3)
+        ncnn::resize_bilinear_c3(src, srcw, srch, dst, w, h);
+    if (c == 4)
+        ncnn::resize_bilinear_c4(src, srcw, srch, dst, w, h);
+}
+
+static int test_mat_pixel_simd_resize(int srcw, int srch, int w, int h, int level)
+{
+    for (int c = 1; c <= 4; c++)
+    {
+        std::vector<unsigned char> src = RandomPixels(srcw * srch * c);
+        std::vector<unsigned char> dst0(w * h * c);
+        std::vector<unsigned char> dst1(w * h * c);
+
+        ncnn::set_pixel_simd_level(0);
+        resize_bilinear(c, src.data(), srcw, srch, dst0.data(), w, h);
+        ncnn::set_pixel_simd_level(level);
+        resize_bilinear(c, src.data(), srcw, srch, dst1.data(), w, h);
+
+        if (dst0 != dst1)
+        {
+            fprintf(stderr, "test_mat_pixel_simd_resize failed %dx%d -> %dx%d c=%d level=%d\n", srcw, srch, w, h, c, level);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_simd_warpaffine(int srcw, int srch, int w, int h, float angle, float scale, int type, int level)
+{
+    std::vector<unsigned char> src = RandomPixels(srcw * srch * 3);
+    std::vector<unsigned char> dst0 = RandomPixels(w * h * 3);
+    std::vector<unsigned char> dst1 = dst0;
+
+    float tm[6];
+    ncnn::get_rotation_matrix(angle, scale, srcw / 2, srch / 2, tm);
+
+    ncnn::set_pixel_simd_level(0);
+    ncnn::warpaffine_bilinear_c3(src.data(), srcw, srch, dst0.data(), w, h, tm, type, 0x00804020);
+    ncnn::set_pixel_simd_level(level);
+    ncnn::warpaffine_bilinear_c3(src.data(), srcw, srch, dst1.data(), w, h, tm, type, 0x00804020);
+
+    if (dst0 != dst1)
+    {
+        fprintf(stderr, "test_mat_pixel_simd_warpaffine failed %dx%d -> %dx%d angle=%f scale=%f type=%d level=%d\n", srcw, srch, w, h, angle, scale, type, level);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_mat_pixel_simd(int level)
+{
+    return 0
+           || test_mat_pixel_simd_from_pixels(1, 1, level)
+           || test_mat_pixel_simd_from_pixels(15, 7, level)
+           || test_mat_pixel_simd_from_pixels(64, 33, level)
+           || test_mat_pixel_simd_from_pixels(320, 48, level)
+           || test_mat_pixel_simd_resize(5, 7, 3, 2, level)
+           || test_mat_pixel_simd_resize(31, 17, 67, 35, level)
+           || test_mat_pixel_simd_resize(640, 480, 320, 48, level)
+           || test_mat_pixel_simd_resize(100, 32, 321, 48, level)
+           || test_mat_pixel_simd_warpaffine(64, 48, 64, 48, 0.f, 1.f, 0, level)
+           || test_mat_pixel_simd_warpaffine(127, 63, 100, 80, 17.f, 0.8f, 0, level)
+           || test_mat_pixel_simd_warpaffine(127, 63, 100, 80, -33.f, 1.7f, -233, level)
+           || test_mat_pixel_simd_warpaffine(320, 240, 333, 250, 5.f, 1.1f, 1, level);
+}
+
+int main()
+{
+    SRAND(7767517);
+
+    const int max_level = ncnn::get_pixel_simd_level();
+
+    int ret = 0;
+    for (int level = 1; level <= max_level && ret == 0; level++)
+    {
+        ret = test_mat_pixel_simd(level);
+    }
+
+    ncnn::set_pixel_simd_level(-1);
+
+    return ret;
+}
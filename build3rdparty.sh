@@ -23,9 +23,10 @@ cd ../../..
 fi
 
 #build ncnn
-if [ ! -f "3rdparty/ncnn/build/install/lib/libncnn.a" ]; then
+#NCNN_SIMPLEOMP: ncnn layers run parallel loops on the TaskScheduler
+if ! grep -qs "NCNN_SIMPLEOMP 1" "3rdparty/ncnn/build/install/include/ncnn/platform.h"; then
 cd 3rdparty/ncnn
 rm -rf build && mkdir build && cd build
-cmake -DNCNN_C_API=OFF -DNCNN_BUILD_BENCHMARK=OFF -DNCNN_BUILD_TOOLS=OFF -DNCNN_BUILD_EXAMPLES=OFF -DNCNN_MSA=OFF -DNCNN_MMI=ON ..
+cmake -DNCNN_C_API=OFF -DNCNN_BUILD_BENCHMARK=OFF -DNCNN_BUILD_TOOLS=OFF -DNCNN_BUILD_EXAMPLES=OFF -DNCNN_MSA=OFF -DNCNN_MMI=ON -DNCNN_SIMPLEOMP=ON ..
 make -j$JOBS && make install
 fi
@@ -21,6 +21,12 @@
 #include "ocrapplication.h"
 #include "service/ocrinterface.h"
 #include "service/dbusocr_adaptor.h"
+#include "service/watchfolder.h"
+#include "service/httpserver.h"
+#include "service/workerfarm.h"
+#include "service/batchrunner.h"
+#include "paddleocr-ncnn/paddleocr.h"
+#include "paddleocr-ncnn/metrics.h"
 
 #include <QWidget>
 //#include <QLog>
@@ -33,6 +39,11 @@
 #include <QDBusConnection>
 #include <QDBusInterface>
 #include <QDesktopWidget>
+#include <QFile>
+#include <QThread>
+#include <QTimer>
+
+#include <unistd.h>
 
 //判断是否是wayland
 bool CheckWayland()
@@ -48,9 +59,44 @@ bool CheckWayland()
     }
 }
 
-int main(int argc, char *argv[])
+//HTTP服务的识别入口，在连接线程中解码图片
+static bool recognizeImage(const std::string &data, std::string &text)
 {
+    QImage image = QImage::fromData(reinterpret_cast<const uchar *>(data.data()), static_cast<int>(data.size()));
+    if (image.isNull()) {
+        return false;
+    }
+    text = PaddleOCRApp::instance()->getRecogitionResult(image).toStdString();
+    return true;
+}
 
+//unix:<路径> 监听Unix域套接字；[<主机>:]<端口> 监听TCP，主机默认只绑定本机
+static bool listenServer(OcrHttpServer &server, const QString &address)
+{
+    if (address.startsWith("unix:")) {
+        return server.listenUnix(QFile::encodeName(address.mid(5)).toStdString());
+    }
+    int colon = address.lastIndexOf(':');
+    QString host = colon > 0 ? address.left(colon) : QString("127.0.0.1");
+    if (host.startsWith('[') && host.endsWith(']')) {
+        host = host.mid(1, host.size() - 2);
+    }
+    bool ok = false;
+    int port = address.mid(colon + 1).toInt(&ok);
+    return ok && server.listenTcp(host.toStdString(), port);
+}
+
+int main(int argc, char *argv[])
+{
+#if defined(_OPENMP) && !defined(__clang__)
+    //GCC的libgomp在程序加载时就读取了空闲线程的等待策略，运行中不能再改，ncnn的openmp_blocktime也不起作用；
+    //用户都没有指定时限制自旋次数后重新执行本程序：层与层之间的短暂空档仍然自旋，请求结束后线程很快休眠。
+    //多进程识别的工作进程继承同样的环境
+    if (!qEnvironmentVariableIsSet("OMP_WAIT_POLICY") && !qEnvironmentVariableIsSet("GOMP_SPINCOUNT")) {
+        qputenv("GOMP_SPINCOUNT", "10000");
+        execv("/proc/self/exe", argv); //失败时按libgomp缺省的策略继续运行
+    }
+#endif
 
     //判断是否是wayland
     if (CheckWayland()) {
@@ -65,22 +111,194 @@ int main(int argc, char *argv[])
 //#else
 //    QScopedPointer<DApplication> app(DApplication::globalApplication(argc, argv));
 //#endif
-    QApplication app(argc, argv);
-    app.setOrganizationName("lingmoos");
-    app.setApplicationName("lingmo-ocr");
+    //监视目录、HTTP服务、批量识别和多进程识别的工作进程都不需要界面，没有图形环境时也能运行
+    bool headless = false;
+    for (int i = 1; i < argc; i++) {
+        QString arg(argv[i]);
+        if (arg.startsWith("--watch") || arg.startsWith("--serve") || arg.startsWith("--batch") || arg.startsWith("--farm-worker")) {
+            headless = true;
+        }
+    }
+    QScopedPointer<QCoreApplication> app(headless ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
+    app->setOrganizationName("lingmoos");
+    app->setApplicationName("lingmo-ocr");
 //    app.setProductName(QObject::tr("OCR Tool"));
-    app.setApplicationVersion("1.9.9");
+    app->setApplicationVersion("1.9.9");
 
 //    Dtk::Core::DLogManager::registerConsoleAppender();
 //    Dtk::Core::DLogManager::registerFileAppender();
 
     QCommandLineOption dbusOption(QStringList() << "u" << "dbus", "Start  from dbus.");
+    QCommandLineOption watchOption("watch", "Recognize images put into <dir> and write <image>.txt next to them.", "dir");
+    QCommandLineOption workersOption("watch-workers", "Number of images recognized at the same time in watch mode.", "count", "0");
+    QCommandLineOption serveOption("serve", "Serve the HTTP/1.1 OCR API on unix:<path> or [<host>:]<port> (localhost by default).", "address");
+    QCommandLineOption batchOption("batch", "Recognize the images listed in <manifest>, one path per line.", "manifest");
+    QCommandLineOption shardOption("shard", "Only process chunks <index>/<count> of the batch instead of claiming them from the work directory.", "index/count");
+    QCommandLineOption batchDirOption("batch-dir", "Work directory shared by all batch nodes (<manifest>.work by default).", "dir");
+    QCommandLineOption chunkOption("chunk-size", "Number of images per batch chunk, must be the same on all nodes.", "count", "100");
+    QCommandLineOption mergeOption("merge", "Merge the results of all batch chunks into <output> as JSON lines.", "output");
+    QCommandLineOption farmOption("workers", "Recognize in <count> worker processes in watch, serve or batch mode.", "count", "0");
+    QCommandLineOption farmWorkerOption("farm-worker", "Run as a worker process on the shared memory <fd>.", "fd");
+    QCommandLineOption metricsFileOption("metrics-file", "Write engine metrics in Prometheus text format to <path> every few seconds.", "path");
+    QCommandLineOption lexiconOption("lexicon", "Constrain each recognized line to one entry of <file>, one entry per line.", "file");
+    farmWorkerOption.setFlags(QCommandLineOption::HiddenFromHelp);
     QCommandLineParser cmdParser;
     cmdParser.setApplicationDescription("lingmo-Ocr");
     cmdParser.addHelpOption();
     cmdParser.addVersionOption();
     cmdParser.addOption(dbusOption);
-    cmdParser.process(app);
+    cmdParser.addOption(watchOption);
+    cmdParser.addOption(workersOption);
+    cmdParser.addOption(serveOption);
+    cmdParser.addOption(batchOption);
+    cmdParser.addOption(shardOption);
+    cmdParser.addOption(batchDirOption);
+    cmdParser.addOption(chunkOption);
+    cmdParser.addOption(mergeOption);
+    cmdParser.addOption(farmOption);
+    cmdParser.addOption(farmWorkerOption);
+    cmdParser.addOption(metricsFileOption);
+    cmdParser.addOption(lexiconOption);
+    cmdParser.process(*app);
+
+    //词表在加载模型后设置，之后切换语言和重新加载模型都会保留
+    QString lexiconPath = cmdParser.value(lexiconOption);
+    auto applyLexicon = [&lexiconPath]() {
+        return lexiconPath.isEmpty() || PaddleOCRApp::instance()->setLexicon(lexiconPath);
+    };
+
+    //多进程识别的工作进程：由主进程启动，识别共享内存中的图片
+    if (cmdParser.isSet(farmWorkerOption)) {
+        PaddleOCRApp::instance();
+        if (!applyLexicon()) {
+            return 1;
+        }
+        return WorkerFarm::runWorker(cmdParser.value(farmWorkerOption).toInt(), recognizeImage, []() {
+            return EngineMetrics::instance()->snapshot().encode();
+        });
+    }
+
+    //运行指标定期写成Prometheus文本文件，例如交给node_exporter的textfile采集器读取
+    //多进程识别时本进程只记录监视目录等分发端的指标，识别引擎的指标由工作进程上报后合并
+    QScopedPointer<WorkerFarm> farm;
+    auto metricsText = [&farm]() {
+        EngineMetrics::Snapshot snapshot = EngineMetrics::instance()->snapshot();
+        if (farm) {
+            for (const std::string &report : farm->reports()) {
+                EngineMetrics::Snapshot worker;
+                if (EngineMetrics::Snapshot::decode(report, worker)) {
+                    snapshot.merge(worker);
+                }
+            }
+        }
+        return EngineMetrics::prometheusText(snapshot);
+    };
+    std::string metricsPath = QFile::encodeName(cmdParser.value(metricsFileOption)).toStdString();
+    auto writeMetrics = [metricsPath, metricsText]() {
+        if (!metricsPath.empty() && !EngineMetrics::writeTextFile(metricsPath, metricsText())) {
+            qWarning() << "failed to write metrics to" << QString::fromStdString(metricsPath);
+        }
+    };
+    QTimer metricsTimer;
+    if (!metricsPath.empty()) {
+        QObject::connect(&metricsTimer, &QTimer::timeout, writeMetrics);
+        metricsTimer.start(5000);
+    }
+
+    //无界面的服务模式，监视目录和HTTP服务可以同时开启
+    if (cmdParser.isSet(watchOption) || cmdParser.isSet(serveOption) || cmdParser.isSet(batchOption)) {
+        //指定了工作进程数时，本进程只负责分发，不加载模型
+        std::function<bool(const std::string &, std::string &)> recognize = recognizeImage;
+        WorkerFarmOptions farmOptions;
+        int watchWorkers = cmdParser.value(workersOption).toInt();
+        if (cmdParser.value(farmOption).toInt() > 0) {
+            farmOptions.workers = cmdParser.value(farmOption).toInt();
+            //退出的工作进程的计数并入本进程，重启后导出的计数不会倒退
+            farmOptions.reportRetired = [](const std::string &report) {
+                EngineMetrics::Snapshot snapshot;
+                if (EngineMetrics::Snapshot::decode(report, snapshot)) {
+                    EngineMetrics::instance()->absorb(snapshot);
+                }
+            };
+            std::vector<std::string> workerArguments = {"--farm-worker", "3"};
+            if (!lexiconPath.isEmpty()) {
+                workerArguments.push_back("--lexicon");
+                workerArguments.push_back(QFile::encodeName(lexiconPath).toStdString());
+            }
+            farm.reset(new WorkerFarm("/proc/self/exe", workerArguments, farmOptions));
+            if (!farm->start()) {
+                qWarning() << "failed to start worker processes";
+                return 1;
+            }
+            WorkerFarm *workerFarm = farm.data();
+            recognize = [workerFarm](const std::string &image, std::string &text) {
+                return workerFarm->recognize(image, text);
+            };
+            //监视目录同时提交的图片数要能填满所有工作进程的槽
+            if (watchWorkers <= 0) {
+                watchWorkers = farmOptions.workers * farmOptions.slotsPerWorker;
+            }
+        } else {
+            PaddleOCRApp::instance(); //先加载模型再开始接受请求
+            if (!applyLexicon()) {
+                return 1;
+            }
+        }
+
+        //批量识别：多台机器共享工作目录即可分担同一份清单，处理完后退出
+        if (cmdParser.isSet(batchOption)) {
+            BatchOptions batchOptions;
+            batchOptions.manifest = QFile::encodeName(cmdParser.value(batchOption)).toStdString();
+            batchOptions.workDir = QFile::encodeName(cmdParser.value(batchDirOption)).toStdString();
+            batchOptions.chunkSize = static_cast<size_t>(qMax(1, cmdParser.value(chunkOption).toInt()));
+            batchOptions.parallel = watchWorkers > 0 ? watchWorkers : QThread::idealThreadCount();
+            if (cmdParser.isSet(shardOption)) {
+                QStringList shard = cmdParser.value(shardOption).split('/');
+                bool indexOk = false, countOk = false;
+                batchOptions.shardIndex = shard.value(0).toInt(&indexOk);
+                batchOptions.shardCount = shard.value(1).toInt(&countOk);
+                if (shard.size() != 2 || !indexOk || !countOk) {
+                    qWarning() << "invalid shard" << cmdParser.value(shardOption);
+                    return 1;
+                }
+            }
+            BatchRunner runner(batchOptions, recognize);
+            int chunks = runner.run();
+            if (chunks < 0) {
+                return 1;
+            }
+            qInfo() << "processed" << chunks << "chunks";
+            writeMetrics();
+            if (cmdParser.isSet(mergeOption) && !runner.merge(QFile::encodeName(cmdParser.value(mergeOption)).toStdString())) {
+                return 1;
+            }
+            return 0;
+        }
+
+        QScopedPointer<WatchFolder> watchFolder;
+        if (cmdParser.isSet(watchOption)) {
+            watchFolder.reset(new WatchFolder(cmdParser.value(watchOption), watchWorkers));
+            if (farm) {
+                watchFolder->setRecognizer(recognize);
+            }
+            if (!watchFolder->start()) {
+                return 1;
+            }
+        }
+        QScopedPointer<OcrHttpServer> server;
+        if (cmdParser.isSet(serveOption)) {
+            OcrHttpServerOptions serverOptions;
+            serverOptions.metrics = metricsText;
+            //同时识别的请求数与引擎的并行能力一致：多进程时为所有工作进程的槽数，否则为线程数
+            serverOptions.maxRecognitions = farm ? farmOptions.workers * farmOptions.slotsPerWorker : QThread::idealThreadCount();
+            server.reset(new OcrHttpServer(recognize, serverOptions));
+            if (!listenServer(*server, cmdParser.value(serveOption))) {
+                qWarning() << "failed to listen on" << cmdParser.value(serveOption);
+                return 1;
+            }
+        }
+        return app->exec();
+    }
 
 //    app->loadTranslator();
 
@@ -94,9 +312,15 @@ int main(int argc, char *argv[])
         // 初始化适配器
         new DbusOcrAdaptor(instance);
 
-        if(QString(argv[1]) != "")
+        if (!applyLexicon()) {
+            return 1;
+        }
+
+        //要打开的图片是第一个位置参数，argv[1]可能是选项
+        QString filePath = cmdParser.positionalArguments().value(0);
+        if(filePath != "")
         {
-            instance->openFile(QString(argv[1]));
+            instance->openFile(filePath);
         }
 
     } else {
@@ -105,14 +329,14 @@ int main(int argc, char *argv[])
             // 本进程退退出
             OcrInterface *pOcr = new OcrInterface("com.lingmo.Ocr", "/com/lingmo/Ocr", QDBusConnection::sessionBus(), instance);
             qDebug() << __FUNCTION__ << __LINE__;
-            pOcr->openFile(QString(argv[1]));
+            pOcr->openFile(cmdParser.positionalArguments().value(0));
             delete pOcr;
             return 0;
         }
 
 
 
-    return app.exec();
+    return app->exec();
 }
 
 
@@ -299,6 +299,9 @@ void Ocr::setTextType(const QString &text)
     else if (text == "English"){
          PaddleOCRApp::instance()->setLanguages(PaddleOCRApp::ENG);
     }
+    else if (text == "自动"){
+         PaddleOCRApp::instance()->setLanguages(PaddleOCRApp::AUTO);
+    }
     openImage(m_imgName);
 }
 
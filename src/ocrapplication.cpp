@@ -22,11 +22,20 @@
 #include "ocrapplication.h"
 #include "ocr.h"
 #include "paddleocr-ncnn/paddleocr.h"
+#include "paddleocr-ncnn/metrics.h"
 //#include <DWidgetUtil>
 #include <QDebug>
 #include <QApplication>
 #include <QScreen>
 #include <QDesktopWidget>
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 static OcrApplication * ocrApp =nullptr;
 OcrApplication *OcrApplication::instance()
@@ -42,6 +51,58 @@ OcrApplication::OcrApplication(QObject *parent) : QObject(parent)
     qmlRegisterType<Ocr>("Lingmo.Ocr", 1, 0, "Ocr");
     m_engine.addImportPath(QStringLiteral("qrc:/"));
     m_engine.load(QUrl(QStringLiteral("qrc:/src/qml/main.qml")));
+
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(2000);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &OcrApplication::reloadModels);
+    watchModels();
+}
+
+void OcrApplication::watchModels()
+{
+    //只关心改名移入模型目录的文件：模型应先写到临时文件再改名替换，原地改写的文件可能还没写完，不触发重新加载
+    //目录本身的监视在文件替换后依然有效，重复添加返回同一个监视
+    if (m_inotifyFd < 0) {
+        m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotifyFd < 0) {
+            qWarning() << "failed to watch model directory" << strerror(errno);
+            return;
+        }
+        m_modelNotifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+        connect(m_modelNotifier, &QSocketNotifier::activated, this, &OcrApplication::onModelDirChanged);
+    }
+    QString modelDir = QDir(PaddleOCRApp::modelPath()).absolutePath();
+    if (inotify_add_watch(m_inotifyFd, QFile::encodeName(modelDir).constData(), IN_MOVED_TO | IN_ONLYDIR) < 0) {
+        qWarning() << "failed to watch model directory" << modelDir << strerror(errno);
+    }
+}
+
+void OcrApplication::onModelDirChanged()
+{
+    //读空事件队列，事件内容不重要，有改名移入就等待重新加载
+    alignas(struct inotify_event) char buffer[4096];
+    while (::read(m_inotifyFd, buffer, sizeof(buffer)) > 0) {
+    }
+    m_reloadTimer.start();
+}
+
+bool OcrApplication::reloadModels()
+{
+    watchModels();
+    bool started = PaddleOCRApp::instance()->reloadModels();
+    qDebug() << __FUNCTION__ << __LINE__ << started;
+    //正在加载的模型可能是这次改动之前的文件，等它结束后再加载一次
+    if (!started) {
+        m_reloadTimer.start();
+    }
+    return started;
+}
+
+bool OcrApplication::setLexicon(QString path)
+{
+    bool loaded = PaddleOCRApp::instance()->setLexicon(path);
+    qDebug() << __FUNCTION__ << __LINE__ << path << loaded;
+    return loaded;
 }
 
 bool OcrApplication::openFile(QString filePath)
@@ -55,6 +116,7 @@ bool OcrApplication::openFile(QString filePath)
         }
     } else {
         qDebug() << "正在识别中！";
+        EngineMetrics::instance()->add(EngineMetrics::RequestsDropped);
     }
 
     return bRet;
@@ -71,6 +133,7 @@ void OcrApplication::openImage(QImage image)
             win->openImage(image);
         } else {
             qDebug() << "正在识别中！";
+            EngineMetrics::instance()->add(EngineMetrics::RequestsDropped);
         }
     }
 }
@@ -84,6 +147,7 @@ void OcrApplication::openImageAndName(QImage image, QString imageName)
             win->openImage(image, imageName);
         } else {
             qDebug() << "正在识别中！";
+            EngineMetrics::instance()->add(EngineMetrics::RequestsDropped);
         }
     }
 }
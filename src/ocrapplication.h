@@ -27,6 +27,8 @@
 #include "ocr.h"
 #include <QObject>
 #include <QImage>
+#include <QSocketNotifier>
+#include <QTimer>
 
 class OcrApplication : public QObject
 {
@@ -40,15 +42,28 @@ public:
 
     Q_INVOKABLE void openImageAndName(QImage image, QString imageName);
 
+    //重新加载模型目录下的模型，已有重新加载在进行时返回false
+    Q_INVOKABLE bool reloadModels();
+
+    //设置约束解码的词表文件，路径为空时清除，文件无法打开时返回false
+    Q_INVOKABLE bool setLexicon(QString path);
 
 signals:
 
 public slots:
 
+private slots:
+    void onModelDirChanged();
+
 private:
     explicit OcrApplication(QObject *parent = nullptr);
+    void watchModels();
+
     QQmlApplicationEngine m_engine;
     int m_loadingCount{0};//启动次数
+    int m_inotifyFd{-1};                        //监视模型目录的inotify，有模型改名移入后自动重新加载
+    QSocketNotifier *m_modelNotifier{nullptr};
+    QTimer m_reloadTimer;                       //一次更新通常要替换多个文件，等一段时间没有新变化再加载
 };
 
 #endif // OCRAPPLICATION_H
@@ -0,0 +1,52 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "atomicfile.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+bool replaceFile(const std::string &path, const char *data, size_t size)
+{
+    static std::atomic<unsigned> sequence(0);
+    std::string tempPath = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(sequence++);
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0;
+    while (written < size) {
+        ssize_t ret = write(fd, data + written, size - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            break;
+        }
+        written += static_cast<size_t>(ret);
+    }
+    bool ok = close(fd) == 0 && written == size;
+    if (!ok || rename(tempPath.c_str(), path.c_str()) != 0) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//先写同目录下的临时文件再改名替换，读取方只会看到完整的旧文件或新文件
+//临时文件名带进程号和序号，多个进程或线程同时保存同一个文件时互不干扰，最后改名的一方胜出
+bool replaceFile(const std::string &path, const char *data, size_t size);
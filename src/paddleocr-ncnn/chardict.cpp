@@ -0,0 +1,128 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "chardict.h"
+#include "atomicfile.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char dictMagic[8] = {'L', 'O', 'C', 'R', 'D', 'I', 'C', 'T'};
+static const size_t headerSize = sizeof(dictMagic) + 2 * sizeof(uint32_t);
+
+CharDict::CharDict()
+    : m_mapped(nullptr)
+    , m_mappedSize(0)
+    , m_count(0)
+    , m_offsets(nullptr)
+    , m_chars(nullptr)
+{
+}
+
+CharDict::~CharDict()
+{
+    if (m_mapped) {
+        munmap(m_mapped, m_mappedSize);
+    }
+}
+
+CharDict *CharDict::fromEntries(const std::vector<std::string> &entries)
+{
+    //与文件格式相同的布局，保存时直接整块写出
+    uint32_t count = static_cast<uint32_t>(entries.size());
+    uint32_t charsSize = 0;
+    for (const std::string &entry : entries) {
+        charsSize += static_cast<uint32_t>(entry.size());
+    }
+
+    CharDict *dict = new CharDict;
+    dict->m_storage.resize(headerSize + (count + 1) * sizeof(uint32_t) + charsSize);
+    char *base = dict->m_storage.data();
+    memcpy(base, dictMagic, sizeof(dictMagic));
+    memcpy(base + sizeof(dictMagic), &count, sizeof(count));
+    memcpy(base + sizeof(dictMagic) + sizeof(count), &charsSize, sizeof(charsSize));
+
+    uint32_t *offsets = reinterpret_cast<uint32_t *>(base + headerSize);
+    char *chars = base + headerSize + (count + 1) * sizeof(uint32_t);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        offsets[i] = offset;
+        memcpy(chars + offset, entries[i].data(), entries[i].size());
+        offset += static_cast<uint32_t>(entries[i].size());
+    }
+    offsets[count] = offset;
+
+    dict->m_count = count;
+    dict->m_offsets = offsets;
+    dict->m_chars = chars;
+    return dict;
+}
+
+CharDict *CharDict::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    void *mapped = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= headerSize) {
+        mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return nullptr;
+    }
+
+    //校验魔数、长度和偏移表，损坏的文件直接放弃
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    const char *base = static_cast<const char *>(mapped);
+    uint32_t count, charsSize;
+    memcpy(&count, base + sizeof(dictMagic), sizeof(count));
+    memcpy(&charsSize, base + sizeof(dictMagic) + sizeof(count), sizeof(charsSize));
+    size_t expected = headerSize + (static_cast<size_t>(count) + 1) * sizeof(uint32_t) + charsSize;
+    const uint32_t *offsets = reinterpret_cast<const uint32_t *>(base + headerSize);
+    bool valid = memcmp(base, dictMagic, sizeof(dictMagic)) == 0 && expected == fileSize && offsets[count] == charsSize;
+    for (uint32_t i = 0; valid && i < count; i++) {
+        valid = offsets[i] <= offsets[i + 1];
+    }
+    if (!valid) {
+        munmap(mapped, fileSize);
+        return nullptr;
+    }
+
+    CharDict *dict = new CharDict;
+    dict->m_mapped = mapped;
+    dict->m_mappedSize = fileSize;
+    dict->m_count = count;
+    dict->m_offsets = offsets;
+    dict->m_chars = base + headerSize + (count + 1) * sizeof(uint32_t);
+    return dict;
+}
+
+bool CharDict::save(const std::string &path) const
+{
+    const char *base = m_chars - headerSize - (m_count + 1) * sizeof(uint32_t);
+    size_t size = headerSize + (m_count + 1) * sizeof(uint32_t) + m_offsets[m_count];
+
+    return replaceFile(path, base, size);
+}
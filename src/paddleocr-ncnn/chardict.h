@@ -0,0 +1,69 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//识别字典：所有字符的UTF-8编码连续存放在一整块内存中，另有一张偏移表
+//预编译的二进制字典文件直接mmap使用，不再为每个字符单独分配字符串
+//文件格式（小端）：8字节魔数 "LOCRDICT"，uint32 字符数n，uint32 字符数据长度，uint32 偏移表[n+1]，字符数据
+class CharDict
+{
+public:
+    CharDict();
+    ~CharDict();
+    CharDict(const CharDict &) = delete;
+    CharDict &operator=(const CharDict &) = delete;
+
+    //由逐行读出的字符构建
+    static CharDict *fromEntries(const std::vector<std::string> &entries);
+
+    //mmap预编译的二进制字典，失败返回nullptr
+    static CharDict *open(const std::string &path);
+
+    //写出二进制字典，先写临时文件再改名
+    bool save(const std::string &path) const;
+
+    size_t size() const
+    {
+        return m_count;
+    }
+
+    //第index个字符的UTF-8编码，越界时为空
+    const char *data(size_t index) const
+    {
+        return index < m_count ? m_chars + m_offsets[index] : m_chars;
+    }
+
+    size_t length(size_t index) const
+    {
+        return index < m_count ? m_offsets[index + 1] - m_offsets[index] : 0;
+    }
+
+private:
+    std::vector<char> m_storage; //由文本构建时持有的数据
+    void *m_mapped;              //mmap得到的数据
+    size_t m_mappedSize;
+
+    size_t m_count;
+    const uint32_t *m_offsets;
+    const char *m_chars;
+};
@@ -0,0 +1,209 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "convtuner.h"
+#include "atomicfile.h"
+#include "metrics.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// ncnn
+#include "benchmark.h"
+#include "cpu.h"
+#include "layer.h"
+#include "layer_type.h"
+#include "net.h"
+
+//featmask中关闭sgemm和winograd的位，与ncnn::Net::set_layer_featmask一致
+static const int NO_SGEMM = 1 << 5;
+static const int NO_WINOGRAD = 1 << 6;
+
+ConvTuner::ConvTuner(ncnn::Net *net, const std::string &cachePath, const std::string &modelId)
+    : m_net(net)
+    , m_cachePath(cachePath)
+    , m_modelId(modelId)
+{
+    loadCache();
+}
+
+std::string ConvTuner::cacheKey(const ncnn::Mat &input) const
+{
+    //输入尺寸按面积取2的整数次幂分档，避免每种页面尺寸都调优一次
+    int areaLevel = static_cast<int>(std::lround(std::log2(std::max(1, input.w * input.h))));
+
+    std::ostringstream key;
+    key << "model" << m_modelId
+        << "-avx" << (ncnn::cpu_support_x86_avx() != 0)
+        << "-fma" << (ncnn::cpu_support_x86_fma() != 0)
+        << "-avx2" << (ncnn::cpu_support_x86_avx2() != 0)
+        << "-avx512" << (ncnn::cpu_support_x86_avx512() != 0)
+        << "-neon" << (ncnn::cpu_support_arm_neon() != 0)
+        << "-t" << m_net->opt.num_threads
+        << "-area" << areaLevel;
+    return key.str();
+}
+
+std::shared_lock<std::shared_timed_mutex> ConvTuner::prepare(const ncnn::Mat &input, bool recordMetrics)
+{
+    std::string key = cacheKey(input);
+    {
+        std::shared_lock<std::shared_timed_mutex> reader(m_lock);
+        if (key == m_appliedKey) {
+            if (recordMetrics) {
+                EngineMetrics::instance()->add(EngineMetrics::ConvTuneHits);
+            }
+            return reader;
+        }
+    }
+
+    {
+        std::unique_lock<std::shared_timed_mutex> writer(m_lock);
+        if (key != m_appliedKey) {
+            auto it = m_cache.find(key);
+            if (it == m_cache.end()) {
+                if (recordMetrics) {
+                    EngineMetrics::instance()->add(EngineMetrics::ConvTuneMisses);
+                }
+                it = m_cache.insert(std::make_pair(key, tune(input))).first;
+                saveCache();
+            } else if (recordMetrics) {
+                EngineMetrics::instance()->add(EngineMetrics::ConvTuneHits);
+            }
+            apply(it->second);
+            m_appliedKey = key;
+        }
+    }
+
+    return std::shared_lock<std::shared_timed_mutex>(m_lock);
+}
+
+std::map<int, int> ConvTuner::tune(const ncnn::Mat &input)
+{
+    std::map<int, int> choices;
+    if (m_net->input_indexes().empty() || m_net->output_indexes().empty()) {
+        return choices;
+    }
+
+    //1.完整跑一遍并保留全部中间结果，拿到每个卷积层的真实输入
+    ncnn::Extractor extractor = m_net->create_extractor();
+    extractor.set_light_mode(false);
+    extractor.input(m_net->input_indexes().front(), input);
+    ncnn::Mat out;
+    extractor.extract(m_net->output_indexes().front(), out);
+
+    //2.逐层尝试各种实现，默认实现只有在被明显超过时才替换，避免计时抖动带来的来回切换
+    const int candidates[] = {0, NO_WINOGRAD, NO_SGEMM, NO_WINOGRAD | NO_SGEMM};
+    const std::vector<ncnn::Layer *> &layers = m_net->layers();
+    for (size_t i = 0; i < layers.size(); i++) {
+        const ncnn::Layer *layer = layers[i];
+        if (layer->typeindex != ncnn::LayerType::Convolution || !layer->one_blob_only) {
+            continue;
+        }
+
+        ncnn::Mat bottom;
+        if (extractor.extract(layer->bottoms[0], bottom, 1) != 0) {
+            continue;
+        }
+
+        int layerIndex = static_cast<int>(i);
+        int bestMask = 0;
+        double bestTime = 0;
+        for (int mask : candidates) {
+            if (m_net->set_layer_featmask(layerIndex, mask) != 0) {
+                continue;
+            }
+
+            ncnn::Mat top;
+            if (m_net->forward_layer(layerIndex, bottom, top) != 0) { //预热
+                continue;
+            }
+            double time = 0;
+            for (int round = 0; round < 3; round++) {
+                double start = ncnn::get_current_time();
+                m_net->forward_layer(layerIndex, bottom, top);
+                double cost = ncnn::get_current_time() - start;
+                time = round == 0 ? cost : std::min(time, cost);
+            }
+
+            if (mask == 0 || time < bestTime * 0.95) {
+                bestMask = mask;
+                bestTime = time;
+            }
+        }
+
+        m_net->set_layer_featmask(layerIndex, bestMask);
+        choices[layerIndex] = bestMask;
+    }
+
+    return choices;
+}
+
+void ConvTuner::apply(const std::map<int, int> &choices)
+{
+    const std::vector<ncnn::Layer *> &layers = m_net->layers();
+    for (size_t i = 0; i < layers.size(); i++) {
+        if (layers[i]->typeindex != ncnn::LayerType::Convolution) {
+            continue;
+        }
+        auto it = choices.find(static_cast<int>(i));
+        m_net->set_layer_featmask(static_cast<int>(i), it == choices.end() ? 0 : it->second);
+    }
+}
+
+void ConvTuner::loadCache()
+{
+    //每行一条：缓存键 层序号:featmask 层序号:featmask ...
+    std::ifstream file(m_cachePath);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string key;
+        if (!(stream >> key)) {
+            continue;
+        }
+
+        std::map<int, int> choices;
+        int layerIndex, mask;
+        char separator;
+        while (stream >> layerIndex >> separator >> mask) {
+            choices[layerIndex] = mask;
+        }
+        m_cache[key] = choices;
+    }
+}
+
+void ConvTuner::saveCache() const
+{
+    if (m_cachePath.empty()) {
+        return;
+    }
+
+    //多个进程或者新旧两个引擎可能同时保存，各自写临时文件再改名，避免写坏缓存
+    std::ostringstream text;
+    for (const auto &entry : m_cache) {
+        text << entry.first;
+        for (const auto &choice : entry.second) {
+            text << ' ' << choice.first << ':' << choice.second;
+        }
+        text << '\n';
+    }
+    std::string data = text.str();
+    replaceFile(m_cachePath, data.data(), data.size());
+}
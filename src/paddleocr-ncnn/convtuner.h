@@ -0,0 +1,56 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+
+namespace ncnn {
+class Net;
+class Mat;
+}
+
+//卷积实现自动调优：对网络中的每个卷积层分别计时winograd、sgemm和直接卷积几种实现，选出最快的，
+//结果按模型、CPU特性、线程数和输入尺寸档位缓存到文件中，之后同样条件下直接复用
+class ConvTuner
+{
+public:
+    //modelId标识网络对应的模型，模型更换后旧的调优结果不再匹配；不能含空白字符
+    ConvTuner(ncnn::Net *net, const std::string &cachePath, const std::string &modelId);
+
+    //推理前调用：切换到该输入尺寸对应的最优实现，没有缓存时现场调优并写入缓存
+    //返回的锁需要在推理期间一直持有，避免推理过程中被其他线程切换实现
+    //recordMetrics为false时不计入引擎指标，用于预热
+    std::shared_lock<std::shared_timed_mutex> prepare(const ncnn::Mat &input, bool recordMetrics = true);
+
+private:
+    std::string cacheKey(const ncnn::Mat &input) const;
+    std::map<int, int> tune(const ncnn::Mat &input);
+    void apply(const std::map<int, int> &choices);
+    void loadCache();
+    void saveCache() const;
+
+    ncnn::Net *m_net;
+    std::string m_cachePath;
+    std::string m_modelId;
+    std::map<std::string, std::map<int, int> > m_cache; //缓存键 -> (层序号 -> featmask)
+    std::string m_appliedKey;
+    std::shared_timed_mutex m_lock;
+};
@@ -0,0 +1,377 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ctcdecoder.h"
+#include "chardict.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+void ctcTopK(const float *row, int count, int k, CtcCandidate *out)
+{
+    //k很小，插入排序即可，扫描一遍的开销与argmax相当
+    int filled = 0;
+    for (int i = 0; i < count; i++) {
+        float prob = row[i];
+        if (filled == k && prob <= out[k - 1].prob) {
+            continue;
+        }
+        int j = filled < k ? filled++ : k - 1;
+        while (j > 0 && out[j - 1].prob < prob) {
+            out[j] = out[j - 1];
+            --j;
+        }
+        out[j] = {i, prob};
+    }
+    for (int j = filled; j < k; j++) {
+        out[j] = {0, 0.0f};
+    }
+}
+
+static size_t utf8Length(unsigned char lead)
+{
+    if ((lead & 0xE0) == 0xC0) {
+        return 2;
+    }
+    if ((lead & 0xF0) == 0xE0) {
+        return 3;
+    }
+    if ((lead & 0xF8) == 0xF0) {
+        return 4;
+    }
+    return 1;
+}
+
+static bool isAsciiDigit(const std::string &ch)
+{
+    return ch.size() == 1 && ch[0] >= '0' && ch[0] <= '9';
+}
+
+static bool isAsciiAlpha(const std::string &ch)
+{
+    return ch.size() == 1 && ((ch[0] >= 'a' && ch[0] <= 'z') || (ch[0] >= 'A' && ch[0] <= 'Z'));
+}
+
+CtcLexicon::CtcLexicon(const std::vector<std::string> &entries, const CharDict &dict)
+    : m_dictSize(static_cast<uint32_t>(dict.size()))
+    , m_classWords((dict.size() + 63) / 64)
+    , m_entryCount(0)
+{
+    //字到字典下标，跳过0号的空白占位符
+    std::vector<std::string> chars(m_dictSize);
+    std::unordered_map<std::string, uint32_t> index;
+    for (uint32_t i = 1; i < m_dictSize; i++) {
+        chars[i].assign(dict.data(i), dict.length(i));
+        index.emplace(chars[i], i);
+    }
+
+    //字符类按写法去重，每个类一张覆盖整个字典的位图；空的类返回-1
+    std::map<std::string, int> classIds;
+    auto classOf = [&](const std::string &key, const std::function<bool(const std::string &)> &member) {
+        auto it = classIds.find(key);
+        if (it != classIds.end()) {
+            return it->second;
+        }
+        int id = static_cast<int>(m_classBits.size() / m_classWords);
+        std::vector<uint64_t> bits(m_classWords, 0);
+        bool empty = true;
+        for (uint32_t i = 1; i < m_dictSize; i++) {
+            if (member(chars[i])) {
+                bits[i >> 6] |= uint64_t(1) << (i & 63);
+                empty = false;
+            }
+        }
+        if (empty) {
+            id = -1;
+        } else {
+            m_classBits.insert(m_classBits.end(), bits.begin(), bits.end());
+        }
+        classIds[key] = id;
+        return id;
+    };
+
+    //每一项解析成边的序列，边的编号与Edge::label相同
+    auto parse = [&](const std::string &entry, std::vector<uint32_t> &labels) {
+        size_t pos = 0;
+        while (pos < entry.size()) {
+            if (entry[pos] == '\\' && pos + 1 < entry.size()) {
+                char escape = entry[pos + 1];
+                int id = -2;
+                if (escape == 'd') {
+                    id = classOf("\\d", isAsciiDigit);
+                } else if (escape == 'a') {
+                    id = classOf("\\a", isAsciiAlpha);
+                } else if (escape == 'w') {
+                    id = classOf("\\w", [](const std::string &ch) {
+                        return isAsciiDigit(ch) || isAsciiAlpha(ch);
+                    });
+                }
+                if (id == -1) {
+                    return false;
+                }
+                if (id >= 0) {
+                    labels.push_back(m_dictSize + static_cast<uint32_t>(id));
+                    pos += 2;
+                    continue;
+                }
+                ++pos; //其余的转义表示字符本身
+            } else if (entry[pos] == '[') {
+                size_t close = entry.find(']', pos + 1);
+                if (close == std::string::npos) {
+                    return false;
+                }
+                std::vector<std::string> members;
+                std::vector<std::pair<char, char>> ranges;
+                size_t i = pos + 1;
+                while (i < close) {
+                    size_t length = utf8Length(static_cast<unsigned char>(entry[i]));
+                    if (length == 1 && i + 2 < close && entry[i + 1] == '-') {
+                        ranges.emplace_back(entry[i], entry[i + 2]);
+                        i += 3;
+                    } else {
+                        members.push_back(entry.substr(i, length));
+                        i += length;
+                    }
+                }
+                int id = classOf(entry.substr(pos, close - pos + 1), [&members, &ranges](const std::string &ch) {
+                    for (const auto &range : ranges) {
+                        if (ch.size() == 1 && ch[0] >= range.first && ch[0] <= range.second) {
+                            return true;
+                        }
+                    }
+                    return std::find(members.begin(), members.end(), ch) != members.end();
+                });
+                if (id < 0) {
+                    return false;
+                }
+                labels.push_back(m_dictSize + static_cast<uint32_t>(id));
+                pos = close + 1;
+                continue;
+            }
+
+            size_t length = utf8Length(static_cast<unsigned char>(entry[pos]));
+            auto it = index.find(entry.substr(pos, length));
+            if (it == index.end()) {
+                return false;
+            }
+            labels.push_back(it->second);
+            pos += length;
+        }
+        return true;
+    };
+
+    //先用有序的map建树，合并公共前缀，再压平成连续的边表
+    std::vector<std::map<uint32_t, uint32_t>> children(1);
+    m_accepting.assign(1, 0);
+    std::vector<uint32_t> labels;
+    for (const std::string &entry : entries) {
+        labels.clear();
+        if (!parse(entry, labels)) {
+            continue;
+        }
+        uint32_t node = 0;
+        for (uint32_t label : labels) {
+            auto it = children[node].find(label);
+            if (it == children[node].end()) {
+                uint32_t child = static_cast<uint32_t>(children.size());
+                children[node].emplace(label, child);
+                children.emplace_back();
+                m_accepting.push_back(0);
+                node = child;
+            } else {
+                node = it->second;
+            }
+        }
+        m_accepting[node] = 1;
+        ++m_entryCount;
+    }
+
+    m_edgeBegin.reserve(children.size() + 1);
+    m_edges.reserve(children.size() - 1);
+    for (const auto &edges : children) {
+        m_edgeBegin.push_back(static_cast<uint32_t>(m_edges.size()));
+        for (const auto &edge : edges) {
+            m_edges.push_back({edge.first, edge.second});
+        }
+    }
+    m_edgeBegin.push_back(static_cast<uint32_t>(m_edges.size()));
+}
+
+namespace {
+
+const float negInf = -std::numeric_limits<float>::infinity();
+
+inline float logAdd(float a, float b)
+{
+    if (a == negInf) {
+        return b;
+    }
+    if (b == negInf) {
+        return a;
+    }
+    return std::max(a, b) + log1pf(expf(-fabsf(a - b)));
+}
+
+//前缀树上的一个节点，前缀只记录父节点和最后一个字，避免每个候选都拷贝字符串
+struct PrefixNode {
+    int parent;
+    int label;
+};
+
+//以空白结尾和以字结尾的对数概率分开累计
+struct Beam {
+    int prefix;
+    uint32_t state;
+    float blank;
+    float nonBlank;
+
+    float total() const
+    {
+        return logAdd(blank, nonBlank);
+    }
+};
+
+}
+
+bool ctcBeamDecode(const std::vector<CtcCandidate> &candidates, int topK, const CtcLexicon &lexicon,
+                   const CharDict &dict, const CtcBeamOptions &options, std::string &text)
+{
+    size_t frames = topK > 0 ? candidates.size() / static_cast<size_t>(topK) : 0;
+
+    std::vector<PrefixNode> prefixes = {{-1, 0}};
+    std::unordered_map<uint64_t, int> prefixChildren;
+    auto extend = [&](int prefix, int label) {
+        uint64_t key = (static_cast<uint64_t>(prefix) << 32) | static_cast<uint32_t>(label);
+        auto it = prefixChildren.find(key);
+        if (it != prefixChildren.end()) {
+            return it->second;
+        }
+        int child = static_cast<int>(prefixes.size());
+        prefixes.push_back({prefix, label});
+        prefixChildren.emplace(key, child);
+        return child;
+    };
+
+    std::vector<Beam> beams = {{0, 0, 0.0f, negInf}};
+    std::vector<Beam> next;
+    std::unordered_map<uint64_t, size_t> nextIndex;
+    auto slot = [&](int prefix, uint32_t state) -> Beam & {
+        uint64_t key = (static_cast<uint64_t>(prefix) << 32) | state;
+        auto it = nextIndex.find(key);
+        if (it != nextIndex.end()) {
+            return next[it->second];
+        }
+        nextIndex.emplace(key, next.size());
+        next.push_back({prefix, state, negInf, negInf});
+        return next.back();
+    };
+
+    for (size_t t = 0; t < frames; t++) {
+        const CtcCandidate *frame = candidates.data() + t * static_cast<size_t>(topK);
+
+        //空白占绝对优势的时间步只做空白转移，忽略重复字的微小概率
+        if (frame[0].label == 0 && frame[0].prob >= options.blankSkip) {
+            float logBlank = logf(frame[0].prob);
+            for (Beam &beam : beams) {
+                beam.blank = beam.total() + logBlank;
+                beam.nonBlank = negInf;
+            }
+            continue;
+        }
+
+        next.clear();
+        nextIndex.clear();
+        for (const Beam &beam : beams) {
+            float total = beam.total();
+            int last = prefixes[static_cast<size_t>(beam.prefix)].label;
+            for (int k = 0; k < topK; k++) {
+                const CtcCandidate &candidate = frame[k];
+                if (candidate.prob < options.minProb) {
+                    break;
+                }
+                float logProb = logf(candidate.prob);
+                if (candidate.label == 0) {
+                    Beam &same = slot(beam.prefix, beam.state);
+                    same.blank = logAdd(same.blank, total + logProb);
+                    continue;
+                }
+
+                //与前缀最后一个字相同：没有空白隔开时合并为同一个字，隔开时才是新的字
+                float from = total + logProb;
+                if (candidate.label == last) {
+                    Beam &same = slot(beam.prefix, beam.state);
+                    same.nonBlank = logAdd(same.nonBlank, beam.nonBlank + logProb);
+                    if (beam.blank == negInf) {
+                        continue;
+                    }
+                    from = beam.blank + logProb;
+                }
+
+                int label = candidate.label;
+                lexicon.forEachNext(beam.state, label, [&](uint32_t target) {
+                    int prefix = extend(beam.prefix, label);
+                    Beam &extended = slot(prefix, target);
+                    extended.nonBlank = logAdd(extended.nonBlank, from);
+                });
+            }
+        }
+
+        if (next.size() > static_cast<size_t>(options.beamWidth)) {
+            std::nth_element(next.begin(), next.begin() + options.beamWidth, next.end(), [](const Beam &a, const Beam &b) {
+                return a.total() > b.total();
+            });
+            next.resize(static_cast<size_t>(options.beamWidth));
+        }
+        beams.swap(next);
+        if (beams.empty()) {
+            return false; //没有任何前缀满足词表
+        }
+    }
+
+    //取被词表接受的最优前缀
+    const Beam *best = nullptr;
+    float bestScore = negInf;
+    for (const Beam &beam : beams) {
+        float score = beam.total();
+        if (lexicon.accepting(beam.state) && (best == nullptr || score > bestScore)) {
+            best = &beam;
+            bestScore = score;
+        }
+    }
+    if (best == nullptr) {
+        return false;
+    }
+
+    std::vector<int> labels;
+    size_t length = 0;
+    for (int prefix = best->prefix; prefix > 0; prefix = prefixes[static_cast<size_t>(prefix)].parent) {
+        int label = prefixes[static_cast<size_t>(prefix)].label;
+        labels.push_back(label);
+        length += dict.length(static_cast<size_t>(label));
+    }
+    text.clear();
+    text.reserve(length);
+    for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+        text.append(dict.data(static_cast<size_t>(*it)), dict.length(static_cast<size_t>(*it)));
+    }
+    return true;
+}
@@ -0,0 +1,124 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CharDict;
+
+//每个时间步保留的候选字符
+struct CtcCandidate {
+    int label;   //字典下标，0为空白
+    float prob;
+};
+
+//取出一行概率中最大的k个，按概率从大到小排列，概率相同时下标小的在前
+void ctcTopK(const float *row, int count, int k, CtcCandidate *out);
+
+//约束词表：由字典下标组成的紧凑字典树，整行识别结果必须是其中的一项
+//每项按UTF-8逐字匹配，另外支持以下字符类，便于描述日期、编号等格式：
+//  \d 数字  \a 英文字母  \w 数字或英文字母  [...] 方括号中的任意一个字，可以写a-z这样的ASCII范围
+//  \\ \[ 表示字符本身
+class CtcLexicon
+{
+public:
+    //字典中不存在的字会使该项无法匹配，这样的项被跳过
+    CtcLexicon(const std::vector<std::string> &entries, const CharDict &dict);
+
+    //成功编译的项数
+    size_t entryCount() const
+    {
+        return m_entryCount;
+    }
+
+    //从state出发经过字label可以到达的状态；同一个字可能同时匹配普通的字和字符类，因此可能有多个
+    template<typename Func>
+    void forEachNext(uint32_t state, int label, Func func) const;
+
+    bool accepting(uint32_t state) const
+    {
+        return m_accepting[state] != 0;
+    }
+
+private:
+    bool inClass(uint32_t classId, int label) const
+    {
+        const uint64_t *bits = m_classBits.data() + classId * m_classWords;
+        return (bits[label >> 6] >> (label & 63)) & 1;
+    }
+
+    struct Edge {
+        uint32_t label;   //小于m_dictSize时为字典下标，否则为字符类编号 + m_dictSize
+        uint32_t target;
+    };
+
+    uint32_t m_dictSize;
+    size_t m_classWords;              //每个字符类的位图占用的uint64个数
+    std::vector<uint64_t> m_classBits;
+    std::vector<uint32_t> m_edgeBegin; //第i个状态的出边为[m_edgeBegin[i], m_edgeBegin[i + 1])，普通的字在前且有序，字符类在后
+    std::vector<Edge> m_edges;
+    std::vector<uint8_t> m_accepting;
+    size_t m_entryCount;
+};
+
+template<typename Func>
+void CtcLexicon::forEachNext(uint32_t state, int label, Func func) const
+{
+    const Edge *begin = m_edges.data() + m_edgeBegin[state];
+    const Edge *end = m_edges.data() + m_edgeBegin[state + 1];
+    const Edge *classBegin = begin;
+    while (classBegin < end && classBegin->label < m_dictSize) {
+        ++classBegin;
+    }
+
+    //普通的字二分查找
+    const Edge *lo = begin;
+    const Edge *hi = classBegin;
+    while (lo < hi) {
+        const Edge *mid = lo + (hi - lo) / 2;
+        if (mid->label < static_cast<uint32_t>(label)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < classBegin && lo->label == static_cast<uint32_t>(label)) {
+        func(lo->target);
+    }
+
+    for (const Edge *edge = classBegin; edge < end; ++edge) {
+        if (inClass(edge->label - m_dictSize, label)) {
+            func(edge->target);
+        }
+    }
+}
+
+//束搜索参数
+struct CtcBeamOptions {
+    int beamWidth = 8;          //每个时间步保留的候选前缀数
+    float blankSkip = 0.999f;   //空白概率不低于该值的时间步只做空白转移，不展开候选字
+    float minProb = 1e-4f;      //低于该概率的候选字不展开
+};
+
+//带词表约束的CTC前缀束搜索
+//candidates: 每个时间步topK个候选，按ctcTopK的顺序连续存放
+//找到被词表接受的结果时返回true，text为解码结果；否则返回false，由调用方回退到贪心解码
+bool ctcBeamDecode(const std::vector<CtcCandidate> &candidates, int topK, const CtcLexicon &lexicon,
+                   const CharDict &dict, const CtcBeamOptions &options, std::string &text);
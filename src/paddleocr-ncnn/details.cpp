@@ -20,27 +20,124 @@
 */
 
 #include "details.h"
+#include "chardict.h"
+#include "convtuner.h"
+#include "ctcdecoder.h"
+#include "memoryplan.h"
+#include "metrics.h"
+#include "neckfusion.h"
+#include "recbatcher.h"
+#include "taskscheduler.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // ncnn
+#include "cpu.h"
 #include "layer.h"
+#include "datareader.h"
 #include "net.h"
 
-#ifdef IN_TEST
-#include <QStandardPaths>
-#endif
+std::vector<cv::Rect> Details::findInkRegions(const cv::Mat &src, const DetailsOptions &options)
+{
+    const int tileSize = 8; //缩略图上每个分块的边长
+
+    //1.生成灰度缩略图
+    float scale = std::min(1.0f, float(std::max(tileSize, options.inkThumbSide)) / std::max(src.cols, src.rows));
+    cv::Mat thumb;
+    cv::resize(src, thumb, cv::Size(std::max(1, int(src.cols * scale)), std::max(1, int(src.rows * scale))), 0, 0, cv::INTER_AREA);
+    cv::cvtColor(thumb, thumb, cv::COLOR_BGR2GRAY);
+
+    //2.逐块统计方差，标记出有内容的分块
+    int tilesX = (thumb.cols + tileSize - 1) / tileSize;
+    int tilesY = (thumb.rows + tileSize - 1) / tileSize;
+    cv::Mat inkMask = cv::Mat::zeros(tilesY, tilesX, CV_8UC1);
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            cv::Rect tile(tx * tileSize, ty * tileSize, tileSize, tileSize);
+            tile &= cv::Rect(0, 0, thumb.cols, thumb.rows);
+            cv::Scalar mean, stddev;
+            cv::meanStdDev(thumb(tile), mean, stddev);
+            if (stddev[0] >= options.inkBlankStdDev) {
+                inkMask.at<unsigned char>(ty, tx) = 255;
+            }
+        }
+    }
+
+    //整页空白，直接返回空结果
+    std::vector<cv::Rect> regions;
+    if (cv::countNonZero(inkMask) == 0) {
+        return regions;
+    }
+
+    //3.向外扩一个分块，避免文字被分块边界切断，然后按连通域得到各个有内容的区域
+    cv::dilate(inkMask, inkMask, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
+    cv::Mat labels, stats, centroids;
+    int count = cv::connectedComponentsWithStats(inkMask, labels, stats, centroids, 8, CV_32S);
+    cv::Rect page(0, 0, src.cols, src.rows);
+    for (int i = 1; i < count; i++) {
+        int x0 = static_cast<int>(stats.at<int>(i, cv::CC_STAT_LEFT) * tileSize / scale);
+        int y0 = static_cast<int>(stats.at<int>(i, cv::CC_STAT_TOP) * tileSize / scale);
+        int x1 = static_cast<int>(ceilf((stats.at<int>(i, cv::CC_STAT_LEFT) + stats.at<int>(i, cv::CC_STAT_WIDTH)) * tileSize / scale));
+        int y1 = static_cast<int>(ceilf((stats.at<int>(i, cv::CC_STAT_TOP) + stats.at<int>(i, cv::CC_STAT_HEIGHT)) * tileSize / scale));
+        regions.push_back(cv::Rect(cv::Point(x0, y0), cv::Point(x1, y1)) & page);
+    }
+
+    //4.合并相互重叠的区域，保证同一处文字只会被检测一次
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < regions.size() && !merged; i++) {
+            for (size_t j = i + 1; j < regions.size(); j++) {
+                if ((regions[i] & regions[j]).area() > 0) {
+                    regions[i] |= regions[j];
+                    regions.erase(regions.begin() + static_cast<long>(j));
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
 
-std::vector<std::vector<std::vector<int>>> Details::detectText(const cv::Mat &src, float thresh, float boxThresh, float unclipRatio)
+    int inkArea = 0;
+    for (const cv::Rect &region : regions) {
+        inkArea += region.area();
+    }
+    if (inkArea > page.area() * options.inkFullPage) {
+        regions.assign(1, page);
+    }
+
+    return regions;
+}
+
+cv::Mat Details::predictTextMap(const cv::Mat &src, int limitSide, float &ratio_h, float &ratio_w)
 {
+    std::shared_ptr<const DetailsOptions> options = std::atomic_load(&currentOptions);
+    EngineMetrics::Timer timer(EngineMetrics::DetectStage, metricsEnabled);
+
     int w = src.cols;
     int h = src.rows;
 
     //1.缩减尺寸
     float ratio = 1.f;
-    if (std::max(w, h) > 960) {
+    if (std::max(w, h) > limitSide) {
         if (h > w) {
-            ratio = 960.0f / h;
+            ratio = float(limitSide) / h;
         } else {
-            ratio = 960.0f / w;
+            ratio = float(limitSide) / w;
         }
     }
 
@@ -66,40 +163,97 @@ std::vector<std::vector<std::vector<int>>> Details::detectText(const cv::Mat &sr
     //执行resize，记录变换比例
     cv::Mat resize_img;
     cv::resize(src, resize_img, cv::Size(resizeW, resizeH));
-    float ratio_h = float(resizeH) / float(h);
-    float ratio_w = float(resizeW) / float(w);
+    ratio_h = float(resizeH) / float(h);
+    ratio_w = float(resizeW) / float(w);
 
     //执行推理
     ncnn::Mat in_pad = ncnn::Mat::from_pixels(resize_img.data, ncnn::Mat::PIXEL_RGB, resizeW, resizeH);
 
-    const float meanValues[3] = { 0.485f * 255, 0.456f * 255, 0.406f * 255 };
-    const float normValues[3] = { 1.0f / 0.229f / 255.0f, 1.0f / 0.224f / 255.0f, 1.0f / 0.225f / 255.0f };
+    in_pad.substract_mean_normalize(detModel.spec.mean, detModel.spec.norm);
 
-    in_pad.substract_mean_normalize(meanValues, normValues);
-    ncnn::Extractor extractor = detNet->create_extractor();
+    //推理期间持有调优锁，防止其他线程切换卷积实现
+    std::shared_lock<std::shared_timed_mutex> tuneLock;
+    if (options->autotune) {
+        tuneLock = detTuner->prepare(in_pad, metricsEnabled);
+    }
 
-    extractor.input(0, in_pad);
-    ncnn::Mat out;
-    extractor.extract(137, out);
+    //同一尺寸的推理按静态内存规划复用一整块内存
+    PlannedAllocator *allocator = nullptr;
+    if (options->memoryPlan) {
+        allocator = detMemoryPlans->acquire(resizeW, resizeH);
+        allocator->begin(resizeW, resizeH);
+    }
 
-    //解码位置数据
-    //注意：thresh, boxThresh, unclipRatio三个参数将极大影响解码效果，进而会影响后面识别网络的输出结果
-    std::vector<float> pred;
-    std::vector<unsigned char> cbuf;
-
-    for (int q = 0; q < out.c; q++) {
-        const float *ptr = out.channel(q);
-        for (int y = 0; y < out.h; y++) {
-            for (int x = 0; x < out.w; x++) {
-                pred.push_back(ptr[x]);
-                cbuf.push_back(static_cast<unsigned char>(ptr[x] * 255.0f));
+    cv::Mat pred_map;
+    {
+        ncnn::Extractor extractor = detModel.net->create_extractor();
+        if (allocator) {
+            extractor.set_blob_allocator(allocator);
+            extractor.set_workspace_allocator(allocator);
+        }
+
+        extractor.input(detModel.inIndex, in_pad);
+        ncnn::Mat out;
+        extractor.extract(detModel.outIndex, out);
+
+        //输出只有一个通道，即每个像素属于文字的概率
+        pred_map = cv::Mat(out.h, out.w, CV_32F, static_cast<float *>(out.channel(0))).clone();
+    }
+
+    if (allocator) {
+        if (allocator->end()) {
+            ++stats.memoryPlanHits;
+            if (metricsEnabled) {
+                EngineMetrics::instance()->add(EngineMetrics::MemoryPlanHits);
+            }
+        } else {
+            ++stats.memoryPlanMisses;
+            if (metricsEnabled) {
+                EngineMetrics::instance()->add(EngineMetrics::MemoryPlanMisses);
             }
-            ptr += out.w;
         }
+        detMemoryPlans->release(allocator);
     }
+    return pred_map;
+}
 
-    cv::Mat cbuf_map(out.h, out.w, CV_8UC1, static_cast<unsigned char *>(cbuf.data()));
-    cv::Mat pred_map(out.h, out.w, CV_32F, static_cast<float *>(pred.data()));
+bool Details::containsText(const cv::Mat &src, float thresh)
+{
+    std::shared_ptr<const DetailsOptions> options = std::atomic_load(&currentOptions);
+    //在很小的缩略图上跑一遍检测网络，整张概率图都没有越过阈值就认为图中没有文字
+    float ratio_h, ratio_w;
+    cv::Mat pred_map = predictTextMap(src, options->textGateSide, ratio_h, ratio_w);
+    double maxProb = 0;
+    cv::minMaxLoc(pred_map, nullptr, &maxProb);
+
+    ++stats.gateChecked;
+    if (maxProb < thresh * options->textGateMargin) {
+        ++stats.gateSkipped;
+        return false;
+    }
+    if (maxProb < thresh) {
+        //概率接近阈值时无法断定，回退到完整检测
+        ++stats.gateEscaped;
+    }
+    return true;
+}
+
+std::vector<Details::TextBox> Details::detectText(const cv::Mat &src, float thresh, float boxThresh, float unclipRatio, int limitSide,
+                                                  const std::function<void(const TextBox &)> &onBox)
+{
+    float ratio_h, ratio_w;
+    cv::Mat pred_map = predictTextMap(src, limitSide, ratio_h, ratio_w);
+
+    //解码位置数据
+    //注意：thresh, boxThresh, unclipRatio三个参数将极大影响解码效果，进而会影响后面识别网络的输出结果
+    cv::Mat cbuf_map(pred_map.rows, pred_map.cols, CV_8UC1);
+    for (int y = 0; y < pred_map.rows; y++) {
+        const float *ptr = pred_map.ptr<float>(y);
+        unsigned char *cbuf = cbuf_map.ptr<unsigned char>(y);
+        for (int x = 0; x < pred_map.cols; x++) {
+            cbuf[x] = static_cast<unsigned char>(ptr[x] * 255.0f);
+        }
+    }
 
     const float threshold = thresh * 255.0f;
     cv::Mat bit_map;
@@ -108,158 +262,869 @@ std::vector<std::vector<std::vector<int>>> Details::detectText(const cv::Mat &sr
     cv::Mat dila_ele = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2, 2));
     cv::dilate(bit_map, dilation_map, dila_ele);
 
-    auto result = postProcessor.BoxesFromBitmap(pred_map, dilation_map, boxThresh, unclipRatio, false);
+    //流水线模式下，每个文本框确定后立即换算回原图坐标并交出去
+    std::function<void(const TextBox &)> onMapBox;
+    if (onBox) {
+        onMapBox = [&](const TextBox &box) {
+            auto mapped = postProcessor.FilterTagDetRes(std::vector<TextBox>(1, box), ratio_h, ratio_w, src);
+            if (!mapped.empty()) {
+                onBox(mapped.front());
+            }
+        };
+    }
+
+    auto result = postProcessor.BoxesFromComponents(pred_map, dilation_map, boxThresh, unclipRatio, onMapBox);
 
     result = postProcessor.FilterTagDetRes(result, ratio_h, ratio_w, src);
 
     return result;
 }
 
-std::string Details::ctcDecode(const std::vector<float> &recNetOutputData, int h, int w)
+std::string Details::ctcDecode(const std::vector<int> &labels, const std::vector<float> &probs, const CharDict &dict, float &score)
 {
+    //CTC特性：0为空白，连续相同即判定为同一个字
+    auto emits = [&labels](size_t i) {
+        return labels[i] > 0 && (i == 0 || labels[i] != labels[i - 1]);
+    };
+
+    //第一遍统计输出长度和置信度，第二遍直接从字典的连续内存中拷贝，每行只分配一次内存
+    size_t length = 0;
+    float probSum = 0;
+    int count = 0;
+    for (size_t i = 0; i < labels.size(); i++) {
+        if (emits(i)) {
+            length += dict.length(static_cast<size_t>(labels[i]));
+            probSum += probs[i];
+            ++count;
+        }
+    }
+
     std::string text;
-    size_t lastIndex = 0;
-    for (int i = 0; i < h; i++) {
-        size_t maxIndex = 0;
-        maxIndex = utilityTool.argmax(recNetOutputData.begin() + i * w, recNetOutputData.begin() + i * w + w);
-        if (maxIndex > 0 && (i == 0 || maxIndex != lastIndex)) { //CTC特性：连续相同即判定为同一个字
-            text.append(keys[static_cast<size_t>(maxIndex)]);
+    text.reserve(length);
+    for (size_t i = 0; i < labels.size(); i++) {
+        if (emits(i)) {
+            size_t index = static_cast<size_t>(labels[i]);
+            text.append(dict.data(index), dict.length(index));
         }
-        lastIndex = maxIndex;
     }
+
+    //置信度：输出的每个字的概率均值，没有输出任何字时视为不可信
+    score = count > 0 ? probSum / count : 0.0f;
     return text;
 }
 
-std::vector<std::string> Details::recognizeTexts(const std::vector<cv::Mat> &detectImg)
+std::vector<std::string> Details::recognizeTexts(const std::vector<cv::Mat> &detectImg, const RecModel &model, std::vector<float> &scores)
 {
+    std::shared_ptr<const DetailsOptions> options = std::atomic_load(&currentOptions);
+    EngineMetrics::Timer timer(EngineMetrics::RecognizeStage, metricsEnabled);
     size_t size = detectImg.size();
     std::vector<std::string> textLines(size);
+    scores.assign(size, 0.0f);
+    //没有文本行时直接返回，下面按分段数分配线程时不能除以0
+    if (size == 0) {
+        return textLines;
+    }
 
-    //带LSTM的模型在外面开多线程加速效果会比在里面开多线程加速好
-    #pragma omp parallel for num_threads(2)
-    for (size_t i = 0; i < size; ++i) {
-        //输入图片固定高度32
+    //词表在本次识别期间保持不变
+    std::shared_ptr<const CtcLexicon> lexicon = std::atomic_load(&model.lexicon);
+    const int topK = std::max(1, options->beamTopK);
+
+    //1.输入图片缩放到模型要求的固定高度
+    const int inputHeight = model.spec.inputHeight;
+    std::vector<cv::Mat> stdMats(size);
+    TaskScheduler *scheduler = TaskScheduler::instance();
+    scheduler->parallelFor(size, [&](size_t i) {
         float ratio = static_cast<float>(detectImg[i].cols) / static_cast<float>(detectImg[i].rows);
-        int imgW = static_cast<int>(32 * ratio);
+        int imgW = static_cast<int>(inputHeight * ratio);
         int resize_w;
-        if (ceilf(32 * ratio) > imgW)
+        if (ceilf(inputHeight * ratio) > imgW)
             resize_w = imgW;
         else
-            resize_w = static_cast<int>(ceilf(32 * ratio));
+            resize_w = static_cast<int>(ceilf(inputHeight * ratio));
 
         cv::Mat stdMat;
-        cv::resize(detectImg[i], stdMat, cv::Size(resize_w, 32), 0, 0, cv::INTER_LINEAR);
+        cv::resize(detectImg[i], stdMat, cv::Size(resize_w, inputHeight), 0, 0, cv::INTER_LINEAR);
         cv::copyMakeBorder(stdMat, stdMat, 0, 0, 0, int(imgW - stdMat.cols), cv::BORDER_CONSTANT, {127, 127, 127});
+        stdMats[i] = stdMat;
 
         //保存传入的检测结果，debug用
         /*static int i = 0;
         char saveStr[7];
         std::sprintf(saveStr, "%d.png", i++);
         cv::imwrite(saveStr, stdMat);*/
+    });
+
+    //2.超长的文本行拆成互相重叠的分段，所有分段一起并行识别，避免单个LSTM串行跑几百个时间步而其他线程空等
+    struct RecSegment {
+        size_t line;               //所属文本行
+        int x0;                    //分段在文本行中的起点
+        int width;                 //分段宽度
+        int keepBegin;             //该分段负责输出的范围，重叠部分从中间一分为二
+        int keepEnd;
+        std::vector<int> labels;   //每个时间步的最大概率下标
+        std::vector<float> probs;  //每个时间步的最大概率
+        std::vector<CtcCandidate> candidates; //约束解码时每个时间步的前topK个候选
+    };
+    std::vector<RecSegment> segments;
+    for (size_t i = 0; i < size; ++i) {
+        int cols = stdMats[i].cols;
+        if (!options->longLineSplit || cols <= options->longLineWidth) {
+            segments.push_back({i, 0, cols, 0, cols, {}, {}, {}});
+            continue;
+        }
+
+        int overlap = options->longLineOverlap;
+        int step = std::max(1, options->longLineSegment - overlap);
+        int x0 = 0;
+        while (x0 + options->longLineSegment < cols) {
+            segments.push_back({i, x0, options->longLineSegment, x0 == 0 ? 0 : x0 + overlap / 2, x0 + options->longLineSegment - overlap / 2, {}, {}, {}});
+            x0 += step;
+        }
+        segments.push_back({i, x0, cols - x0, x0 + overlap / 2, cols, {}, {}, {}});
+
+        ++stats.longLines;
+    }
+    stats.longLineSegments += segments.size() - size;
+
+    //分段之间并行，每个分段内部的层级并行只分到剩余的线程，避免线程数相乘
+    int layerThreads = std::max(1, std::min(model.net->opt.num_threads, scheduler->threadCount() / static_cast<int>(segments.size())));
+    scheduler->parallelFor(segments.size(), [&](size_t j) {
+        RecSegment &segment = segments[j];
+        cv::Mat stdMat = stdMats[segment.line].colRange(segment.x0, segment.x0 + segment.width).clone();
 
         ncnn::Mat input = ncnn::Mat::from_pixels(stdMat.data, ncnn::Mat::PIXEL_RGB, stdMat.cols, stdMat.rows);
-        const float mean_vals[3] = { 127.5, 127.5, 127.5 };
-        const float norm_vals[3] = { 1.0f / 127.5f, 1.0f / 127.5f, 1.0f / 127.5f };
-        input.substract_mean_normalize(mean_vals, norm_vals);
+        input.substract_mean_normalize(model.spec.mean, model.spec.norm);
 
-        ncnn::Extractor extractor = recNet->create_extractor();
-        extractor.input(0, input);
+        ncnn::Extractor extractor = model.net->create_extractor();
+        extractor.set_num_threads(layerThreads);
+        extractor.input(model.inIndex, input);
         ncnn::Mat out;
-        extractor.extract(recOutIndex, out);
+        extractor.extract(model.outIndex, out);
 
-        //读取数据，执行CTC算法解析数据
-        float *floatArray = static_cast<float *>(out.data);
-        std::vector<float> recNetOutputData(floatArray, floatArray + out.h * out.w);
-        textLines[i] = ctcDecode(recNetOutputData, out.h, out.w);
+        //只保留中心点落在负责范围内的时间步
+        float step = static_cast<float>(segment.width) / std::max(1, out.h);
+        for (int t = 0; t < out.h; t++) {
+            float center = segment.x0 + (t + 0.5f) * step;
+            if (center < segment.keepBegin || center >= segment.keepEnd) {
+                continue;
+            }
+            const float *row = static_cast<const float *>(out.data) + t * out.w;
+            if (lexicon) {
+                //约束解码需要前topK个候选，其中第一个就是贪心解码用的最大值
+                size_t offset = segment.candidates.size();
+                segment.candidates.resize(offset + static_cast<size_t>(topK));
+                ctcTopK(row, out.w, topK, segment.candidates.data() + offset);
+                segment.labels.push_back(segment.candidates[offset].label);
+                segment.probs.push_back(segment.candidates[offset].prob);
+                continue;
+            }
+            size_t maxIndex = utilityTool.argmax(row, row + out.w);
+            segment.labels.push_back(static_cast<int>(maxIndex));
+            segment.probs.push_back(row[maxIndex]);
+        }
+    }, 1);
+
+    //3.同一行的分段按顺序拼接，接缝处相同的字会在CTC解码时合并
+    //约束解码只替换文本，置信度仍取贪心路径的，级联回退的判断不受词表影响
+    std::vector<int> labels;
+    std::vector<float> probs;
+    std::vector<CtcCandidate> candidates;
+    CtcBeamOptions beamOptions;
+    beamOptions.beamWidth = std::max(1, options->beamWidth);
+    beamOptions.blankSkip = options->beamBlankSkip;
+    for (size_t j = 0; j < segments.size(); ++j) {
+        labels.insert(labels.end(), segments[j].labels.begin(), segments[j].labels.end());
+        probs.insert(probs.end(), segments[j].probs.begin(), segments[j].probs.end());
+        candidates.insert(candidates.end(), segments[j].candidates.begin(), segments[j].candidates.end());
+        if (j + 1 == segments.size() || segments[j + 1].line != segments[j].line) {
+            size_t line = segments[j].line;
+            textLines[line] = ctcDecode(labels, probs, *model.dict, scores[line]);
+            if (lexicon) {
+                if (ctcBeamDecode(candidates, topK, *lexicon, *model.dict, beamOptions, textLines[line])) {
+                    ++stats.lexiconMatched;
+                } else {
+                    ++stats.lexiconFallbacks;
+                }
+            }
+            labels.clear();
+            probs.clear();
+            candidates.clear();
+        }
+    }
+
+    return textLines;
+}
+
+std::vector<std::string> Details::cascadeRecognize(const std::vector<cv::Mat> &detectImg)
+{
+    std::shared_ptr<const DetailsOptions> options = std::atomic_load(&currentOptions);
+    std::vector<float> scores;
+    if (!options->cascade || liteRecModel.net == nullptr) {
+        return recognizeTexts(detectImg, recModel, scores);
+    }
+
+    //1.所有文本行先走轻量模型
+    auto textLines = recognizeTexts(detectImg, liteRecModel, scores);
+
+    //2.挑出置信度不足的文本行，集中交给完整模型重新识别
+    std::vector<size_t> fallbackIndex;
+    std::vector<cv::Mat> fallbackImg;
+    for (size_t i = 0; i < scores.size(); ++i) {
+        if (scores[i] < options->cascadeThresh) {
+            fallbackIndex.push_back(i);
+            fallbackImg.push_back(detectImg[i]);
+        }
+    }
+
+    stats.cascadeLines += detectImg.size();
+    stats.cascadeFallbacks += fallbackImg.size();
+    if (fallbackImg.empty()) {
+        return textLines;
+    }
+
+    std::vector<float> fallbackScores;
+    auto fallbackLines = recognizeTexts(fallbackImg, recModel, fallbackScores);
+    for (size_t i = 0; i < fallbackIndex.size(); ++i) {
+        textLines[fallbackIndex[i]] = fallbackLines[i];
     }
 
     return textLines;
 }
 
-Details::Details(const char *recParamPath, const char *recBinPath, const std::vector<std::string> &dict, int recOut)
+bool Details::isLatinScript(const cv::Mat &img)
+{
+    //粗分文字类别：统一缩放到32像素高后二值化，统计每个有墨迹的列在竖直方向上穿过笔画的次数
+    //拉丁字母大多只穿过1~2次，汉字笔画密集，通常在3次以上
+    const float latinCrossings = 2.0f;
+
+    cv::Mat gray;
+    cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+    int resizeW = std::max(1, img.cols * 32 / std::max(1, img.rows));
+    cv::resize(gray, gray, cv::Size(resizeW, 32), 0, 0, cv::INTER_AREA);
+
+    cv::Mat binary;
+    cv::threshold(gray, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    //文字总是少数像素，据此判断前景是深色还是浅色
+    if (cv::countNonZero(binary) > binary.rows * binary.cols / 2) {
+        cv::bitwise_not(binary, binary);
+    }
+
+    int inkColumns = 0;
+    int crossings = 0;
+    for (int x = 0; x < binary.cols; x++) {
+        int columnCrossings = 0;
+        unsigned char last = 0;
+        for (int y = 0; y < binary.rows; y++) {
+            unsigned char value = binary.at<unsigned char>(y, x);
+            if (value && !last) {
+                ++columnCrossings;
+            }
+            last = value;
+        }
+        if (columnCrossings > 0) {
+            ++inkColumns;
+            crossings += columnCrossings;
+        }
+    }
+
+    //拿不准的都交给主模型，中文模型本身也能识别拉丁字母
+    return inkColumns > 0 && float(crossings) / inkColumns < latinCrossings;
+}
+
+std::vector<std::string> Details::routeRecognize(const std::vector<cv::Mat> &detectImg)
+{
+    if (latinRecModel.net == nullptr) {
+        return cascadeRecognize(detectImg);
+    }
+
+    //1.逐行判断文字类别
+    std::vector<char> isLatin(detectImg.size());
+    TaskScheduler::instance()->parallelFor(detectImg.size(), [&](size_t i) {
+        isLatin[i] = isLatinScript(detectImg[i]);
+    });
+
+    //2.按模型分组，每个模型只跑一遍
+    std::vector<size_t> latinIndex, otherIndex;
+    std::vector<cv::Mat> latinImg, otherImg;
+    for (size_t i = 0; i < detectImg.size(); ++i) {
+        if (isLatin[i]) {
+            latinIndex.push_back(i);
+            latinImg.push_back(detectImg[i]);
+        } else {
+            otherIndex.push_back(i);
+            otherImg.push_back(detectImg[i]);
+        }
+    }
+    stats.latinLines += latinImg.size();
+    stats.otherLines += otherImg.size();
+
+    //整批都是同一类文字时另一组为空，跳过不跑
+    std::vector<float> scores;
+    std::vector<std::string> latinLines, otherLines;
+    if (!latinImg.empty()) {
+        latinLines = recognizeTexts(latinImg, latinRecModel, scores);
+    }
+    if (!otherImg.empty()) {
+        otherLines = cascadeRecognize(otherImg);
+    }
+
+    //3.按原顺序放回
+    std::vector<std::string> textLines(detectImg.size());
+    for (size_t i = 0; i < latinIndex.size(); ++i) {
+        textLines[latinIndex[i]] = latinLines[i];
+    }
+    for (size_t i = 0; i < otherIndex.size(); ++i) {
+        textLines[otherIndex[i]] = otherLines[i];
+    }
+    return textLines;
+}
+
+//模型标识：模型文件的路径、大小、修改时间，以及会改变层结构的选项，取FNV-1a摘要
+//同一个缓存文件可以保存多个模型的调优结果，模型更新后旧结果自然失效
+static std::string modelIdentity(const ModelSpec &spec, const DetailsOptions &options)
+{
+    std::ostringstream text;
+    text << options.neckFusion << options.layoutPlan;
+    for (const std::string &path : {spec.paramPath, spec.binPath}) {
+        struct stat st;
+        text << '|' << path;
+        if (stat(path.c_str(), &st) == 0) {
+            text << ':' << st.st_size << ':' << st.st_mtim.tv_sec << '.' << st.st_mtim.tv_nsec;
+        }
+    }
+
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned char c : text.str()) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    char digest[17];
+    snprintf(digest, sizeof(digest), "%016llx", hash);
+    return digest;
+}
+
+//进程累计消耗的CPU时间，单位毫秒
+static double processCpuMs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+Details::Details(const ModelSpec &detSpec, const ModelSpec &recSpec, const std::shared_ptr<const CharDict> &dict, const DetailsOptions &detailsOptions)
+    : currentOptions(std::make_shared<const DetailsOptions>(detailsOptions))
+{
+    //初始化检测网络和识别网络，输入输出位置和预处理参数都来自模型清单
+    loadNetModel(detModel, detSpec, detailsOptions.layoutPlanSide, detailsOptions.layoutPlanSide);
+    loadRecModel(recModel, recSpec, dict);
+
+    if (!detailsOptions.lexicon.empty()) {
+        loadLexicon(detailsOptions.lexicon);
+    }
+
+    detTuner = new ConvTuner(detModel.net, detailsOptions.autotuneCache, modelIdentity(detSpec, detailsOptions));
+    detMemoryPlans = new MemoryPlanPool;
+
+    //并发的请求共用一个批处理器
+    recBatcher = new RecBatcher([this](const std::vector<cv::Mat> &images) {
+        ++stats.batches;
+        stats.batchedLines += images.size();
+        return routeRecognize(images);
+    }, [this]() {
+        return activeRuns.load();
+    }, static_cast<size_t>(detailsOptions.dynamicBatchSize), detailsOptions.dynamicBatchWaitMs);
+
+    applyPowerPolicy();
+    idleCpuStart = processCpuMs();
+}
+
+bool Details::loadLexicon(const std::string &path)
 {
+    std::vector<std::string> entries;
+    if (!path.empty()) {
+        std::ifstream file(path);
+        if (!file) {
+            return false;
+        }
+        //词表文件中的空行忽略
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                entries.push_back(line);
+            }
+        }
+    }
+    setLexicon(entries);
+    return true;
+}
+
+size_t Details::setLexicon(const std::vector<std::string> &entries)
+{
+    std::lock_guard<std::mutex> locker(lexiconMutex);
+    lexiconEntries = entries;
+
+    //每个识别模型的字典不同，词表要按各自的字典分别编译
+    size_t compiled = 0;
+    for (RecModel *model : {&recModel, &liteRecModel, &latinRecModel}) {
+        std::shared_ptr<const CtcLexicon> lexicon;
+        if (model->dict && !entries.empty()) {
+            lexicon = std::make_shared<CtcLexicon>(entries, *model->dict);
+            if (model == &recModel) {
+                compiled = lexicon->entryCount();
+            }
+        }
+        std::atomic_store(&model->lexicon, lexicon);
+    }
+    return compiled;
+}
+
+void Details::setOptions(const DetailsOptions &detailsOptions)
+{
+    //选项整体替换，进行中的请求继续使用各自取到的旧选项
+    std::atomic_store(&currentOptions, std::make_shared<const DetailsOptions>(detailsOptions));
+    recBatcher->setLimits(static_cast<size_t>(detailsOptions.dynamicBatchSize), detailsOptions.dynamicBatchWaitMs);
+
+    //线程和大小核的设置不能与推理同时修改，有请求在执行时推迟到最后一个请求结束
+    std::lock_guard<std::mutex> locker(powerMutex);
+    if (activeRuns == 0) {
+        applyPowerPolicy();
+    } else {
+        powerPolicyPending = true;
+    }
+}
+
+void Details::applyPowerPolicy()
+{
+    std::shared_ptr<const DetailsOptions> options = std::atomic_load(&currentOptions);
+    //请求内部各层之间的空档很短，线程自旋等待下一层比休眠再唤醒更快
+    //ncnn只在clang + libomp下把openmp_blocktime交给OpenMP运行时；GCC的libgomp没有运行时接口，
+    //空闲线程的自旋时长只由进程启动时的OMP_WAIT_POLICY和GOMP_SPINCOUNT决定，由main()在启动时设置
+#if defined(__clang__)
+    for (ncnn::Net *net : {detModel.net, recModel.net, liteRecModel.net, latinRecModel.net}) {
+        if (net) {
+            net->opt.openmp_blocktime = options->burstSpinMs;
+        }
+    }
+#endif
+
+    //切换大小核会重设线程亲和性，不能与推理同时进行；不支持的平台上保持原样
+    if (options->powersave != ncnn::get_cpu_powersave()) {
+        ncnn::set_cpu_powersave(options->powersave);
+    }
+}
+
+void Details::beginRun()
+{
+    std::shared_ptr<const DetailsOptions> options = std::atomic_load(&currentOptions);
+    if (metricsEnabled) {
+        EngineMetrics::instance()->add(EngineMetrics::Requests);
+        EngineMetrics::instance()->add(EngineMetrics::RequestsInFlight, 1);
+    }
+
+    std::lock_guard<std::mutex> locker(powerMutex);
+    if (activeRuns++ == 0) {
+        stats.idleCpuMs += static_cast<unsigned long long>(std::max(0.0, processCpuMs() - idleCpuStart));
+        TaskScheduler::instance()->setSpinTime(options->burstSpinMs * 1000);
+    }
+}
+
+void Details::endRun()
+{
+    if (metricsEnabled) {
+        EngineMetrics::instance()->add(EngineMetrics::RequestsInFlight, -1);
+    }
+
+    //最后一个请求结束，线程不再自旋，立即休眠
+    std::lock_guard<std::mutex> locker(powerMutex);
+    if (--activeRuns == 0) {
+        TaskScheduler::instance()->setSpinTime(0);
+#if defined(__clang__)
+        ncnn::set_kmp_blocktime(0);
+#endif
+        if (powerPolicyPending) {
+            applyPowerPolicy();
+            powerPolicyPending = false;
+        }
+        idleCpuStart = processCpuMs();
+    }
+}
+
+Details::~Details()
+{
+    delete recBatcher;
+    delete detTuner;
+    delete detMemoryPlans;
+    delete detModel.net;
+    delete recModel.net;
+    delete liteRecModel.net;
+    delete latinRecModel.net;
+}
+
+//按清单中的精度调整推理选项，auto保持ncnn默认
+static void applyPrecision(ncnn::Option &opt, const std::string &precision)
+{
+    if (precision == "fp32") {
+        opt.use_fp16_packed = false;
+        opt.use_fp16_storage = false;
+        opt.use_fp16_arithmetic = false;
+        opt.use_bf16_storage = false;
+    } else if (precision == "fp16") {
+        opt.use_fp16_packed = true;
+        opt.use_fp16_storage = true;
+        opt.use_fp16_arithmetic = true;
+        opt.use_bf16_storage = false;
+    } else if (precision == "bf16") {
+        opt.use_fp16_packed = false;
+        opt.use_fp16_storage = false;
+        opt.use_fp16_arithmetic = false;
+        opt.use_bf16_storage = true;
+    } else if (precision == "int8") {
+        opt.use_int8_inference = true;
+    }
+}
+
+//清单中的blob可以写序号，也可以写名称（仅文本格式的模型结构保留了名称）
+//有边界的权重读取：文件被截断时加载失败，而不是越界访问
+class MappedWeightReader : public ncnn::DataReader
+{
+public:
+    MappedWeightReader(const unsigned char *data, size_t size)
+        : m_data(data)
+        , m_size(size)
+        , m_pos(0)
+    {
+    }
+
+    size_t read(void *buf, size_t size) const override
+    {
+        size = std::min(size, m_size - m_pos);
+        memcpy(buf, m_data + m_pos, size);
+        m_pos += size;
+        return size;
+    }
+
+    size_t reference(size_t size, const void **buf) const override
+    {
+        if (size > m_size - m_pos) {
+            return 0;
+        }
+        *buf = m_data + m_pos;
+        m_pos += size;
+        return size;
+    }
+
+private:
+    const unsigned char *m_data;
+    size_t m_size;
+    mutable size_t m_pos;
+};
+
+//权重文件私有映射，网络直接引用其中未经变换的权重，多个进程共享同一份页缓存；个别层改写权重时只复制被改写的页
+//映射的是模型文件本身，原地改写或截断会影响已经映射的进程，因此模型只能以改名的方式整体替换，
+//热更新也只响应改名移入（见OcrApplication::watchModels）；映射前后大小或修改时间变化说明正被改写，放弃映射
+static std::shared_ptr<void> mapWeights(const std::string &path, size_t &size)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat before, after;
+    void *mapped = MAP_FAILED;
+    if (fstat(fd, &before) == 0 && before.st_size > 0) {
+        size = static_cast<size_t>(before.st_size);
+        mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    bool unchanged = fstat(fd, &after) == 0 && after.st_size == before.st_size
+                     && after.st_mtim.tv_sec == before.st_mtim.tv_sec && after.st_mtim.tv_nsec == before.st_mtim.tv_nsec;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return nullptr;
+    }
+    size_t mappedSize = size;
+    if (!unchanged) {
+        munmap(mapped, mappedSize);
+        return nullptr;
+    }
+    return std::shared_ptr<void>(mapped, [mappedSize](void *data) {
+        munmap(data, mappedSize);
+    });
+}
+
+static int resolveBlob(const ncnn::Net *net, const std::string &blob, const std::vector<int> &fallback, bool useLast)
+{
+    if (blob.empty()) {
+        if (fallback.empty()) {
+            return -1;
+        }
+        return useLast ? fallback.back() : fallback.front();
+    }
+
+    if (blob.find_first_not_of("0123456789") == std::string::npos) {
+        int index = std::stoi(blob);
+        return index < static_cast<int>(net->blobs().size()) ? index : -1;
+    }
+    const std::vector<ncnn::Blob> &blobs = net->blobs();
+    for (size_t i = 0; i < blobs.size(); i++) {
+        if (blobs[i].name == blob) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool Details::loadNetModel(NetModel &model, const ModelSpec &spec, int planWidth, int planHeight)
+{
+    std::shared_ptr<const DetailsOptions> options = std::atomic_load(&currentOptions);
     ncnn::Option opt;
     opt.lightmode = true; //最小化内存占用
     opt.num_threads = 2;  //神经网络推理过程中最多只开2个线程
-
-    //初始化检测网络
-    detNet = new ncnn::Net;
-    detNet->opt = opt;
-#ifdef IN_TEST
-    detNet->load_param_bin((QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/ocr_test/testResource/det.param.bin").toStdString().c_str());
-    detNet->load_model((QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/ocr_test/testResource/det.bin").toStdString().c_str());
-#else
-    detNet->load_param_bin("/usr/share/lingmo-ocr/model/det.param.bin");
-    detNet->load_model("/usr/share/lingmo-ocr/model/det.bin");
+#if defined(__clang__)
+    opt.openmp_blocktime = options->burstSpinMs; //libgomp下无效，见applyPowerPolicy
 #endif
+    applyPrecision(opt, spec.precision);
+
+    //二进制格式的模型结构以.bin结尾，其余按文本格式加载
+    ncnn::Net *net = new ncnn::Net;
+    net->opt = opt;
+    bool binaryParam = spec.paramPath.size() >= 4 && spec.paramPath.compare(spec.paramPath.size() - 4, 4, ".bin") == 0;
+    int ret = binaryParam ? net->load_param_bin(spec.paramPath.c_str()) : net->load_param(spec.paramPath.c_str());
+    std::shared_ptr<void> weights;
+    size_t weightBytes = 0;
+    if (ret == 0) {
+        weights = mapWeights(spec.binPath, weightBytes);
+        if (weights) {
+            ret = net->load_model(MappedWeightReader(static_cast<const unsigned char *>(weights.get()), weightBytes));
+        } else {
+            struct stat st;
+            weightBytes = stat(spec.binPath.c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+            ret = net->load_model(spec.binPath.c_str());
+        }
+    }
+    if (ret != 0) {
+        delete net;
+        return false;
+    }
+    if (options->neckFusion) {
+        fuseFpnNeck(net);
+    }
 
-    //初始化识别网络
-    recNet = new ncnn::Net;
-    recNet->opt = opt;
-    recNet->load_param_bin(recParamPath);
-    recNet->load_model(recBinPath);
+    int inIndex = resolveBlob(net, spec.inputBlob, net->input_indexes(), false);
+    int outIndex = resolveBlob(net, spec.outputBlob, net->output_indexes(), true);
+    if (inIndex < 0 || outIndex < 0) {
+        delete net;
+        return false;
+    }
 
-    //加载字典
-    keys = dict;
+    //网络发布之前按典型输入尺寸规划打包方式，试算的输入只需要尺寸正确
+    LayoutReport layout;
+    if (options->layoutPlan && planWidth > 0 && planHeight > 0) {
+        ncnn::Mat planInput(planWidth, planHeight, 3);
+        planInput.fill(0.5f);
+        layout = planLayout(net, inIndex, outIndex, planInput);
+    }
 
-    //设置识别结果位置
-    recOutIndex = recOut;
+    delete model.net;
+    model.net = net;
+    model.weights = weights;
+    model.spec = spec;
+    model.inIndex = inIndex;
+    model.outIndex = outIndex;
+    model.layout = layout;
+    model.weightBytes = weightBytes;
+    return true;
 }
 
-Details::~Details()
+bool Details::loadRecModel(RecModel &model, const ModelSpec &spec, const std::shared_ptr<const CharDict> &dict)
 {
-    delete detNet;
-    delete recNet;
+    std::shared_ptr<const DetailsOptions> options = std::atomic_load(&currentOptions);
+    if (!dict || !loadNetModel(model, spec, options->layoutPlanWidth, spec.inputHeight)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> locker(lexiconMutex);
+    model.dict = dict;
+    if (!lexiconEntries.empty()) {
+        std::atomic_store(&model.lexicon, std::shared_ptr<const CtcLexicon>(std::make_shared<CtcLexicon>(lexiconEntries, *dict)));
+    }
+    return true;
+}
+
+bool Details::loadLiteRecognizer(const ModelSpec &spec, const std::shared_ptr<const CharDict> &dict)
+{
+    return loadRecModel(liteRecModel, spec, dict);
+}
+
+bool Details::loadLatinRecognizer(const ModelSpec &spec, const std::shared_ptr<const CharDict> &dict)
+{
+    return loadRecModel(latinRecModel, spec, dict);
+}
+
+//限于开源协议，暂时无法采用更高效的排序策略
+static bool readingOrderLess(const std::vector<std::vector<int>> &boxL, const std::vector<std::vector<int>> &boxR)
+{
+    //左侧
+    int x_collect_L[4] = {boxL[0][0], boxL[1][0], boxL[2][0], boxL[3][0]};
+    int y_collect_L[4] = {boxL[0][1], boxL[1][1], boxL[2][1], boxL[3][1]};
+
+    //右侧
+    int x_collect_R[4] = {boxR[0][0], boxR[1][0], boxR[2][0], boxR[3][0]};
+    int y_collect_R[4] = {boxR[0][1], boxR[1][1], boxR[2][1], boxR[3][1]};
+
+    //判断顺序：先上下，后左右
+
+    //完全超过时，在上面的靠前，在下面的靠后
+    int y_L = *std::min_element(y_collect_L, y_collect_L + 4);
+    int height_L = *std::max_element(y_collect_L, y_collect_L + 4) - y_L;
+    int y_R = *std::min_element(y_collect_R, y_collect_R + 4);
+    int height_R = *std::max_element(y_collect_R, y_collect_R + 4) - y_R;
+    if (y_R - y_L > height_R / 3.0f * 2.0f) {
+        return true;
+    } else if (y_L - y_R > height_L / 3.0f * 2.0f) {
+        return false;
+    }
+
+    //部分超过时，在左边的靠前，在右边的靠后（TODO：如果是维语/阿拉伯语，则需要反过来）
+    //注意：由于检测算法的机制，各个矩形框按理来说不会出现重叠
+    int x_L = *std::min_element(x_collect_L, x_collect_L + 4);
+    int x_R = *std::min_element(x_collect_R, x_collect_R + 4);
+    if (x_L < x_R) {
+        return true;
+    } else {
+        return false;
+    }
 }
 
 std::vector<std::string> Details::run(const cv::Mat matrix)
 {
-    //1.获取文本位置
-    auto boxes = detectText(matrix, 0.3f, 0.5f, 1.6f);
-
-    //2.执行排序
-    //限于开源协议，暂时无法采用更高效的策略
-    std::sort(boxes.begin(), boxes.end(), [](const std::vector<std::vector<int>> &boxL, const std::vector<std::vector<int>> &boxR) {
-        //左侧
-        int x_collect_L[4] = {boxL[0][0], boxL[1][0], boxL[2][0], boxL[3][0]};
-        int y_collect_L[4] = {boxL[0][1], boxL[1][1], boxL[2][1], boxL[3][1]};
-
-        //右侧
-        int x_collect_R[4] = {boxR[0][0], boxR[1][0], boxR[2][0], boxR[3][0]};
-        int y_collect_R[4] = {boxR[0][1], boxR[1][1], boxR[2][1], boxR[3][1]};
-
-        //判断顺序：先上下，后左右
-
-        //完全超过时，在上面的靠前，在下面的靠后
-        int y_L = *std::min_element(y_collect_L, y_collect_L + 4);
-        int height_L = *std::max_element(y_collect_L, y_collect_L + 4) - y_L;
-        int y_R = *std::min_element(y_collect_R, y_collect_R + 4);
-        int height_R = *std::max_element(y_collect_R, y_collect_R + 4) - y_R;
-        if (y_R - y_L > height_R / 3.0f * 2.0f) {
-            return true;
-        } else if (y_L - y_R > height_L / 3.0f * 2.0f) {
-            return false;
+    //本次请求使用开始时的选项快照，期间调用setOptions不影响
+    std::shared_ptr<const DetailsOptions> options = std::atomic_load(&currentOptions);
+    //记录正在执行的请求数，供动态批处理判断是否还需要等待其他请求，以及空闲时让线程休眠
+    struct RunGuard {
+        Details *details;
+        explicit RunGuard(Details *owner) : details(owner)
+        {
+            details->beginRun();
+        }
+        ~RunGuard()
+        {
+            details->endRun();
         }
+    } runGuard(this);
+    EngineMetrics::Timer timer(EngineMetrics::RequestStage, metricsEnabled);
 
-        //部分超过时，在左边的靠前，在右边的靠后（TODO：如果是维语/阿拉伯语，则需要反过来）
-        //注意：由于检测算法的机制，各个矩形框按理来说不会出现重叠
-        int x_L = *std::min_element(x_collect_L, x_collect_L + 4);
-        int x_R = *std::min_element(x_collect_R, x_collect_R + 4);
-        if (x_L < x_R) {
-            return true;
-        } else {
-            return false;
+    if (!isReady()) {
+        return std::vector<std::string>();
+    }
+
+    //1.获取文本位置：可选先跳过空白区域，只在有内容的区域上执行检测
+    std::vector<cv::Rect> regions(1, cv::Rect(0, 0, matrix.cols, matrix.rows));
+    if (options->inkRegions) {
+        regions = findInkRegions(matrix, *options);
+        if (regions.empty()) {
+            ++stats.inkBlankPages;
+            return std::vector<std::string>();
         }
-    });
+    }
+
+    //可选：缩略图上确认没有文字时，直接跳过后续全部流程
+    if (options->textGate && !containsText(matrix, 0.3f)) {
+        return std::vector<std::string>();
+    }
+    stats.inkRegions += regions.size();
 
-    //3.获取对应位置的图片
-    std::vector<cv::Mat> images;
-    std::transform(boxes.begin(), boxes.end(), std::back_inserter(images), [matrix, this](const std::vector<std::vector<int>> &box) {
-        return utilityTool.GetRotateCropImage(matrix, box);
+    //2.检测与识别流水线执行：检测线程每确定一个文本框就放进队列，识别线程随取随识别
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<TextBox> pending;
+    bool detectFinished = false;
+    std::vector<TextBox> boxes;
+    std::vector<std::string> texts;
+    size_t batchLimit = static_cast<size_t>(std::max(1, options->pipelineBatch));
+
+    auto recognizeWorker = [&]() {
+        while (true) {
+            std::vector<TextBox> batch;
+            {
+                std::unique_lock<std::mutex> locker(mutex);
+                condition.wait(locker, [&]() {
+                    return !pending.empty() || detectFinished;
+                });
+                if (pending.empty()) {
+                    break;
+                }
+                while (!pending.empty() && batch.size() < batchLimit) {
+                    batch.push_back(pending.front());
+                    pending.pop_front();
+                }
+            }
+
+            //获取对应位置的图片并识别
+            std::vector<cv::Mat> images;
+            for (const TextBox &box : batch) {
+                images.push_back(utilityTool.GetRotateCropImage(matrix, box));
+            }
+            auto batchTexts = options->dynamicBatch ? recBatcher->recognize(images) : routeRecognize(images);
+
+            std::lock_guard<std::mutex> locker(mutex);
+            boxes.insert(boxes.end(), batch.begin(), batch.end());
+            texts.insert(texts.end(), batchTexts.begin(), batchTexts.end());
+        }
+    };
+
+    std::thread recognizeThread;
+    if (options->pipeline) {
+        recognizeThread = std::thread(recognizeWorker);
+    }
+
+    int pageSide = std::max(matrix.cols, matrix.rows);
+    for (const cv::Rect &region : regions) {
+        //各区域沿用整页的缩放比例，检测耗时才会随有内容的面积等比例下降
+        int limitSide = 960;
+        if (pageSide > 960) {
+            limitSide = std::max(32, static_cast<int>(960.0f * std::max(region.width, region.height) / pageSide));
+        }
+
+        detectText(matrix(region), 0.3f, 0.5f, 1.6f, limitSide, [&](const TextBox &regionBox) {
+            TextBox box = regionBox;
+            for (auto &point : box) {
+                point[0] += region.x;
+                point[1] += region.y;
+            }
+            std::lock_guard<std::mutex> locker(mutex);
+            pending.push_back(box);
+            condition.notify_one();
+        });
+    }
+
+    {
+        std::lock_guard<std::mutex> locker(mutex);
+        detectFinished = true;
+    }
+    condition.notify_one();
+
+    //不启用流水线时，检测全部完成后再统一识别
+    if (recognizeThread.joinable()) {
+        recognizeThread.join();
+    } else {
+        batchLimit = std::numeric_limits<size_t>::max();
+        recognizeWorker();
+    }
+
+    //3.识别完成后统一按阅读顺序排序
+    std::vector<size_t> order(boxes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&boxes](size_t l, size_t r) {
+        return readingOrderLess(boxes[l], boxes[r]);
     });
 
-    //4.对每一张图片进行识别
-    std::vector<std::string> recResults = recognizeTexts(images);
+    std::vector<std::string> recResults;
+    for (size_t i : order) {
+        recResults.push_back(texts[i]);
+    }
+    if (metricsEnabled) {
+        EngineMetrics::instance()->add(EngineMetrics::TextLines, static_cast<long long>(recResults.size()));
+    }
 
     return recResults;
 }
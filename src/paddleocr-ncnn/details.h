@@ -21,32 +21,210 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <postprocess_op.h>
 #include <utility.h>
+#include "layoutplan.h"
 
 namespace ncnn {
 class Net;
 }
 
+class CharDict;
+class CtcLexicon;
+class RecBatcher;
+class ConvTuner;
+class MemoryPlanPool;
+
+//引擎可选项
+struct DetailsOptions {
+    bool inkRegions = true;      //检测前在灰度缩略图上找出有内容的区域，整页空白时直接返回，否则只检测有内容的区域
+    int inkThumbSide = 128;      //找内容区域的缩略图长边
+    float inkBlankStdDev = 4.0f; //缩略图上8x8分块的灰度标准差低于该值即视为空白
+    float inkFullPage = 0.7f;    //有内容的区域占整页的比例超过该值时直接检测整页，拆分已无收益
+    bool textGate = false;       //先在缩略图上判断图中是否有文字，没有则直接跳过
+    int textGateSide = 256;      //门控缩略图的长边
+    float textGateMargin = 0.5f; //缩略图最大概率低于 阈值*该系数 才判定为无文字，否则回退到完整检测
+    bool cascade = true;         //加载了轻量识别模型时，先用轻量模型识别，置信度不足的文本行再交给完整模型
+    float cascadeThresh = 0.9f;  //轻量模型识别结果的置信度低于该值时，回退到完整模型
+    bool longLineSplit = true;   //超长文本行拆成重叠的分段并行识别
+    int longLineWidth = 1024;    //缩放到32像素高后，宽度超过该值即视为超长文本行
+    int longLineSegment = 512;   //分段宽度
+    int longLineOverlap = 64;    //相邻分段的重叠宽度
+    bool pipeline = true;        //检测与识别流水线执行：检测出一个文本框就交给识别线程，不等整页检测完
+    int pipelineBatch = 4;       //识别线程每次最多取出的文本框数量
+    bool dynamicBatch = true;    //多个请求同时识别时，把各自的文本行攒成一批统一识别
+    int dynamicBatchSize = 16;   //每批最多的文本行数
+    int dynamicBatchWaitMs = 5;  //第一个文本行到达后最多等待的毫秒数
+    bool autotune = true;        //检测网络的卷积层按输入尺寸自动选择最快的实现，每个尺寸只在第一次遇到时调优
+    std::string autotuneCache;   //自动调优结果的缓存文件，只在创建Details时生效
+    bool memoryPlan = true;      //检测网络按输入尺寸规划中间结果的内存，同尺寸推理复用同一块内存
+    bool neckFusion = true;      //检测网络FPN颈部的上采样与相加、拼接融合成单个算子，只在加载模型时生效
+    bool layoutPlan = true;      //加载模型时按典型输入尺寸试算，重新选择部分层的打包方式，减少层间的布局转换
+    int layoutPlanSide = 320;    //规划检测网络时输入图片的边长，打包方式只取决于通道数，边长只影响试算耗时和报告的字节数
+    int layoutPlanWidth = 320;   //规划识别网络时文本行的宽度
+    int burstSpinMs = 2;         //请求执行期间线程空闲后先自旋等待的毫秒数，没有请求时线程立即休眠
+    int powersave = 0;           //推理线程使用的核心：0 全部核心，1 小核，2 大核
+    std::string lexicon;         //约束解码的词表文件，每行一项，识别结果须整行匹配其中一项；创建Details时加载，运行中通过loadLexicon替换
+    int beamWidth = 8;           //约束解码的束宽
+    int beamTopK = 5;            //约束解码每个时间步展开的候选字数
+    float beamBlankSkip = 0.999f;//空白概率不低于该值的时间步不展开候选字
+};
+
+//引擎运行统计
+struct DetailsStats {
+    std::atomic<unsigned long long> inkBlankPages{0}; //缩略图上整页空白、跳过检测的次数
+    std::atomic<unsigned long long> inkRegions{0};    //按有内容的区域分别检测的区域数，检测整页时计为一个
+    std::atomic<unsigned long long> gateChecked{0}; //执行过门控判断的次数
+    std::atomic<unsigned long long> gateSkipped{0}; //判定为无文字而跳过的次数
+    std::atomic<unsigned long long> gateEscaped{0}; //未越过阈值但接近阈值，回退到完整检测的次数
+    std::atomic<unsigned long long> cascadeLines{0};     //经过轻量模型识别的文本行数
+    std::atomic<unsigned long long> cascadeFallbacks{0}; //回退到完整模型重新识别的文本行数
+    std::atomic<unsigned long long> latinLines{0};       //自动模式下判定为拉丁文字、交给英文模型的文本行数
+    std::atomic<unsigned long long> otherLines{0};       //自动模式下交给主模型的文本行数
+    std::atomic<unsigned long long> longLines{0};        //拆分识别的超长文本行数
+    std::atomic<unsigned long long> longLineSegments{0}; //拆分额外多出的分段数
+    std::atomic<unsigned long long> batches{0};          //动态批处理发出的批次数
+    std::atomic<unsigned long long> batchedLines{0};     //动态批处理识别的文本行数
+    std::atomic<unsigned long long> memoryPlanHits{0};   //完全按内存规划执行的检测推理次数
+    std::atomic<unsigned long long> memoryPlanMisses{0}; //记录内存规划或偏离规划的检测推理次数
+    std::atomic<unsigned long long> idleCpuMs{0};        //没有请求时进程消耗的CPU毫秒数，用于确认空闲时线程没有空转
+    std::atomic<unsigned long long> lexiconMatched{0};   //约束解码找到词表中匹配项的文本行数
+    std::atomic<unsigned long long> lexiconFallbacks{0}; //约束解码没有匹配项、保留贪心结果的文本行数
+};
+
+//模型描述，对应模型目录下与模型同名的json清单
+struct ModelSpec {
+    std::string paramPath;         //模型结构文件
+    std::string binPath;           //权重文件
+    std::string inputBlob;         //输入blob的名称或序号，二进制的.param.bin只能用序号；为空时取网络的第一个输入
+    std::string outputBlob;        //输出blob的名称或序号；为空时取网络的最后一个输出
+    int inputHeight = 32;          //识别模型的输入高度
+    float mean[3] = {0.0f, 0.0f, 0.0f};  //减均值
+    float norm[3] = {1.0f, 1.0f, 1.0f};  //乘系数
+    std::string precision = "auto";      //auto / fp32 / fp16 / bf16 / int8
+};
+
+//网络 + 清单 + 解析后的输入输出位置
+struct NetModel {
+    ncnn::Net *net = nullptr;
+    ModelSpec spec;
+    int inIndex = 0;
+    int outIndex = 0;
+    LayoutReport layout;           //加载时布局规划前后每次推理的转换量
+    size_t weightBytes = 0;        //权重文件的大小
+    std::shared_ptr<void> weights; //mmap的权重文件，网络直接引用其中的数据，须比网络后释放
+};
+
+//识别模型：网络 + 字典 + 按该字典编译的约束词表
+struct RecModel : NetModel {
+    std::shared_ptr<const CharDict> dict;
+    std::shared_ptr<const CtcLexicon> lexicon; //为空时贪心解码，运行中可替换，需原子读写
+};
+
 class Details
 {
 public:
-    Details(const char *recParamPath, const char *recBinPath, const std::vector<std::string> &dict, int recOut);
+    Details(const ModelSpec &detSpec, const ModelSpec &recSpec, const std::shared_ptr<const CharDict> &dict,
+            const DetailsOptions &detailsOptions = DetailsOptions());
     ~Details();
 
     std::vector<std::string> run(const cv::Mat matrix);
 
+    //加载可选的轻量识别模型，用于级联识别
+    bool loadLiteRecognizer(const ModelSpec &spec, const std::shared_ptr<const CharDict> &dict);
+
+    //加载可选的拉丁文字识别模型，加载后按文本行自动分流
+    bool loadLatinRecognizer(const ModelSpec &spec, const std::shared_ptr<const CharDict> &dict);
+
+    //设置约束解码的词表，为空时恢复贪心解码；返回主识别模型成功编译的项数
+    size_t setLexicon(const std::vector<std::string> &entries);
+
+    //从词表文件加载约束解码的词表，每行一项，路径为空时清除词表；文件无法打开时返回false且保持原词表
+    bool loadLexicon(const std::string &path);
+
+    //检测和识别模型都加载成功
+    bool isReady() const
+    {
+        return detModel.net != nullptr && recModel.net != nullptr;
+    }
+
+    void setOptions(const DetailsOptions &detailsOptions);
+
+    //预热等内部运行不计入引擎指标；只在引擎发布给请求之前调用
+    void setMetricsEnabled(bool enabled)
+    {
+        metricsEnabled = enabled;
+    }
+
+    DetailsOptions getOptions() const
+    {
+        return *std::atomic_load(&currentOptions);
+    }
+
+    const DetailsStats &getStats() const
+    {
+        return stats;
+    }
+
+    //已加载的所有模型的权重字节数
+    size_t modelBytes() const
+    {
+        return detModel.weightBytes + recModel.weightBytes + liteRecModel.weightBytes + latinRecModel.weightBytes;
+    }
+
+    //检测和识别网络加载时布局规划的结果
+    const LayoutReport &detLayoutReport() const
+    {
+        return detModel.layout;
+    }
+
+    const LayoutReport &recLayoutReport() const
+    {
+        return recModel.layout;
+    }
+
 private:
-    std::vector<std::string> recognizeTexts(const std::vector<cv::Mat> &detectImg);
-    std::string ctcDecode(const std::vector<float> &recNetOutputData, int h, int w);
-    std::vector<std::vector<std::vector<int> > > detectText(const cv::Mat &src, float thresh, float boxThresh, float unclipRatio);
-
-    ncnn::Net *detNet; //检测网络
-    ncnn::Net *recNet; //识别网络
-    std::vector<std::string> keys; //字典
-    int recOutIndex; //识别结果输出位置，默认的MobileNetV3模型出来的都是146
+    std::vector<std::string> recognizeTexts(const std::vector<cv::Mat> &detectImg, const RecModel &model, std::vector<float> &scores);
+    std::vector<std::string> cascadeRecognize(const std::vector<cv::Mat> &detectImg);
+    std::vector<std::string> routeRecognize(const std::vector<cv::Mat> &detectImg);
+    bool isLatinScript(const cv::Mat &img);
+    bool loadNetModel(NetModel &model, const ModelSpec &spec, int planWidth, int planHeight);
+    bool loadRecModel(RecModel &model, const ModelSpec &spec, const std::shared_ptr<const CharDict> &dict);
+    std::string ctcDecode(const std::vector<int> &labels, const std::vector<float> &probs, const CharDict &dict, float &score);
+    cv::Mat predictTextMap(const cv::Mat &src, int limitSide, float &ratio_h, float &ratio_w);
+    bool containsText(const cv::Mat &src, float thresh);
+    typedef std::vector<std::vector<int> > TextBox;
+    std::vector<TextBox> detectText(const cv::Mat &src, float thresh, float boxThresh, float unclipRatio, int limitSide = 960,
+                                    const std::function<void(const TextBox &)> &onBox = nullptr);
+    std::vector<cv::Rect> findInkRegions(const cv::Mat &src, const DetailsOptions &options);
+    void beginRun();
+    void endRun();
+    void applyPowerPolicy();
+
+    NetModel detModel; //检测网络
+    ConvTuner *detTuner; //检测网络的卷积实现调优
+    MemoryPlanPool *detMemoryPlans; //检测网络的静态内存规划
+    RecModel recModel;     //识别网络
+    RecModel liteRecModel; //轻量识别网络，可选
+    RecModel latinRecModel;//拉丁文字识别网络，可选，仅自动模式使用
+
+    std::shared_ptr<const DetailsOptions> currentOptions; //当前选项，只通过原子操作读写，修改时整体替换
+    DetailsStats stats;
+
+    RecBatcher *recBatcher; //跨请求的识别动态批处理
+    std::atomic_int activeRuns{0}; //正在执行的请求数
+    std::atomic_bool metricsEnabled{true}; //为false时本引擎的运行不计入EngineMetrics
+    std::mutex powerMutex;
+    bool powerPolicyPending = false; //setOptions时有请求在执行，等到空闲再应用，由powerMutex保护
+    std::mutex lexiconMutex;
+    std::vector<std::string> lexiconEntries; //后加载的识别模型也按此编译词表
+    double idleCpuStart; //最近一次进入空闲时的进程CPU时间，单位毫秒
 
     PaddleOCR::PostProcessor postProcessor;
     PaddleOCR::Utility utilityTool;
@@ -0,0 +1,276 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "layoutplan.h"
+
+#include <set>
+#include <utility>
+#include <vector>
+
+// ncnn
+#include "blob.h"
+#include "cpu.h"
+#include "layer.h"
+#include "layer_type.h"
+#include "net.h"
+#include "platform.h"
+
+#include "neckfusion.h"
+
+//一处转换：layer读取blob之前要把它从当前的elempack转换成wanted
+struct LayoutConversion {
+    int layer;
+    int blob;
+    int wanted;
+    size_t bytes;
+};
+
+//层读取输入前会被转换成的位宽，与ncnn::NetPrivate::convert_layout中的类型转换一致
+static int storageBits(const ncnn::Mat &m, const ncnn::Layer *layer, const ncnn::Option &opt)
+{
+    const int bits = m.elembits();
+#if NCNN_ARM82
+    if (opt.use_fp16_storage && ncnn::cpu_support_arm_asimdhp()) {
+        if (bits == 32 && layer->support_fp16_storage) {
+            return 16;
+        }
+        if (bits == 16 && !layer->support_fp16_storage) {
+            return 32;
+        }
+        return bits;
+    }
+#endif
+#if NCNN_BF16
+    if (opt.use_bf16_storage) {
+        if (bits == 32 && layer->support_bf16_storage) {
+            return 16;
+        }
+        if (bits == 16 && !layer->support_bf16_storage) {
+            return 32;
+        }
+    }
+#endif
+    (void)layer;
+    (void)opt;
+    return bits;
+}
+
+//层读取m之前会把它转换成的elempack，与ncnn::NetPrivate::convert_layout中选择dst_elempack的规则一致
+static int wantedElempack(const ncnn::Mat &m, const ncnn::Layer *layer, const ncnn::Option &opt)
+{
+    if (!opt.use_packing_layout || !layer->support_packing) {
+        return 1;
+    }
+
+    int count = 0;
+    if (m.dims == 1) {
+        count = m.w * m.elempack;
+    } else if (m.dims == 2) {
+        count = m.h * m.elempack;
+    } else {
+        count = m.c * m.elempack;
+    }
+
+    const int bits = storageBits(m, layer, opt);
+    if (bits == 32) {
+#if NCNN_AVX512
+        if (count % 16 == 0 && ncnn::cpu_support_x86_avx512()) {
+            return 16;
+        }
+#endif
+#if NCNN_AVX
+        if (count % 8 == 0 && ncnn::cpu_support_x86_avx()) {
+            return 8;
+        }
+#endif
+        return count % 4 == 0 ? 4 : 1;
+    }
+    if (bits == 16) {
+#if NCNN_ARM82
+        if (count % 8 == 0 && opt.use_fp16_storage && opt.use_fp16_arithmetic && layer->support_fp16_storage) {
+            return 8;
+        }
+#endif
+        return count % 4 == 0 ? 4 : 1;
+    }
+    if (bits == 8) {
+        return count % 8 == 0 ? 8 : 1;
+    }
+    return 1;
+}
+
+//按input试算一次，保留所有中间结果，逐层比较输入的elempack和层需要的elempack
+static bool findConversions(ncnn::Net *net, int inIndex, int outIndex, const ncnn::Mat &input, std::vector<LayoutConversion> &conversions)
+{
+    const std::vector<ncnn::Layer *> &layers = net->layers();
+    const std::vector<ncnn::Blob> &blobs = net->blobs();
+
+    ncnn::Extractor ex = net->create_extractor();
+    ex.set_light_mode(false);
+    ex.input(inIndex, input);
+    ncnn::Mat out;
+    if (ex.extract(outIndex, out) != 0) {
+        return false;
+    }
+
+    //从输出往回找出本次推理经过的层
+    std::set<int> reached;
+    std::vector<int> pending = {blobs[outIndex].producer};
+    while (!pending.empty()) {
+        int i = pending.back();
+        pending.pop_back();
+        if (i < 0 || !reached.insert(i).second) {
+            continue;
+        }
+        for (int bottom : layers[i]->bottoms) {
+            pending.push_back(blobs[bottom].producer);
+        }
+    }
+
+    conversions.clear();
+    for (int i : reached) {
+        const ncnn::Layer *layer = layers[i];
+        for (int bottom : layer->bottoms) {
+            //类型1取出的是blob原样保存的结果，不做任何转换
+            ncnn::Mat m;
+            if (ex.extract(bottom, m, 1) != 0 || m.empty()) {
+                continue;
+            }
+            int wanted = wantedElempack(m, layer, net->opt);
+            if (wanted != m.elempack) {
+                conversions.push_back({i, bottom, wanted, m.total() * m.elemsize});
+            }
+        }
+    }
+    return true;
+}
+
+static size_t totalBytes(const std::vector<LayoutConversion> &conversions)
+{
+    size_t bytes = 0;
+    for (const LayoutConversion &c : conversions) {
+        bytes += c.bytes;
+    }
+    return bytes;
+}
+
+//没有权重、创建流水线时也不依赖打包方式的层，不打包时只是换成逐个通道计算，结果不变
+static bool packingNeutral(const ncnn::Layer *layer)
+{
+    switch (layer->typeindex) {
+    case ncnn::LayerType::BinaryOp:
+    case ncnn::LayerType::Clip:
+    case ncnn::LayerType::Concat:
+    case ncnn::LayerType::Crop:
+    case ncnn::LayerType::Dropout:
+    case ncnn::LayerType::Eltwise:
+    case ncnn::LayerType::Flatten:
+    case ncnn::LayerType::HardSigmoid:
+    case ncnn::LayerType::HardSwish:
+    case ncnn::LayerType::Interp:
+    case ncnn::LayerType::Noop:
+    case ncnn::LayerType::Padding:
+    case ncnn::LayerType::Pooling:
+    case ncnn::LayerType::ReLU:
+    case ncnn::LayerType::Reshape:
+    case ncnn::LayerType::Sigmoid:
+    case ncnn::LayerType::Slice:
+    case ncnn::LayerType::Split:
+    case ncnn::LayerType::Swish:
+    case ncnn::LayerType::TanH:
+    case ncnn::LayerType::UnaryOp:
+        return true;
+    default:
+        return false;
+    }
+}
+
+size_t measureLayoutConversion(ncnn::Net *net, int inIndex, int outIndex, const ncnn::Mat &input, int *conversions)
+{
+    std::vector<LayoutConversion> found;
+    findConversions(net, inIndex, outIndex, input, found);
+    if (conversions) {
+        *conversions = static_cast<int>(found.size());
+    }
+    return totalBytes(found);
+}
+
+LayoutReport planLayout(ncnn::Net *net, int inIndex, int outIndex, const ncnn::Mat &input)
+{
+    LayoutReport report;
+    std::vector<LayoutConversion> current;
+    if (!findConversions(net, inIndex, outIndex, input, current)) {
+        return report;
+    }
+    report.bytesBefore = report.bytesAfter = totalBytes(current);
+    report.conversionsBefore = report.conversionsAfter = static_cast<int>(current.size());
+
+    //贪心搜索：对每处转换，依次尝试改变产生该blob的层和读取它的层，重新试算后转换的字节数减少才保留
+    //每个改动只尝试一次，网络中的转换通常只有几处，试算次数与转换处数相当
+    std::vector<ncnn::Layer *> &layers = net->mutable_layers();
+    const std::vector<ncnn::Blob> &blobs = net->blobs();
+    std::set<std::pair<int, int>> tried; //(层序号, 融合算子改成的elempack，0表示改为不打包)
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        for (size_t k = 0; k < current.size() && !improved; k++) {
+            const LayoutConversion c = current[k];
+            const int producer = blobs[c.blob].producer;
+            for (int candidate : {producer, c.layer}) {
+                if (candidate < 0) {
+                    continue;
+                }
+                ncnn::Layer *layer = layers[candidate];
+                FpnUpsampleFuse *fuse = asFpnUpsampleFuse(net, layer);
+                int oldElempack = 0;
+                if (fuse && fuse->mode == FpnUpsampleFuse::Concat && candidate == producer) {
+                    //融合的拼接算子直接按读取方需要的打包方式写出
+                    if (!tried.insert({candidate, c.wanted}).second) {
+                        continue;
+                    }
+                    oldElempack = fuse->outElempack;
+                    fuse->outElempack = c.wanted;
+                } else if (layer->support_packing && packingNeutral(layer)) {
+                    if (!tried.insert({candidate, 0}).second) {
+                        continue;
+                    }
+                    fuse = nullptr;
+                    layer->support_packing = false;
+                } else {
+                    continue;
+                }
+
+                std::vector<LayoutConversion> next;
+                if (findConversions(net, inIndex, outIndex, input, next) && totalBytes(next) < totalBytes(current)) {
+                    current.swap(next);
+                    report.changedLayers++;
+                    improved = true;
+                    break;
+                }
+                if (fuse) {
+                    fuse->outElempack = oldElempack;
+                } else {
+                    layer->support_packing = true;
+                }
+            }
+        }
+    }
+
+    report.bytesAfter = totalBytes(current);
+    report.conversionsAfter = static_cast<int>(current.size());
+    return report;
+}
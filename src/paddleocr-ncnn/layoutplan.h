@@ -0,0 +1,44 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+// ncnn
+#include "mat.h"
+
+namespace ncnn {
+class Net;
+}
+
+//一次推理中ncnn在层与层之间转换elempack所拷贝的数据量，按规划时的输入尺寸统计
+struct LayoutReport {
+    size_t bytesBefore = 0;    //规划前每次推理转换的字节数
+    size_t bytesAfter = 0;     //规划后每次推理转换的字节数
+    int conversionsBefore = 0; //规划前每次推理的转换次数
+    int conversionsAfter = 0;  //规划后每次推理的转换次数
+    int changedLayers = 0;     //改变了打包方式的层数
+};
+
+//统计按input推理一次时，从inIndex到outIndex经过的层在输入前做了多少elempack转换，返回转换的字节数
+size_t measureLayoutConversion(ncnn::Net *net, int inIndex, int outIndex, const ncnn::Mat &input, int *conversions = nullptr);
+
+//加载时的布局规划：按给定输入尺寸试算，在不影响计算结果的层上重新选择打包方式，使层间转换的总字节数最少
+//只改变与权重和流水线状态无关的层：把无权重的逐元素、搬运类层改为不打包，以及让融合的拼接算子直接按下一层的打包方式写出
+//须在网络开始推理之前调用
+LayoutReport planLayout(ncnn::Net *net, int inIndex, int outIndex, const ncnn::Mat &input);
@@ -0,0 +1,254 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "memoryplan.h"
+
+#include <algorithm>
+
+//每块内存按ncnn的对齐要求对齐，并预留优化内核可能越界读取的部分
+static size_t blockBytes(size_t size)
+{
+    return ncnn::alignSize(size + NCNN_MALLOC_OVERREAD, NCNN_MALLOC_ALIGN);
+}
+
+PlannedAllocator::PlannedAllocator()
+    : m_shape(0, 0)
+    , m_recording(true)
+    , m_planValid(false)
+    , m_missed(false)
+    , m_clock(0)
+    , m_step(0)
+    , m_arena(nullptr)
+    , m_arenaSize(0)
+{
+}
+
+PlannedAllocator::~PlannedAllocator()
+{
+    resetArena();
+}
+
+void PlannedAllocator::resetArena()
+{
+    if (m_arena) {
+        ncnn::fastFree(m_arena);
+        m_arena = nullptr;
+    }
+    m_arenaSize = 0;
+}
+
+void PlannedAllocator::begin(int width, int height)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    std::pair<int, int> shape(width, height);
+    if (shape != m_shape || !m_planValid) {
+        m_shape = shape;
+        m_planValid = false;
+        m_blocks.clear();
+        resetArena();
+    }
+
+    m_recording = !m_planValid;
+    m_missed = false;
+    m_clock = 0;
+    m_step = 0;
+    m_live.assign(m_blocks.size(), false);
+    m_liveBlocks.clear();
+}
+
+bool PlannedAllocator::end()
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_recording) {
+        //有内存没有释放说明调用方仍持有结果，这次记录不可信
+        bool complete = std::all_of(m_blocks.begin(), m_blocks.end(), [](const Block &block) {
+            return block.freeTime >= 0;
+        });
+        if (complete) {
+            buildPlan();
+        } else {
+            m_blocks.clear();
+        }
+        m_recording = false;
+        return false;
+    }
+
+    //推理过程与规划不一致，下次重新记录
+    if (m_missed || m_step != m_blocks.size()) {
+        m_planValid = false;
+        return false;
+    }
+    return true;
+}
+
+void PlannedAllocator::buildPlan()
+{
+    //按大小从大到小依次放置，每块放到与其生命周期重叠的已放置块之间第一个放得下的空隙
+    std::vector<int> order(m_blocks.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<int>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int l, int r) {
+        return m_blocks[l].size > m_blocks[r].size;
+    });
+
+    std::vector<int> placed;
+    size_t total = 0;
+    for (int index : order) {
+        Block &block = m_blocks[index];
+        size_t bytes = blockBytes(block.size);
+
+        std::vector<std::pair<size_t, size_t> > busy;
+        for (int other : placed) {
+            const Block &placedBlock = m_blocks[other];
+            if (placedBlock.allocTime < block.freeTime && block.allocTime < placedBlock.freeTime) {
+                busy.push_back(std::make_pair(placedBlock.offset, placedBlock.offset + blockBytes(placedBlock.size)));
+            }
+        }
+        std::sort(busy.begin(), busy.end());
+
+        size_t offset = 0;
+        for (const auto &range : busy) {
+            if (offset + bytes <= range.first) {
+                break;
+            }
+            offset = std::max(offset, range.second);
+        }
+
+        block.offset = offset;
+        total = std::max(total, offset + bytes);
+        placed.push_back(index);
+    }
+
+    //记录内存区域重叠的块，回放时用于校验
+    for (size_t i = 0; i < m_blocks.size(); i++) {
+        Block &block = m_blocks[i];
+        block.conflicts.clear();
+        for (size_t j = 0; j < i; j++) {
+            const Block &earlier = m_blocks[j];
+            if (earlier.offset < block.offset + blockBytes(block.size) && block.offset < earlier.offset + blockBytes(earlier.size)) {
+                block.conflicts.push_back(static_cast<int>(j));
+            }
+        }
+    }
+
+    resetArena();
+    m_arena = static_cast<unsigned char *>(ncnn::fastMalloc(total));
+    m_arenaSize = m_arena ? total : 0;
+    m_planValid = m_arena != nullptr;
+}
+
+void *PlannedAllocator::fastMalloc(size_t size)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_recording) {
+        void *ptr = ncnn::fastMalloc(size);
+        Block block;
+        block.size = size;
+        block.allocTime = m_clock++;
+        m_liveBlocks[ptr] = static_cast<int>(m_blocks.size());
+        m_blocks.push_back(block);
+        return ptr;
+    }
+
+    //按规划取用，大小不符或者重叠的块尚未释放时退回普通分配
+    if (!m_missed && m_step < m_blocks.size() && m_blocks[m_step].size == size) {
+        const Block &block = m_blocks[m_step];
+        bool available = std::none_of(block.conflicts.begin(), block.conflicts.end(), [this](int other) {
+            return m_live[other];
+        });
+        if (available) {
+            void *ptr = m_arena + block.offset;
+            m_live[m_step] = true;
+            m_liveBlocks[ptr] = static_cast<int>(m_step);
+            m_step++;
+            return ptr;
+        }
+    }
+
+    m_missed = true;
+    return ncnn::fastMalloc(size);
+}
+
+void PlannedAllocator::fastFree(void *ptr)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    auto it = m_liveBlocks.find(ptr);
+    if (it == m_liveBlocks.end()) {
+        ncnn::fastFree(ptr);
+        return;
+    }
+
+    int index = it->second;
+    m_liveBlocks.erase(it);
+    if (m_recording) {
+        m_blocks[index].freeTime = m_clock++;
+        ncnn::fastFree(ptr);
+    } else {
+        m_live[index] = false;
+    }
+}
+
+bool PlannedAllocator::hasPlan(int width, int height) const
+{
+    return m_planValid && m_shape == std::make_pair(width, height);
+}
+
+size_t PlannedAllocator::arenaSize() const
+{
+    return m_arenaSize;
+}
+
+MemoryPlanPool::MemoryPlanPool(size_t maxIdle)
+    : m_maxIdle(maxIdle)
+{
+}
+
+MemoryPlanPool::~MemoryPlanPool()
+{
+    for (PlannedAllocator *allocator : m_idle) {
+        delete allocator;
+    }
+}
+
+PlannedAllocator *MemoryPlanPool::acquire(int width, int height)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_idle.empty()) {
+        return new PlannedAllocator;
+    }
+
+    auto it = std::find_if(m_idle.begin(), m_idle.end(), [width, height](PlannedAllocator *allocator) {
+        return allocator->hasPlan(width, height);
+    });
+    if (it == m_idle.end()) {
+        it = m_idle.begin();
+    }
+    PlannedAllocator *allocator = *it;
+    m_idle.erase(it);
+    return allocator;
+}
+
+void MemoryPlanPool::release(PlannedAllocator *allocator)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_idle.size() < m_maxIdle) {
+        m_idle.push_back(allocator);
+    } else {
+        delete allocator;
+    }
+}
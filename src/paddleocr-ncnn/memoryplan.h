@@ -0,0 +1,92 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ncnn
+#include "allocator.h"
+
+//静态内存规划分配器
+//同一网络对同一输入尺寸推理时，内存申请和释放的顺序是固定的。第一次推理记录下每块内存的大小和生命周期，
+//之后按生命周期不重叠即可复用的原则为每块内存在一整块内存池中分配固定偏移，后续推理直接按偏移取用，不再向系统申请内存
+class PlannedAllocator : public ncnn::Allocator
+{
+public:
+    PlannedAllocator();
+    ~PlannedAllocator() override;
+
+    //开始一次推理，输入尺寸与已有规划不同时重新记录
+    void begin(int width, int height);
+
+    //结束一次推理，调用前必须释放所有由本分配器申请的ncnn::Mat
+    //返回本次是否完全按规划分配
+    bool end();
+
+    void *fastMalloc(size_t size) override;
+    void fastFree(void *ptr) override;
+
+    bool hasPlan(int width, int height) const;
+    size_t arenaSize() const;
+
+private:
+    struct Block {
+        size_t size = 0;
+        size_t offset = 0;
+        int allocTime = 0;
+        int freeTime = -1;
+        std::vector<int> conflicts; //内存区域重叠且更早申请的块，取用前这些块必须都已释放
+    };
+
+    void buildPlan();
+    void resetArena();
+
+    std::mutex m_mutex;
+    std::pair<int, int> m_shape;
+    bool m_recording;
+    bool m_planValid;
+    bool m_missed;
+    int m_clock;
+    size_t m_step;
+
+    std::vector<Block> m_blocks;
+    std::vector<bool> m_live;
+    std::unordered_map<void *, int> m_liveBlocks; //指针 -> 块序号
+    unsigned char *m_arena;
+    size_t m_arenaSize;
+};
+
+//规划分配器池：并发推理时每个请求各取一个分配器，优先复用已为相同尺寸做好规划的分配器
+class MemoryPlanPool
+{
+public:
+    explicit MemoryPlanPool(size_t maxIdle = 4);
+    ~MemoryPlanPool();
+
+    PlannedAllocator *acquire(int width, int height);
+    void release(PlannedAllocator *allocator);
+
+private:
+    std::mutex m_mutex;
+    std::vector<PlannedAllocator *> m_idle;
+    size_t m_maxIdle;
+};
@@ -0,0 +1,388 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "metrics.h"
+#include "atomicfile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <type_traits>
+
+const double EngineMetrics::BoundsMs[EngineMetrics::BoundCount] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000};
+
+//一个线程的分片，只有所属线程写入，其他线程只在合并时读取
+struct EngineMetrics::Shard {
+    std::atomic<long long> counters[CounterCount];
+    std::atomic<unsigned long long> buckets[StageCount][BoundCount + 1];
+    std::atomic<unsigned long long> sumUs[StageCount];
+
+    Shard()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (auto &value : counters) {
+            value.store(0, std::memory_order_relaxed);
+        }
+        for (auto &stage : buckets) {
+            for (auto &value : stage) {
+                value.store(0, std::memory_order_relaxed);
+            }
+        }
+        for (auto &value : sumUs) {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    //合并时调用，须持有EngineMetrics::m_mutex
+    void mergeInto(Shard &total) const
+    {
+        for (int i = 0; i < CounterCount; i++) {
+            bump(total.counters[i], counters[i].load(std::memory_order_relaxed));
+        }
+        for (int s = 0; s < StageCount; s++) {
+            for (int b = 0; b <= BoundCount; b++) {
+                bump(total.buckets[s][b], buckets[s][b].load(std::memory_order_relaxed));
+            }
+            bump(total.sumUs[s], sumUs[s].load(std::memory_order_relaxed));
+        }
+    }
+
+    //只有一个写入方，读出再写回即可，比原子加法便宜
+    template<typename T>
+    static void bump(std::atomic<T> &value, T n)
+    {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+//线程退出时把分片交还
+struct ShardHandle {
+    EngineMetrics::Shard *shard = nullptr;
+
+    ~ShardHandle()
+    {
+        if (shard) {
+            EngineMetrics::instance()->retireShard(shard);
+        }
+    }
+};
+
+static thread_local ShardHandle currentShard;
+
+EngineMetrics *EngineMetrics::instance()
+{
+    //不析构：进程退出时可能还有分离的线程在记录
+    static EngineMetrics *metrics = new EngineMetrics;
+    return metrics;
+}
+
+EngineMetrics::EngineMetrics()
+    : m_retired(new Shard)
+    , m_start(std::chrono::steady_clock::now())
+{
+    for (auto &value : m_gauges) {
+        value = 0;
+    }
+}
+
+EngineMetrics::Shard *EngineMetrics::localShard()
+{
+    if (!currentShard.shard) {
+        currentShard.shard = acquireShard();
+    }
+    return currentShard.shard;
+}
+
+EngineMetrics::Shard *EngineMetrics::acquireShard()
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    Shard *shard;
+    if (m_free.empty()) {
+        shard = new Shard;
+    } else {
+        shard = m_free.back();
+        m_free.pop_back();
+    }
+    m_live.push_back(shard);
+    return shard;
+}
+
+void EngineMetrics::retireShard(Shard *shard)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    shard->mergeInto(*m_retired);
+    shard->clear();
+    for (size_t i = 0; i < m_live.size(); i++) {
+        if (m_live[i] == shard) {
+            m_live[i] = m_live.back();
+            m_live.pop_back();
+            break;
+        }
+    }
+    m_free.push_back(shard);
+}
+
+void EngineMetrics::add(Counter counter, long long n)
+{
+    Shard::bump(localShard()->counters[counter], n);
+}
+
+void EngineMetrics::observe(Stage stage, double ms)
+{
+    int bucket = 0;
+    while (bucket < BoundCount && ms > BoundsMs[bucket]) {
+        bucket++;
+    }
+    Shard *shard = localShard();
+    Shard::bump(shard->buckets[stage][bucket], 1ull);
+    Shard::bump(shard->sumUs[stage], static_cast<unsigned long long>(ms * 1000.0));
+}
+
+void EngineMetrics::absorb(const Snapshot &snapshot)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    for (int i = 0; i < CounterCount; i++) {
+        Shard::bump(m_retired->counters[i], snapshot.counters[i]);
+    }
+    for (int s = 0; s < StageCount; s++) {
+        for (int b = 0; b <= BoundCount; b++) {
+            Shard::bump(m_retired->buckets[s][b], snapshot.stages[s].buckets[b]);
+        }
+        Shard::bump(m_retired->sumUs[s], static_cast<unsigned long long>(snapshot.stages[s].sumMs * 1000.0));
+    }
+}
+
+void EngineMetrics::setGauge(Gauge gauge, long long value)
+{
+    m_gauges[gauge] = value;
+}
+
+EngineMetrics::Snapshot EngineMetrics::snapshot()
+{
+    Shard total;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_retired->mergeInto(total);
+        for (const Shard *shard : m_live) {
+            shard->mergeInto(total);
+        }
+    }
+
+    Snapshot snapshot;
+    for (int i = 0; i < CounterCount; i++) {
+        snapshot.counters[i] = total.counters[i].load(std::memory_order_relaxed);
+    }
+    for (int s = 0; s < StageCount; s++) {
+        Histogram &histogram = snapshot.stages[s];
+        for (int b = 0; b <= BoundCount; b++) {
+            histogram.buckets[b] = total.buckets[s][b].load(std::memory_order_relaxed);
+            histogram.count += histogram.buckets[b];
+        }
+        histogram.sumMs = total.sumUs[s].load(std::memory_order_relaxed) / 1000.0;
+    }
+    for (int i = 0; i < GaugeCount; i++) {
+        snapshot.gauges[i] = m_gauges[i];
+    }
+    snapshot.uptimeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    return snapshot;
+}
+
+double EngineMetrics::Histogram::quantileMs(double q) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    double rank = q * count;
+    unsigned long long seen = 0;
+    for (int b = 0; b <= BoundCount; b++) {
+        if (buckets[b] == 0 || seen + buckets[b] < rank) {
+            seen += buckets[b];
+            continue;
+        }
+        //最后一档没有上界，取下界
+        double lower = b == 0 ? 0 : BoundsMs[b - 1];
+        if (b == BoundCount) {
+            return lower;
+        }
+        return lower + (BoundsMs[b] - lower) * (rank - seen) / buckets[b];
+    }
+    return BoundsMs[BoundCount - 1];
+}
+
+double EngineMetrics::Snapshot::hitRate(Counter hits, Counter misses) const
+{
+    long long total = counters[hits] + counters[misses];
+    return total > 0 ? static_cast<double>(counters[hits]) / total : 0;
+}
+
+void EngineMetrics::Snapshot::merge(const Snapshot &other)
+{
+    for (int i = 0; i < CounterCount; i++) {
+        counters[i] += other.counters[i];
+    }
+    for (int s = 0; s < StageCount; s++) {
+        for (int b = 0; b <= BoundCount; b++) {
+            stages[s].buckets[b] += other.stages[s].buckets[b];
+        }
+        stages[s].count += other.stages[s].count;
+        stages[s].sumMs += other.stages[s].sumMs;
+    }
+    for (int i = 0; i < GaugeCount; i++) {
+        gauges[i] += other.gauges[i];
+    }
+    uptimeSeconds = std::max(uptimeSeconds, other.uptimeSeconds);
+}
+
+static_assert(std::is_trivially_copyable<EngineMetrics::Snapshot>::value, "snapshot is encoded by its memory layout");
+
+std::string EngineMetrics::Snapshot::encode() const
+{
+    return std::string(reinterpret_cast<const char *>(this), sizeof(Snapshot));
+}
+
+bool EngineMetrics::Snapshot::decode(const std::string &data, Snapshot &snapshot)
+{
+    if (data.size() != sizeof(Snapshot)) {
+        return false;
+    }
+    memcpy(&snapshot, data.data(), sizeof(Snapshot));
+    return true;
+}
+
+//计数在Prometheus中的名称、标签、类型和单位换算，与Counter一一对应
+struct CounterInfo {
+    const char *name;
+    const char *labels;
+    const char *type;
+    const char *help;
+    double scale;
+};
+
+static const CounterInfo COUNTER_INFO[EngineMetrics::CounterCount] = {
+    {"lingmo_ocr_requests_total", "", "counter", "Recognition requests.", 1},
+    {"lingmo_ocr_requests_dropped_total", "", "counter", "Requests rejected because a recognition was in progress.", 1},
+    {"lingmo_ocr_requests_in_flight", "", "gauge", "Requests being recognized.", 1},
+    {"lingmo_ocr_text_lines_total", "", "counter", "Recognized text lines.", 1},
+    {"lingmo_ocr_cache_hits_total", "cache=\"memory_plan\"", "counter", "Cache hits.", 1},
+    {"lingmo_ocr_cache_hits_total", "cache=\"conv_tune\"", "counter", "Cache hits.", 1},
+    {"lingmo_ocr_cache_misses_total", "cache=\"memory_plan\"", "counter", "Cache misses.", 1},
+    {"lingmo_ocr_cache_misses_total", "cache=\"conv_tune\"", "counter", "Cache misses.", 1},
+    {"lingmo_ocr_worker_busy_seconds_total", "", "counter", "Time the thread pool spent running tasks.", 1e-6},
+};
+
+static const char *STAGE_NAMES[EngineMetrics::StageCount] = {"request", "detect", "recognize"};
+
+static const CounterInfo GAUGE_INFO[EngineMetrics::GaugeCount] = {
+    {"lingmo_ocr_model_bytes", "", "gauge", "Weight bytes of the loaded models.", 1},
+    {"lingmo_ocr_worker_threads", "", "gauge", "Threads in the pool, including the caller.", 1},
+    {"lingmo_ocr_queue_depth", "queue=\"recognize\"", "gauge", "Items waiting in a queue.", 1},
+    {"lingmo_ocr_queue_depth", "queue=\"watch\"", "gauge", "Items waiting in a queue.", 1},
+};
+
+static void writeSample(std::ostringstream &out, const char *name, const std::string &labels, double value)
+{
+    out << name;
+    if (!labels.empty()) {
+        out << '{' << labels << '}';
+    }
+    out << ' ' << value << '\n';
+}
+
+static void writeHeader(std::ostringstream &out, const char *name, const char *type, const char *help)
+{
+    out << "# HELP " << name << ' ' << help << '\n'
+        << "# TYPE " << name << ' ' << type << '\n';
+}
+
+std::string EngineMetrics::prometheusText()
+{
+    return prometheusText(snapshot());
+}
+
+std::string EngineMetrics::prometheusText(const Snapshot &current)
+{
+    std::ostringstream out;
+    out.precision(12);
+
+    for (int i = 0; i < CounterCount; i++) {
+        const CounterInfo &info = COUNTER_INFO[i];
+        if (i == 0 || std::string(info.name) != COUNTER_INFO[i - 1].name) {
+            writeHeader(out, info.name, info.type, info.help);
+        }
+        writeSample(out, info.name, info.labels, current.counters[i] * info.scale);
+    }
+
+    const char *histogramName = "lingmo_ocr_stage_duration_seconds";
+    writeHeader(out, histogramName, "histogram", "Duration of recognition stages.");
+    for (int s = 0; s < StageCount; s++) {
+        const Histogram &histogram = current.stages[s];
+        std::string stage = std::string("stage=\"") + STAGE_NAMES[s] + "\"";
+        unsigned long long cumulative = 0;
+        for (int b = 0; b <= BoundCount; b++) {
+            cumulative += histogram.buckets[b];
+            std::ostringstream le;
+            if (b < BoundCount) {
+                le << BoundsMs[b] / 1000.0;
+            } else {
+                le << "+Inf";
+            }
+            writeSample(out, "lingmo_ocr_stage_duration_seconds_bucket", stage + ",le=\"" + le.str() + "\"", static_cast<double>(cumulative));
+        }
+        writeSample(out, "lingmo_ocr_stage_duration_seconds_sum", stage, histogram.sumMs / 1000.0);
+        writeSample(out, "lingmo_ocr_stage_duration_seconds_count", stage, static_cast<double>(histogram.count));
+    }
+
+    for (int i = 0; i < GaugeCount; i++) {
+        const CounterInfo &info = GAUGE_INFO[i];
+        if (i == 0 || std::string(info.name) != GAUGE_INFO[i - 1].name) {
+            writeHeader(out, info.name, info.type, info.help);
+        }
+        writeSample(out, info.name, info.labels, current.gauges[i] * info.scale);
+    }
+    writeHeader(out, "lingmo_ocr_uptime_seconds", "gauge", "Seconds since the metrics registry was created.");
+    writeSample(out, "lingmo_ocr_uptime_seconds", "", current.uptimeSeconds);
+    return out.str();
+}
+
+bool EngineMetrics::writeTextFile(const std::string &path)
+{
+    return writeTextFile(path, prometheusText());
+}
+
+bool EngineMetrics::writeTextFile(const std::string &path, const std::string &text)
+{
+    return replaceFile(path, text.data(), text.size());
+}
+
+EngineMetrics::Timer::Timer(Stage stage, bool enabled)
+    : m_stage(stage)
+    , m_enabled(enabled)
+    , m_start(std::chrono::steady_clock::now())
+{
+}
+
+EngineMetrics::Timer::~Timer()
+{
+    if (!m_enabled) {
+        return;
+    }
+    EngineMetrics::instance()->observe(m_stage, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count());
+}
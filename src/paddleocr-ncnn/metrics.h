@@ -0,0 +1,145 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//引擎运行指标，整个进程共用一份，切换语言和重新加载模型后继续累计
+//计数和耗时分布按线程分片记录：每个线程只写自己的分片，不需要加锁或原子的读改写，也不会与其他线程争用缓存行；
+//读取时加锁合并所有分片。线程退出时分片中的数据并入汇总后留给新线程复用
+class EngineMetrics
+{
+public:
+    //各线程分别累加、读取时合并的计数；正在执行的请求数这类有增有减的量也按分片加减
+    //同名的Prometheus指标须连续排列
+    enum Counter {
+        Requests,         //识别请求数
+        RequestsDropped,  //因为正在识别中而被拒绝的请求数
+        RequestsInFlight, //正在执行的请求数
+        TextLines,        //识别出的文本行数
+        MemoryPlanHits,   //完全按内存规划执行的检测推理次数
+        ConvTuneHits,     //直接使用已有卷积调优结果的检测推理次数
+        MemoryPlanMisses, //记录内存规划或偏离规划的检测推理次数
+        ConvTuneMisses,   //现场调优卷积实现的次数
+        WorkerBusyUs,     //线程池执行任务的累计微秒数
+        CounterCount
+    };
+
+    //耗时分布
+    enum Stage {
+        RequestStage,   //整个请求
+        DetectStage,    //一次检测网络推理，包括预处理
+        RecognizeStage, //一批文本行的识别网络推理
+        StageCount
+    };
+
+    //由所有者直接设置的当前值；同名的Prometheus指标须连续排列
+    enum Gauge {
+        ModelBytes,          //当前引擎加载的模型权重字节数
+        WorkerThreads,       //线程池的线程数，包括调用方
+        RecognizeQueueDepth, //等待凑成一批识别的文本行数
+        WatchQueueDepth,     //监视目录中等待识别的图片数
+        GaugeCount
+    };
+
+    //耗时分档的上界，单位毫秒；最后还有一档没有上界
+    static const int BoundCount = 13;
+    static const double BoundsMs[BoundCount];
+
+    struct Histogram {
+        unsigned long long buckets[BoundCount + 1] = {}; //落在各档的次数，不累积
+        unsigned long long count = 0;
+        double sumMs = 0;
+
+        //按分档线性插值估计分位数，没有记录时返回0
+        double quantileMs(double q) const;
+    };
+
+    struct Snapshot {
+        long long counters[CounterCount] = {};
+        Histogram stages[StageCount];
+        long long gauges[GaugeCount] = {};
+        double uptimeSeconds = 0;
+
+        //hits / (hits + misses)，没有记录时返回0
+        double hitRate(Counter hits, Counter misses) const;
+
+        //累加另一个进程的指标，当前值也相加，运行时间取较长的一个
+        void merge(const Snapshot &other);
+
+        //在同一程序的进程之间传递，按内存布局原样编码
+        std::string encode() const;
+        static bool decode(const std::string &data, Snapshot &snapshot);
+    };
+
+    //记录从构造到析构经过的时间；enabled为false时不记录
+    class Timer
+    {
+    public:
+        explicit Timer(Stage stage, bool enabled = true);
+        ~Timer();
+
+    private:
+        Stage m_stage;
+        bool m_enabled;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    static EngineMetrics *instance();
+
+    void add(Counter counter, long long n = 1);
+    void observe(Stage stage, double ms);
+    void setGauge(Gauge gauge, long long value);
+
+    //并入已退出的工作进程最后的计数和耗时分布，当前值随进程退出而失效，不并入
+    void absorb(const Snapshot &snapshot);
+
+    //合并所有线程的分片
+    Snapshot snapshot();
+
+    //Prometheus文本格式
+    std::string prometheusText();
+    static std::string prometheusText(const Snapshot &snapshot);
+
+    //先写临时文件再改名替换，读取方不会读到写了一半的内容
+    bool writeTextFile(const std::string &path);
+    static bool writeTextFile(const std::string &path, const std::string &text);
+
+private:
+    struct Shard;
+    friend struct ShardHandle;
+
+    EngineMetrics();
+    EngineMetrics(const EngineMetrics &) = delete;
+    EngineMetrics &operator=(const EngineMetrics &) = delete;
+
+    Shard *localShard();
+    Shard *acquireShard();
+    void retireShard(Shard *shard);
+
+    std::mutex m_mutex;
+    std::vector<Shard *> m_live; //属于活动线程的分片
+    std::vector<Shard *> m_free; //已退出线程留下的分片，数据已并入m_retired
+    Shard *m_retired;            //已退出线程的数据汇总
+    std::atomic<long long> m_gauges[GaugeCount];
+    std::chrono::steady_clock::time_point m_start;
+};
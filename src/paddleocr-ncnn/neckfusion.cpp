@@ -0,0 +1,500 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "neckfusion.h"
+
+#include <algorithm>
+#include <cstring>
+
+// ncnn
+#include "blob.h"
+#include "layer_type.h"
+#include "net.h"
+
+static const char *FUSED_TYPE = "FpnUpsampleFuse";
+
+DEFINE_LAYER_CREATOR(FpnUpsampleFuse)
+
+FpnUpsampleFuse::FpnUpsampleFuse()
+    : mode(Add)
+    , original(nullptr)
+    , outElempack(0)
+{
+    one_blob_only = false;
+    support_inplace = false;
+    support_packing = true;
+}
+
+FpnUpsampleFuse::~FpnUpsampleFuse()
+{
+    delete original;
+}
+
+int FpnUpsampleFuse::destroy_pipeline(const ncnn::Option &opt)
+{
+    if (original) {
+        return original->destroy_pipeline(opt);
+    }
+    return 0;
+}
+
+//把一行低分辨率像素横向重复s次写出，每个像素elempack个float；E非0时按编译期常量展开
+template<int E>
+static inline void expandRow(const float *src, float *dst, int srcw, int s, int elempack)
+{
+    const int e = E ? E : elempack;
+    for (int x = 0; x < srcw; x++) {
+        for (int k = 0; k < s; k++) {
+            for (int i = 0; i < e; i++) {
+                dst[i] = src[i];
+            }
+            dst += e;
+        }
+        src += e;
+    }
+}
+
+//同上，写出时加上同位置的全分辨率输入a
+template<int E>
+static inline void expandAddRow(const float *a, const float *src, float *dst, int srcw, int s, int elempack)
+{
+    const int e = E ? E : elempack;
+    for (int x = 0; x < srcw; x++) {
+        for (int k = 0; k < s; k++) {
+            for (int i = 0; i < e; i++) {
+                dst[i] = a[i] + src[i];
+            }
+            a += e;
+            dst += e;
+        }
+        src += e;
+    }
+}
+
+template<int E>
+static void upsampleAdd(const ncnn::Mat &a, const ncnn::Mat &b, ncnn::Mat &top, int s, const ncnn::Option &opt)
+{
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < top.c; q++) {
+        const ncnn::Mat ac = a.channel(q);
+        const ncnn::Mat bc = b.channel(q);
+        ncnn::Mat oc = top.channel(q);
+        for (int y = 0; y < top.h; y++) {
+            expandAddRow<E>(ac.row(y), bc.row(y / s), oc.row(y), b.w, s, top.elempack);
+        }
+    }
+}
+
+template<int E>
+static void upsampleCopy(const ncnn::Mat &src, ncnn::Mat &top, int channelOffset, int s, const ncnn::Option &opt)
+{
+    const size_t rowBytes = static_cast<size_t>(top.w) * top.elemsize;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < src.c; q++) {
+        const ncnn::Mat sc = src.channel(q);
+        ncnn::Mat oc = top.channel(channelOffset + q);
+        if (s == 1) {
+            memcpy(oc.data, sc.data, rowBytes * top.h);
+            continue;
+        }
+        for (int y = 0; y < top.h; y++) {
+            //同一源行展开出的s行完全相同，后面几行直接复制上一行
+            if (y % s != 0) {
+                memcpy(oc.row(y), oc.row(y - 1), rowBytes);
+            } else {
+                expandRow<E>(sc.row(y / s), oc.row(y), src.w, s, top.elempack);
+            }
+        }
+    }
+}
+
+//把一行低分辨率像素中连续的len个通道横向重复s次，写到输出行中每个像素的同一段通道；L非0时按编译期常量展开
+template<int L>
+static inline void gatherRow(const float *src, float *dst, int srcw, int s, int srcStep, int dstStep, int len)
+{
+    const int n = L ? L : len;
+    for (int x = 0; x < srcw; x++) {
+        for (int k = 0; k < s; k++) {
+            for (int i = 0; i < n; i++) {
+                dst[i] = src[i];
+            }
+            dst += dstStep;
+        }
+        src += srcStep;
+    }
+}
+
+//拼接结果按top的elempack写出，与输入的elempack不同：逐行从各输入的对应通道成段取值，省去下一层之前对整块结果重新打包
+static void upsampleConcatRepack(const std::vector<ncnn::Mat> &bottoms, const std::vector<int> &scales, ncnn::Mat &top, const ncnn::Option &opt)
+{
+    //输出的每个通道对应的输入序号和该输入中的通道
+    std::vector<std::pair<int, int>> sources;
+    for (size_t i = 0; i < bottoms.size(); i++) {
+        for (int ch = 0; ch < bottoms[i].c * bottoms[i].elempack; ch++) {
+            sources.emplace_back(static_cast<int>(i), ch);
+        }
+    }
+
+    const int outpack = top.elempack;
+    const size_t rowBytes = static_cast<size_t>(top.w) * top.elemsize;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < top.c; q++) {
+        //输出通道的各段来自上采样倍数相同的输入时，同一源行展开出的几行完全相同
+        int rowScale = scales[sources[q * outpack].first];
+        for (int k = 1; k < outpack; k++) {
+            if (scales[sources[q * outpack + k].first] != rowScale) {
+                rowScale = 1;
+            }
+        }
+
+        ncnn::Mat oc = top.channel(q);
+        for (int y = 0; y < top.h; y++) {
+            float *dst = oc.row(y);
+            if (y % rowScale != 0) {
+                memcpy(dst, oc.row(y - 1), rowBytes);
+                continue;
+            }
+            //一个输出像素的outpack个通道分成若干段，每段来自同一输入像素中连续的通道
+            for (int k = 0; k < outpack;) {
+                const int index = sources[q * outpack + k].first;
+                const int ch = sources[q * outpack + k].second;
+                const ncnn::Mat &m = bottoms[index];
+                const int s = scales[index];
+                const int e = m.elempack;
+                const int len = std::min(e - ch % e, outpack - k);
+                const float *src = m.channel(ch / e).row(y / s) + ch % e;
+                switch (len) {
+                case 4: gatherRow<4>(src, dst + k, m.w, s, e, outpack, len); break;
+                case 8: gatherRow<8>(src, dst + k, m.w, s, e, outpack, len); break;
+                default: gatherRow<0>(src, dst + k, m.w, s, e, outpack, len); break;
+                }
+                k += len;
+            }
+        }
+    }
+}
+
+bool FpnUpsampleFuse::fastPathFits(const std::vector<ncnn::Mat> &bottom_blobs) const
+{
+    if (bottom_blobs.size() != scales.size()) {
+        return false;
+    }
+    const ncnn::Mat &ref = bottom_blobs[0];
+    const int outw = ref.w * scales[0];
+    const int outh = ref.h * scales[0];
+    for (size_t i = 0; i < bottom_blobs.size(); i++) {
+        const ncnn::Mat &m = bottom_blobs[i];
+        if (m.dims != 3 || m.elempack != ref.elempack || m.elemsize != 4u * m.elempack) {
+            return false;
+        }
+        if (m.w * scales[i] != outw || m.h * scales[i] != outh) {
+            return false;
+        }
+        if (mode == Add && m.c != ref.c) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int FpnUpsampleFuse::forwardFallback(const std::vector<ncnn::Mat> &bottom_blobs, std::vector<ncnn::Mat> &top_blobs, const ncnn::Option &opt) const
+{
+    //形状或存储格式不满足快速路径时，按原来的Interp + BinaryOp/Concat逐层计算
+    std::vector<ncnn::Mat> inputs(bottom_blobs.size());
+    for (size_t i = 0; i < bottom_blobs.size(); i++) {
+        if (interps[i]) {
+            int ret = interps[i]->forward(bottom_blobs[i], inputs[i], opt);
+            if (ret != 0) {
+                return ret;
+            }
+        } else {
+            inputs[i] = bottom_blobs[i];
+        }
+    }
+    return original->forward(inputs, top_blobs, opt);
+}
+
+int FpnUpsampleFuse::forward(const std::vector<ncnn::Mat> &bottom_blobs, std::vector<ncnn::Mat> &top_blobs, const ncnn::Option &opt) const
+{
+    if (!fastPathFits(bottom_blobs)) {
+        return forwardFallback(bottom_blobs, top_blobs, opt);
+    }
+
+    const ncnn::Mat &ref = bottom_blobs[0];
+    const int elempack = ref.elempack;
+    const int outw = ref.w * scales[0];
+    const int outh = ref.h * scales[0];
+    int outc = ref.c;
+    if (mode == Concat) {
+        outc = 0;
+        for (const ncnn::Mat &m : bottom_blobs) {
+            outc += m.c;
+        }
+    }
+
+    //拼接的总通道数能被outElempack整除时直接按它写出
+    int outpack = elempack;
+    if (mode == Concat && outElempack > 0 && outc * elempack % outElempack == 0) {
+        outpack = outElempack;
+    }
+
+    ncnn::Mat &top = top_blobs[0];
+    top.create(outw, outh, outc * elempack / outpack, 4u * outpack, outpack, opt.blob_allocator);
+    if (top.empty()) {
+        return -100;
+    }
+    if (outpack != elempack) {
+        upsampleConcatRepack(bottom_blobs, scales, top, opt);
+        return 0;
+    }
+
+    if (mode == Add) {
+        const ncnn::Mat &a = bottom_blobs[0];
+        const ncnn::Mat &b = bottom_blobs[1];
+        const int s = scales[1];
+        switch (elempack) {
+        case 1: upsampleAdd<1>(a, b, top, s, opt); break;
+        case 4: upsampleAdd<4>(a, b, top, s, opt); break;
+        case 8: upsampleAdd<8>(a, b, top, s, opt); break;
+        case 16: upsampleAdd<16>(a, b, top, s, opt); break;
+        default: upsampleAdd<0>(a, b, top, s, opt); break;
+        }
+        return 0;
+    }
+
+    int channelOffset = 0;
+    for (size_t i = 0; i < bottom_blobs.size(); i++) {
+        const ncnn::Mat &m = bottom_blobs[i];
+        const int s = scales[i];
+        switch (elempack) {
+        case 1: upsampleCopy<1>(m, top, channelOffset, s, opt); break;
+        case 4: upsampleCopy<4>(m, top, channelOffset, s, opt); break;
+        case 8: upsampleCopy<8>(m, top, channelOffset, s, opt); break;
+        case 16: upsampleCopy<16>(m, top, channelOffset, s, opt); break;
+        default: upsampleCopy<0>(m, top, channelOffset, s, opt); break;
+        }
+        channelOffset += m.c;
+    }
+    return 0;
+}
+
+static ncnn::Mat probeInput(int w, int h, int c, float base)
+{
+    ncnn::Mat m(w, h, c);
+    for (int q = 0; q < c; q++) {
+        float *ptr = m.channel(q);
+        for (int i = 0; i < w * h; i++) {
+            ptr[i] = base + q * w * h + i;
+        }
+    }
+    return m;
+}
+
+//试算确认Interp是最近邻、宽高同为2的整数次幂倍的上采样，且输出尺寸随输入变化，返回倍数，不是时返回0
+static int probeNearestScale(const ncnn::Layer *layer, const ncnn::Option &opt)
+{
+    if (layer->typeindex != ncnn::LayerType::Interp || !layer->one_blob_only) {
+        return 0;
+    }
+
+    ncnn::Mat in = probeInput(7, 5, 2, 0.f);
+    ncnn::Mat out;
+    if (layer->forward(in, out, opt) != 0 || out.dims != 3 || out.c != 2 || out.elempack != 1 || out.w % in.w != 0) {
+        return 0;
+    }
+    const int s = out.w / in.w;
+    if (s < 2 || (s & (s - 1)) != 0 || out.h != in.h * s) {
+        return 0;
+    }
+    for (int q = 0; q < out.c; q++) {
+        for (int y = 0; y < out.h; y++) {
+            const float *src = in.channel(q).row(y / s);
+            const float *dst = out.channel(q).row(y);
+            for (int x = 0; x < out.w; x++) {
+                if (dst[x] != src[x / s]) {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    ncnn::Mat in2 = probeInput(3, 2, 1, 0.f);
+    ncnn::Mat out2;
+    if (layer->forward(in2, out2, opt) != 0 || out2.w != in2.w * s || out2.h != in2.h * s) {
+        return 0;
+    }
+    return s;
+}
+
+//试算确认BinaryOp是两个输入逐元素相加
+static bool probeAdd(const ncnn::Layer *layer, const ncnn::Option &opt)
+{
+    if (layer->typeindex != ncnn::LayerType::BinaryOp || layer->one_blob_only || layer->bottoms.size() != 2 || layer->tops.size() != 1) {
+        return false;
+    }
+
+    std::vector<ncnn::Mat> in = {probeInput(3, 2, 2, 1.f), probeInput(3, 2, 2, 100.f)};
+    std::vector<ncnn::Mat> out(1);
+    if (layer->forward(in, out, opt) != 0 || out[0].dims != 3 || out[0].total() != in[0].total() || out[0].elempack != 1) {
+        return false;
+    }
+    for (int q = 0; q < out[0].c; q++) {
+        const float *a = in[0].channel(q);
+        const float *b = in[1].channel(q);
+        const float *o = out[0].channel(q);
+        for (int i = 0; i < out[0].w * out[0].h; i++) {
+            if (o[i] != a[i] + b[i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//试算确认Concat按通道拼接
+static bool probeChannelConcat(const ncnn::Layer *layer, const ncnn::Option &opt)
+{
+    if (layer->typeindex != ncnn::LayerType::Concat || layer->bottoms.size() < 2 || layer->tops.size() != 1) {
+        return false;
+    }
+
+    std::vector<ncnn::Mat> in = {probeInput(3, 2, 1, 1.f), probeInput(3, 2, 2, 100.f)};
+    std::vector<ncnn::Mat> out(1);
+    if (layer->forward(in, out, opt) != 0 || out[0].dims != 3 || out[0].w != 3 || out[0].h != 2 || out[0].c != 3 || out[0].elempack != 1) {
+        return false;
+    }
+    for (int q = 0; q < 3; q++) {
+        const float *src = q == 0 ? in[0].channel(0) : in[1].channel(q - 1);
+        if (memcmp(out[0].channel(q).data, src, 6 * sizeof(float)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FpnUpsampleFuse *asFpnUpsampleFuse(ncnn::Net *net, ncnn::Layer *layer)
+{
+    int index = net->custom_layer_to_index(FUSED_TYPE);
+    if (index == -1 || layer->typeindex != (ncnn::LayerType::CustomBit | index)) {
+        return nullptr;
+    }
+    return static_cast<FpnUpsampleFuse *>(layer);
+}
+
+int fuseFpnNeck(ncnn::Net *net)
+{
+    if (net->custom_layer_to_index(FUSED_TYPE) == -1) {
+        net->register_custom_layer(FUSED_TYPE, FpnUpsampleFuse_layer_creator);
+    }
+    const int fusedTypeIndex = ncnn::LayerType::CustomBit | net->custom_layer_to_index(FUSED_TYPE);
+
+    std::vector<ncnn::Layer *> &layers = net->mutable_layers();
+    std::vector<ncnn::Blob> &blobs = net->mutable_blobs();
+
+    //试算用单线程、不打包的fp32
+    ncnn::Option opt = net->opt;
+    opt.num_threads = 1;
+    opt.lightmode = false;
+    opt.use_packing_layout = false;
+    opt.use_fp16_storage = false;
+    opt.use_fp16_arithmetic = false;
+    opt.use_bf16_storage = false;
+    opt.blob_allocator = nullptr;
+    opt.workspace_allocator = nullptr;
+
+    std::vector<int> consumers(blobs.size(), 0);
+    for (const ncnn::Layer *layer : layers) {
+        for (int bottom : layer->bottoms) {
+            consumers[bottom]++;
+        }
+    }
+
+    //blob由只被这一处使用的上采样Interp产生时，返回上采样倍数
+    auto upsampleOf = [&](int blob) {
+        int producer = blobs[blob].producer;
+        if (producer < 0 || consumers[blob] != 1) {
+            return 0;
+        }
+        return probeNearestScale(layers[producer], opt);
+    };
+
+    int fused = 0;
+    for (size_t i = 0; i < layers.size(); i++) {
+        ncnn::Layer *layer = layers[i];
+
+        int mode;
+        if (probeAdd(layer, opt)) {
+            mode = FpnUpsampleFuse::Add;
+        } else if (probeChannelConcat(layer, opt)) {
+            mode = FpnUpsampleFuse::Concat;
+        } else {
+            continue;
+        }
+
+        std::vector<int> bottoms = layer->bottoms;
+        std::vector<int> scales(bottoms.size(), 1);
+        std::vector<ncnn::Layer *> interps(bottoms.size(), nullptr);
+        int matched = 0;
+        for (size_t k = 0; k < bottoms.size(); k++) {
+            int s = upsampleOf(bottoms[k]);
+            if (s > 1) {
+                scales[k] = s;
+                interps[k] = layers[blobs[bottoms[k]].producer];
+                bottoms[k] = interps[k]->bottoms[0];
+                matched++;
+            }
+        }
+        //相加只融合一侧上采样的情况，并把全分辨率输入放在前面
+        if (mode == FpnUpsampleFuse::Add) {
+            if (matched != 1) {
+                continue;
+            }
+            if (interps[0]) {
+                std::swap(bottoms[0], bottoms[1]);
+                std::swap(scales[0], scales[1]);
+                std::swap(interps[0], interps[1]);
+            }
+        }
+        if (matched == 0) {
+            continue;
+        }
+
+        FpnUpsampleFuse *fuse = new FpnUpsampleFuse;
+        fuse->typeindex = fusedTypeIndex;
+#if NCNN_STRING
+        fuse->type = FUSED_TYPE;
+        fuse->name = layer->name;
+#endif
+        fuse->bottoms = bottoms;
+        fuse->tops = layer->tops;
+        fuse->featmask = layer->featmask;
+        fuse->mode = mode;
+        fuse->scales = scales;
+        fuse->interps = interps;
+        fuse->original = layer;
+        fuse->create_pipeline(net->opt);
+
+        layers[i] = fuse;
+        for (int bottom : bottoms) {
+            blobs[bottom].consumer = static_cast<int>(i);
+        }
+        fused += matched;
+    }
+    return fused;
+}
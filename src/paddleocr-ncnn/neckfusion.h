@@ -0,0 +1,62 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+// ncnn
+#include "layer.h"
+
+namespace ncnn {
+class Net;
+}
+
+//DB检测网络FPN颈部的融合算子，替换“最近邻Interp -> BinaryOp相加”和“若干最近邻Interp -> Concat”两种结构：
+//上采样的结果不再单独写成全分辨率的中间blob，而是在写相加或拼接结果时按坐标直接取低分辨率输入
+class FpnUpsampleFuse : public ncnn::Layer
+{
+public:
+    enum Mode {
+        Add = 0,    //out = bottom0 + upsample(bottom1)
+        Concat = 1, //out = concat(upsample(bottom_i))，按通道拼接
+    };
+
+    FpnUpsampleFuse();
+    ~FpnUpsampleFuse() override;
+
+    int destroy_pipeline(const ncnn::Option &opt) override;
+
+    int forward(const std::vector<ncnn::Mat> &bottom_blobs, std::vector<ncnn::Mat> &top_blobs, const ncnn::Option &opt) const override;
+
+    int mode;
+    std::vector<int> scales;             //每个输入的上采样倍数，1表示原样使用
+    std::vector<ncnn::Layer *> interps;  //每个输入被融合掉的Interp层，没有时为空；仍归网络所有，只在回退时使用
+    ncnn::Layer *original;               //被替换掉的BinaryOp或Concat层，归本算子所有，只在回退时使用
+    int outElempack;                     //拼接结果的elempack，0表示与输入相同；由布局规划按下一层需要的打包方式设置
+
+private:
+    bool fastPathFits(const std::vector<ncnn::Mat> &bottom_blobs) const;
+    int forwardFallback(const std::vector<ncnn::Mat> &bottom_blobs, std::vector<ncnn::Mat> &top_blobs, const ncnn::Option &opt) const;
+};
+
+//在load_model之后调用，按图结构匹配并替换可融合的层，返回融合掉的Interp层数
+//Interp、BinaryOp和Concat的参数在加载后不再公开，这里用小输入试算一次来确认是最近邻整数倍上采样、相加和按通道拼接
+int fuseFpnNeck(ncnn::Net *net);
+
+//layer是fuseFpnNeck替换进网络的融合算子时返回它，否则返回空
+FpnUpsampleFuse *asFpnUpsampleFuse(ncnn::Net *net, ncnn::Layer *layer);
@@ -21,15 +21,21 @@
 
 #include "paddleocr.h"
 #include "details.h"
+#include "chardict.h"
+#include "metrics.h"
 
 #include <QLocale>
+#include <QCryptographicHash>
 #include <QFile>
-#include <QTextStream>
+#include <QFileInfo>
 #include <QtDebug>
-
-#ifdef IN_TEST
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QStandardPaths>
-#endif
+
+#include <thread>
 
 PaddleOCRApp *PaddleOCRApp::instance()
 {
@@ -58,132 +64,380 @@ PaddleOCRApp::Languages PaddleOCRApp::getSystemLang()
 PaddleOCRApp::PaddleOCRApp()
 {
     //初始化变量
-    m_isRunning = false;
+    m_runningCount = 0;
+    m_language = getSystemLang();
+    m_generation = 0;
+    m_reloading = false;
 
-    //初始化识别模型路径
-    //检测模型是全语种通用，不需要初始化
+    //按系统语言初始化神经网络
+    setLanguages(m_language);
+}
+
+PaddleOCRApp::~PaddleOCRApp()
+{
+    //进程退出时可能还在加载模型，线程中用到了本对象
+    if (m_reloadThread.joinable()) {
+        m_reloadThread.join();
+    }
+}
+
+QString PaddleOCRApp::modelPath()
+{
 #ifdef IN_TEST
-    QString rootPath(QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/ocr_test/testResource/");
+    return QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/ocr_test/testResource/";
 #else
-    QString rootPath("/usr/share/lingmo-ocr/model/"); //模型存放位置
+    return "/usr/share/lingmo-ocr/model/"; //模型存放位置
 #endif
-    QString paramPath;  //模型结构文件路径
-    QString binPath;    //权重文件路径
-    QString dictPath;   //字典文件路径
-    int recOutIndex = 0;//识别模型的输出位置（需要预先确认好，然后写进程序里）
-    switch (getSystemLang()) {
-    default: //使用英语
-        paramPath = rootPath + "rec_eng.param.bin";
-        binPath = rootPath + "rec_eng.bin";
-        dictPath = "://assets/dict/dict_eng.txt";
-        recOutIndex = 146;
-        break;
-    case Languages::CHI_TRA: //使用繁中
-        paramPath = rootPath + "rec_chi_tra.param.bin";
-        binPath = rootPath + "rec_chi_tra.bin";
-        dictPath = "://assets/dict/dict_chi_tra.txt";
-        recOutIndex = 146;
-        break;
-    case Languages::CHI_SIM: //使用简中
-        paramPath = rootPath + "rec_chi_sim.param.bin";
-        binPath = rootPath + "rec_chi_sim.bin";
-        dictPath = "://assets/dict/dict_chi_sim.txt";
-        recOutIndex = 78;
-        break;
+}
+
+std::shared_ptr<Details> PaddleOCRApp::currentDetails() const
+{
+    return std::atomic_load(&ocrDetails);
+}
+
+//检测模型缺省的预处理参数：ImageNet的均值和方差
+static ModelSpec detectorDefaults()
+{
+    ModelSpec spec;
+    const float mean[3] = {0.485f * 255, 0.456f * 255, 0.406f * 255};
+    const float norm[3] = {1.0f / 0.229f / 255.0f, 1.0f / 0.224f / 255.0f, 1.0f / 0.225f / 255.0f};
+    std::copy(mean, mean + 3, spec.mean);
+    std::copy(norm, norm + 3, spec.norm);
+    return spec;
+}
+
+//识别模型缺省的预处理参数：归一化到[-1,1]
+static ModelSpec recognizerDefaults()
+{
+    ModelSpec spec;
+    std::fill(spec.mean, spec.mean + 3, 127.5f);
+    std::fill(spec.norm, spec.norm + 3, 1.0f / 127.5f);
+    return spec;
+}
+
+ModelSpec PaddleOCRApp::loadModelSpec(const QString &rootPath, const QString &name, const ModelSpec &defaults, QString *dictPath)
+{
+    //模型清单与模型同名，例如det.json；清单里没写的字段按同名模型文件和默认值补齐
+    ModelSpec spec = defaults;
+    spec.paramPath = (rootPath + name + ".param.bin").toStdString();
+    spec.binPath = (rootPath + name + ".bin").toStdString();
+
+    QFile file(rootPath + name + ".json");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return spec;
     }
 
-    auto dict = loadDict(dictPath);
+    QJsonParseError error;
+    QJsonObject manifest = QJsonDocument::fromJson(file.readAll(), &error).object();
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << "invalid model manifest" << file.fileName() << error.errorString();
+        return spec;
+    }
 
-    //初始化神经网络
-    ocrDetails = new Details(paramPath.toStdString().c_str(), binPath.toStdString().c_str(), dict, recOutIndex);
+    //相对路径以模型目录为准，qrc路径原样使用
+    auto resolvePath = [&rootPath](const QString &path) {
+        return path.startsWith(":") || QDir::isAbsolutePath(path) ? path : rootPath + path;
+    };
+    //blob可以写序号也可以写名称
+    auto blobName = [](const QJsonValue &value) {
+        return value.isDouble() ? QString::number(value.toInt()) : value.toString();
+    };
+    auto readVector = [&manifest](const QString &key, float *values) {
+        QJsonArray array = manifest.value(key).toArray();
+        if (array.size() == 3) {
+            for (int i = 0; i < 3; i++) {
+                values[i] = static_cast<float>(array.at(i).toDouble());
+            }
+        }
+    };
+
+    if (manifest.contains("param")) {
+        spec.paramPath = resolvePath(manifest.value("param").toString()).toStdString();
+    }
+    if (manifest.contains("model")) {
+        spec.binPath = resolvePath(manifest.value("model").toString()).toStdString();
+    }
+    if (manifest.contains("input")) {
+        spec.inputBlob = blobName(manifest.value("input")).toStdString();
+    }
+    if (manifest.contains("output")) {
+        spec.outputBlob = blobName(manifest.value("output")).toStdString();
+    }
+    spec.inputHeight = manifest.value("inputHeight").toInt(spec.inputHeight);
+    readVector("mean", spec.mean);
+    readVector("norm", spec.norm);
+    spec.precision = manifest.value("precision").toString(QString::fromStdString(spec.precision)).toStdString();
+    if (dictPath && manifest.contains("dict")) {
+        *dictPath = resolvePath(manifest.value("dict").toString());
+    }
+    return spec;
 }
 
-PaddleOCRApp::~PaddleOCRApp()
+void PaddleOCRApp::loadLiteRecognizer(Details *details, const QString &rootPath, const QString &recName, const std::shared_ptr<const CharDict> &dict)
 {
-    delete ocrDetails;
+    //轻量模型与完整模型放在一起，名称带_lite后缀，共用同一个字典，例如rec_eng_lite.param.bin和rec_eng_lite.json
+    QString liteName = recName + "_lite";
+    ModelSpec spec = loadModelSpec(rootPath, liteName, recognizerDefaults(), nullptr);
+    if (!QFile::exists(QString::fromStdString(spec.paramPath)) || !QFile::exists(QString::fromStdString(spec.binPath))) {
+        return;
+    }
+
+    if (!details->loadLiteRecognizer(spec, dict)) {
+        qWarning() << "failed to load lite recognizer" << QString::fromStdString(spec.paramPath);
+    }
 }
 
-std::vector<std::string> PaddleOCRApp::loadDict(const QString &dictPath)
+std::shared_ptr<const CharDict> PaddleOCRApp::loadDict(const QString &dictPath)
 {
+    //优先使用模型目录下随模型发布的二进制字典，直接映射进内存，无需逐行解析
+    QString binName = QFileInfo(dictPath).completeBaseName() + ".dictbin";
+    if (CharDict *dict = CharDict::open((modelPath() + binName).toStdString())) {
+        return std::shared_ptr<const CharDict>(dict);
+    }
+
+    QFile textFile(dictPath);
+    if (!textFile.open(QIODevice::ReadOnly)) {
+        qWarning() << "failed to open dict" << dictPath;
+        return nullptr;
+    }
+    QByteArray content = textFile.readAll();
+
+    //其次使用缓存目录下由文本字典转换得到的二进制字典，文件名带上文本内容的摘要，字典更新后自动失效
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QString digest = QCryptographicHash::hash(content, QCryptographicHash::Md5).toHex().left(16);
+    QString cachePath = cacheDir + "/" + QFileInfo(dictPath).completeBaseName() + "-" + digest + ".dictbin";
+    if (!cacheDir.isEmpty()) {
+        if (CharDict *dict = CharDict::open(cachePath.toStdString())) {
+            return std::shared_ptr<const CharDict>(dict);
+        }
+    }
+
     //字典初始化：字典文件的每一行都是一个单独的字符，但需要在开头额外插入一个不参与识别的占位符，同时在末尾插入空格
-    QFile qrcFile(dictPath);
-    qrcFile.open(QIODevice::ReadOnly);
-    QTextStream stream(&qrcFile);
-    std::vector<std::string> result;
-    result.push_back("#");
-    while (1) {
-        auto temp = stream.readLine();
-        if (temp.isEmpty()) {
-            break;
+    //需要读到文件末尾，中间的空行也要保留为一个条目，否则后面的字符下标会整体错位
+    std::vector<std::string> entries;
+    entries.push_back("#");
+    int begin = 0;
+    while (begin < content.size()) {
+        int end = content.indexOf('\n', begin);
+        if (end < 0) {
+            end = content.size();
+        }
+        int length = end - begin;
+        if (length > 0 && content.at(end - 1) == '\r') {
+            --length;
         }
-        result.push_back(temp.toStdString());
+        entries.emplace_back(content.constData() + begin, static_cast<size_t>(length));
+        begin = end + 1;
+    }
+    entries.push_back(" ");
+
+    CharDict *dict = CharDict::fromEntries(entries);
+    if (!cacheDir.isEmpty() && QDir().mkpath(cacheDir) && !dict->save(cachePath.toStdString())) {
+        qWarning() << "failed to save dict cache" << cachePath;
     }
-    result.push_back(" ");
-    return result;
+    return std::shared_ptr<const CharDict>(dict);
 }
 
 QString PaddleOCRApp::getRecogitionResult(const QImage &image)
 {
-    m_isRunning = true;
+    ++m_runningCount;
 
     auto stdImg = image.convertToFormat(QImage::Format_RGB888).rgbSwapped(); //确保数据格式是BGR888以匹配模型
     cv::Mat mat = cv::Mat(stdImg.height(), stdImg.width(), CV_8UC3, stdImg.bits(), static_cast<size_t>(stdImg.bytesPerLine())).clone(); //转换到OpenCV格式
-    auto result = ocrDetails->run(mat); //执行识别，获取结果
+    auto result = currentDetails()->run(mat); //执行识别，获取结果；模型热更新时本次请求仍使用旧模型直到结束
 
     //组装识别结果，注意：目前没有版面识别功能，只能这样简单堆叠，然后将结果刷到界面上
-    QString text;
-    std::for_each(result.begin(), result.end(), [&text](const std::string & eachText) {
-        text += QString(eachText.c_str());
-        text += "\n";
-    });
+    //先在UTF-8下一次性拼好整段文本，最后只做一次编码转换
+    size_t totalSize = 0;
+    for (const std::string &eachText : result) {
+        totalSize += eachText.size() + 1;
+    }
+    std::string utf8;
+    utf8.reserve(totalSize);
+    for (const std::string &eachText : result) {
+        utf8.append(eachText);
+        utf8.push_back('\n');
+    }
+    QString text = QString::fromUtf8(utf8.data(), static_cast<int>(utf8.size()));
 
-    m_isRunning = false;
+    --m_runningCount;
     return text;
 }
 
+void PaddleOCRApp::setOptions(const DetailsOptions &options)
+{
+    std::lock_guard<std::mutex> locker(m_swapMutex);
+    currentDetails()->setOptions(options);
+}
+
+bool PaddleOCRApp::setLexicon(const QString &path)
+{
+    std::lock_guard<std::mutex> locker(m_swapMutex);
+    std::shared_ptr<Details> details = currentDetails();
+    if (!details->loadLexicon(path.toStdString())) {
+        qWarning() << "failed to open lexicon" << path;
+        return false;
+    }
+
+    DetailsOptions options = details->getOptions();
+    options.lexicon = path.toStdString();
+    details->setOptions(options);
+    return true;
+}
+
+DetailsOptions PaddleOCRApp::getOptions() const
+{
+    return currentDetails()->getOptions();
+}
+
+std::shared_ptr<const DetailsStats> PaddleOCRApp::getStats() const
+{
+    //与所属的识别引擎共享所有权，热更新换下旧引擎后统计仍然有效
+    std::shared_ptr<Details> details = currentDetails();
+    if (!details) {
+        return nullptr;
+    }
+    return std::shared_ptr<const DetailsStats>(details, &details->getStats());
+}
+
 void PaddleOCRApp::setLanguages(PaddleOCRApp::Languages data)
 {
+    DetailsOptions options;
+    if (auto details = currentDetails()) {
+        options = details->getOptions();
+    }
 
-    if (ocrDetails)
-    {
-        delete ocrDetails;
-        ocrDetails = nullptr;
+    //模型目录通常不可写，卷积调优结果放到用户缓存目录
+    if (options.autotuneCache.empty()) {
+        QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (!cacheDir.isEmpty() && QDir().mkpath(cacheDir)) {
+            options.autotuneCache = (cacheDir + "/det.tune").toStdString();
+        }
     }
 
-    //初始化识别模型路径
-    //检测模型是全语种通用，不需要初始化
-#ifdef IN_TEST
-    QString rootPath(QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/ocr_test/testResource/");
-#else
-    QString rootPath("/usr/share/lingmo-ocr/model/"); //模型存放位置
-#endif
-    QString paramPath;  //模型结构文件路径
-    QString binPath;    //权重文件路径
-    QString dictPath;   //字典文件路径
-    int recOutIndex = 0;//识别模型的输出位置（需要预先确认好，然后写进程序里）
-    switch (data) {
+    std::shared_ptr<Details> details = createDetails(data, options);
+
+    //正在进行的热更新基于旧的语种，换代后作废
+    std::lock_guard<std::mutex> locker(m_swapMutex);
+    m_language = data;
+    ++m_generation;
+    std::atomic_store(&ocrDetails, details);
+    EngineMetrics::instance()->setGauge(EngineMetrics::ModelBytes, static_cast<long long>(details->modelBytes()));
+}
+
+std::shared_ptr<Details> PaddleOCRApp::createDetails(Languages data, const DetailsOptions &options)
+{
+    QString rootPath = modelPath();
+    QString recName;    //识别模型名称，模型文件和清单都以此命名
+    QString dictPath;   //默认字典路径，清单中可以另行指定
+
+    //自动模式：中文模型同时覆盖中英文，作为主模型，简繁按系统语言选择；纯拉丁文本行再单独交给英文模型
+    Languages primary = data;
+    if (data == Languages::AUTO) {
+        primary = getSystemLang() == Languages::CHI_TRA ? Languages::CHI_TRA : Languages::CHI_SIM;
+    }
+
+    switch (primary) {
     case Languages::CHI_TRA: //使用繁中
-        paramPath = rootPath + "rec_chi_tra.param.bin";
-        binPath = rootPath + "rec_chi_tra.bin";
+        recName = "rec_chi_tra";
         dictPath = "://assets/dict/dict_chi_tra.txt";
-        recOutIndex = 146;
         break;
     case Languages::CHI_SIM: //使用简中
-        paramPath = rootPath + "rec_chi_sim.param.bin";
-        binPath = rootPath + "rec_chi_sim.bin";
+        recName = "rec_chi_sim";
         dictPath = "://assets/dict/dict_chi_sim.txt";
-        recOutIndex = 78;
         break;
     default: //使用英语
-        paramPath = rootPath + "rec_eng.param.bin";
-        binPath = rootPath + "rec_eng.bin";
+        recName = "rec_eng";
         dictPath = "://assets/dict/dict_eng.txt";
-        recOutIndex = 146;
         break;
     }
 
+    //检测模型是全语种通用的，识别模型按语种选择，输入输出和预处理参数都从模型清单读取
+    ModelSpec detSpec = loadModelSpec(rootPath, "det", detectorDefaults(), nullptr);
+    ModelSpec recSpec = loadModelSpec(rootPath, recName, recognizerDefaults(), &dictPath);
     auto dict = loadDict(dictPath);
 
     //初始化神经网络
-    ocrDetails = new Details(paramPath.toStdString().c_str(), binPath.toStdString().c_str(), dict, recOutIndex);
+    std::shared_ptr<Details> details = std::make_shared<Details>(detSpec, recSpec, dict, options);
+    if (!details->isReady()) {
+        qWarning() << "failed to load models" << QString::fromStdString(detSpec.paramPath) << QString::fromStdString(recSpec.paramPath);
+    }
+
+    //存在同语种的轻量模型时，启用级联识别
+    loadLiteRecognizer(details.get(), rootPath, recName, dict);
+
+    if (data == Languages::AUTO) {
+        QString latinDictPath = "://assets/dict/dict_eng.txt";
+        ModelSpec latinSpec = loadModelSpec(rootPath, "rec_eng", recognizerDefaults(), &latinDictPath);
+        if (!details->loadLatinRecognizer(latinSpec, loadDict(latinDictPath))) {
+            qWarning() << "failed to load latin recognizer" << QString::fromStdString(latinSpec.paramPath);
+        }
+    }
+    return details;
+}
+
+bool PaddleOCRApp::reloadModels()
+{
+    //同一时间只进行一次热更新
+    bool expected = false;
+    if (!m_reloading.compare_exchange_strong(expected, true)) {
+        return false;
+    }
+
+    Languages language;
+    DetailsOptions options;
+    int generation;
+    {
+        std::lock_guard<std::mutex> locker(m_swapMutex);
+        language = m_language;
+        options = currentDetails()->getOptions();
+        generation = m_generation;
+    }
+
+    //上一次加载的线程已经结束，只剩回收
+    if (m_reloadThread.joinable()) {
+        m_reloadThread.join();
+    }
+
+    //后台加载新模型并预热，完成后原子地替换；旧模型在手头的请求都结束后随最后一个引用释放
+    m_reloadThread = std::thread([this, language, options, generation]() {
+        std::shared_ptr<Details> details = createDetails(language, options);
+        if (details->isReady()) {
+            warmUp(details.get());
+
+            std::lock_guard<std::mutex> locker(m_swapMutex);
+            if (generation == m_generation) {
+                //加载期间词表可能已经更换
+                DetailsOptions current = currentDetails()->getOptions();
+                if (current.lexicon != options.lexicon) {
+                    details->loadLexicon(current.lexicon);
+                }
+                details->setOptions(current);
+                ++m_generation;
+                std::atomic_store(&ocrDetails, details);
+                EngineMetrics::instance()->setGauge(EngineMetrics::ModelBytes, static_cast<long long>(details->modelBytes()));
+                qInfo() << "ocr models reloaded from" << modelPath();
+            }
+        } else {
+            qWarning() << "ocr model reload failed, keep using the current models";
+        }
+        m_reloading = false;
+    });
+
+    return true;
+}
+
+void PaddleOCRApp::warmUp(Details *details)
+{
+    //在一张画有几行“文字”的小图上跑一遍完整流程，让检测和识别网络都完成首次推理的内存分配和初始化
+    cv::Mat image(128, 512, CV_8UC3, cv::Scalar(255, 255, 255));
+    for (int line = 0; line < 3; line++) {
+        for (int x = 16; x < 480; x += 24) {
+            cv::rectangle(image, cv::Rect(x, 16 + line * 40, 14, 20), cv::Scalar(0, 0, 0), cv::FILLED);
+        }
+    }
+    //预热不是真实请求，不计入请求数、耗时和文本行数
+    details->setMetricsEnabled(false);
+    details->run(image);
+    details->setMetricsEnabled(true);
 }
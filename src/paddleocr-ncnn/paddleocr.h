@@ -22,10 +22,17 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <QImage>
 #include <QString>
 
+class CharDict;
 class Details;
+struct DetailsOptions;
+struct DetailsStats;
+struct ModelSpec;
 
 class PaddleOCRApp
 {
@@ -34,14 +41,15 @@ public:
         UNKNOWN = -1, //未知语言
         CHI_SIM,      //简体中文
         CHI_TRA,      //繁体中文
-        ENG           //英文
+        ENG,          //英文
+        AUTO          //自动：按文本行判断文字类别，分别交给对应的识别模型
     };
 
     static PaddleOCRApp *instance();
 
     bool isRunning() const
     {
-        return m_isRunning;
+        return m_runningCount > 0;
     }
 
     QString getRecogitionResult(const QImage &image);
@@ -50,14 +58,41 @@ public:
 
     PaddleOCRApp::Languages getSystemLang();
 
+    //引擎可选项，切换语言和重新加载模型后保持不变
+    void setOptions(const DetailsOptions &options);
+    DetailsOptions getOptions() const;
+
+    //设置约束解码的词表文件，切换语言和重新加载模型后保持；路径为空时恢复贪心解码，文件无法打开时返回false
+    bool setLexicon(const QString &path);
+
+    //当前引擎的运行统计，重新加载模型后新引擎从零开始；持有期间对应的引擎不会释放，尚未加载时为空
+    std::shared_ptr<const DetailsStats> getStats() const;
+
+    //模型存放位置
+    static QString modelPath();
+
+    //在后台重新加载模型目录下的模型，预热完成后切换，进行中的请求继续使用旧模型直到结束
+    //已有重新加载在进行时返回false
+    bool reloadModels();
+
 private:
     PaddleOCRApp();
     ~PaddleOCRApp();
 
 
-    std::vector<std::string> loadDict(const QString &dictPath);
+    std::shared_ptr<const CharDict> loadDict(const QString &dictPath);
+    ModelSpec loadModelSpec(const QString &rootPath, const QString &name, const ModelSpec &defaults, QString *dictPath);
+    void loadLiteRecognizer(Details *details, const QString &rootPath, const QString &recName, const std::shared_ptr<const CharDict> &dict);
+    std::shared_ptr<Details> createDetails(Languages data, const DetailsOptions &options);
+    std::shared_ptr<Details> currentDetails() const;
+    void warmUp(Details *details);
 
-    Details *ocrDetails;
+    std::shared_ptr<Details> ocrDetails; //当前使用的识别引擎，只通过原子操作读写
+    Languages m_language;                //当前语种
+    int m_generation;                    //每次切换引擎加一，用于作废过时的热更新
+    std::mutex m_swapMutex;
+    std::atomic_bool m_reloading;
+    std::thread m_reloadThread;          //后台加载模型的线程，析构时等待它结束
 
-    std::atomic_bool m_isRunning;
+    std::atomic_int m_runningCount; //正在识别的请求数，识别引擎支持多个线程同时调用
 };
@@ -14,6 +14,7 @@
 
 #include <postprocess_op.h>
 #include <clipper.hpp>
+#include <taskscheduler.h>
 
 namespace PaddleOCR {
 
@@ -334,6 +335,132 @@ std::vector<std::vector<std::vector<int>>> PostProcessor::BoxesFromBitmap(
     return boxes;
 }
 
+std::vector<std::vector<std::vector<int>>> PostProcessor::BoxesFromComponents(
+    const cv::Mat pred, const cv::Mat bitmap, const float &box_thresh,
+    const float &det_db_unclip_ratio,
+    const std::function<void(const std::vector<std::vector<int>> &)> &on_box)
+{
+    const int min_size = 3;
+    const int max_candidates = 1000;
+
+    int width = bitmap.cols;
+    int height = bitmap.rows;
+
+    // 8-connectivity gives the same regions as the outer contours traced by
+    // findContours; OpenCV runs the labeling in parallel blocks
+    cv::Mat labels, stats, centroids;
+    int num_labels = cv::connectedComponentsWithStats(bitmap, labels, stats, centroids,
+                                                      8, CV_32S, cv::CCL_DEFAULT);
+
+    std::vector<std::vector<std::vector<int>>> boxes;
+    if (num_labels <= 1) {
+        return boxes;
+    }
+
+    // The convex hull of a region, and therefore its minAreaRect, only depends
+    // on the first and last pixel of every horizontal run, so those are the
+    // only points collected per label
+    std::vector<std::vector<cv::Point>> points(num_labels);
+    for (int i = 1; i < num_labels; i++) {
+        points[i].reserve(size_t(stats.at<int>(i, cv::CC_STAT_HEIGHT)) * 2);
+    }
+    for (int y = 0; y < height; y++) {
+        const int *row = labels.ptr<int>(y);
+        int x = 0;
+        while (x < width) {
+            int label = row[x];
+            if (label == 0) {
+                x++;
+                continue;
+            }
+            int start = x;
+            while (x + 1 < width && row[x + 1] == label) {
+                x++;
+            }
+            points[label].emplace_back(start, y);
+            if (x != start) {
+                points[label].emplace_back(x, y);
+            }
+            x++;
+        }
+    }
+
+    struct Candidate {
+        float score = 0.f;
+        std::vector<std::vector<float>> array;
+    };
+    std::vector<Candidate> candidates(num_labels);
+
+    TaskScheduler::instance()->parallelFor(static_cast<size_t>(num_labels - 1), [&](size_t label) {
+        int i = static_cast<int>(label) + 1;
+        // the longest side of minAreaRect can never exceed the bbox diagonal
+        int bbox_w = stats.at<int>(i, cv::CC_STAT_WIDTH) - 1;
+        int bbox_h = stats.at<int>(i, cv::CC_STAT_HEIGHT) - 1;
+        if (points[i].size() <= 2 || bbox_w * bbox_w + bbox_h * bbox_h < min_size * min_size) {
+            return;
+        }
+
+        float ssid;
+        cv::RotatedRect box = cv::minAreaRect(points[i]);
+        auto array = GetMiniBoxes(box, ssid);
+        if (ssid < min_size) {
+            return;
+        }
+
+        float score = BoxScoreFast(array, pred);
+        if (score < box_thresh) {
+            return;
+        }
+
+        candidates[i].score = score;
+        candidates[i].array = std::move(array);
+    }, 16);
+
+    std::vector<int> order;
+    for (int i = 1; i < num_labels; i++) {
+        if (!candidates[i].array.empty()) {
+            order.push_back(i);
+        }
+    }
+    if (order.size() > size_t(max_candidates)) {
+        std::nth_element(order.begin(), order.begin() + max_candidates, order.end(),
+        [&candidates](int l, int r) {
+            return candidates[l].score > candidates[r].score;
+        });
+        order.resize(max_candidates);
+    }
+
+    int dest_width = pred.cols;
+    int dest_height = pred.rows;
+    for (int i : order) {
+        cv::RotatedRect clipbox = UnClip(candidates[i].array, det_db_unclip_ratio);
+        if (clipbox.size.height < 1.001 && clipbox.size.width < 1.001) {
+            continue;
+        }
+
+        float ssid;
+        auto cliparray = GetMiniBoxes(clipbox, ssid);
+        if (ssid < min_size + 2)
+            continue;
+
+        std::vector<std::vector<int>> intcliparray;
+        for (int num_pt = 0; num_pt < 4; num_pt++) {
+            std::vector<int> a{int(clampf(roundf(cliparray[num_pt][0] / float(width) *
+                                                 float(dest_width)),
+                                          0, float(dest_width))),
+                               int(clampf(roundf(cliparray[num_pt][1] /
+                                                 float(height) * float(dest_height)),
+                                          0, float(dest_height)))};
+            intcliparray.push_back(a);
+        }
+        if (on_box) {
+            on_box(intcliparray);
+        }
+        boxes.push_back(intcliparray);
+    }
+    return boxes;
+}
+
 std::vector<std::vector<std::vector<int>>>
 PostProcessor::FilterTagDetRes(std::vector<std::vector<std::vector<int>>> boxes,
                                float ratio_h, float ratio_w, cv::Mat srcimg)
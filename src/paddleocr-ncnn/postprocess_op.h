@@ -25,6 +25,7 @@
 
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <numeric>
 
 #include "clipper.hpp"
@@ -58,6 +59,19 @@ public:
                   const float &box_thresh, const float &det_db_unclip_ratio,
                   const bool &use_polygon_score);
 
+  // Same contract as BoxesFromBitmap, but candidates come from a parallel
+  // connected-component labeling of the bitmap instead of findContours, and
+  // the max_candidates cap keeps the best-scoring regions rather than the
+  // first ones discovered. When on_box is set it is called for every box as
+  // soon as it is final, so callers can start consuming boxes while the rest
+  // are still being unclipped.
+  std::vector<std::vector<std::vector<int>>>
+  BoxesFromComponents(const cv::Mat pred, const cv::Mat bitmap,
+                      const float &box_thresh,
+                      const float &det_db_unclip_ratio,
+                      const std::function<void(const std::vector<std::vector<int>> &)>
+                          &on_box = nullptr);
+
   std::vector<std::vector<std::vector<int>>>
   FilterTagDetRes(std::vector<std::vector<std::vector<int>>> boxes,
                   float ratio_h, float ratio_w, cv::Mat srcimg);
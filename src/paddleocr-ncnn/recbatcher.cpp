@@ -0,0 +1,119 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "recbatcher.h"
+#include "metrics.h"
+
+#include <chrono>
+
+RecBatcher::RecBatcher(RecognizeFunc recognize, ActiveFunc activeRequests, size_t maxBatch, int maxWaitMs)
+    : m_recognize(recognize)
+    , m_activeRequests(activeRequests)
+    , m_maxBatch(std::max<size_t>(1, maxBatch))
+    , m_maxWaitMs(maxWaitMs)
+{
+    m_thread = std::thread(&RecBatcher::dispatch, this);
+}
+
+RecBatcher::~RecBatcher()
+{
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+}
+
+void RecBatcher::setLimits(size_t maxBatch, int maxWaitMs)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_maxBatch = std::max<size_t>(1, maxBatch);
+    m_maxWaitMs = maxWaitMs;
+}
+
+std::vector<std::string> RecBatcher::recognize(const std::vector<cv::Mat> &images)
+{
+    if (images.empty()) {
+        return std::vector<std::string>();
+    }
+
+    auto request = std::make_shared<Request>();
+    request->images = images;
+    auto result = request->promise.get_future();
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_queue.push_back(request);
+        m_queuedImages += images.size();
+        EngineMetrics::instance()->setGauge(EngineMetrics::RecognizeQueueDepth, static_cast<long long>(m_queuedImages));
+    }
+    m_condition.notify_all();
+
+    return result.get();
+}
+
+void RecBatcher::dispatch()
+{
+    while (true) {
+        std::vector<std::shared_ptr<Request>> batch;
+        {
+            std::unique_lock<std::mutex> locker(m_mutex);
+            m_condition.wait(locker, [this]() {
+                return !m_queue.empty() || m_stop;
+            });
+            if (m_queue.empty()) {
+                break;
+            }
+
+            //从第一个请求到达开始计时，攒够一批、所有在处理的请求都已提交或者超时即发车
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_maxWaitMs);
+            m_condition.wait_until(locker, deadline, [this]() {
+                return m_stop || m_queuedImages >= m_maxBatch
+                       || static_cast<int>(m_queue.size()) >= m_activeRequests();
+            });
+
+            //请求不拆分，至少取一个，之后不超过maxBatch
+            size_t images = 0;
+            while (!m_queue.empty() && (batch.empty() || images + m_queue.front()->images.size() <= m_maxBatch)) {
+                images += m_queue.front()->images.size();
+                batch.push_back(m_queue.front());
+                m_queue.pop_front();
+            }
+            m_queuedImages -= images;
+            EngineMetrics::instance()->setGauge(EngineMetrics::RecognizeQueueDepth, static_cast<long long>(m_queuedImages));
+        }
+
+        std::vector<cv::Mat> images;
+        for (const auto &request : batch) {
+            images.insert(images.end(), request->images.begin(), request->images.end());
+        }
+
+        try {
+            auto texts = m_recognize(images);
+            size_t offset = 0;
+            for (const auto &request : batch) {
+                request->promise.set_value(std::vector<std::string>(texts.begin() + static_cast<long>(offset),
+                                                                    texts.begin() + static_cast<long>(offset + request->images.size())));
+                offset += request->images.size();
+            }
+        } catch (...) {
+            for (const auto &request : batch) {
+                request->promise.set_exception(std::current_exception());
+            }
+        }
+    }
+}
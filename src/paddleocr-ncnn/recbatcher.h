@@ -0,0 +1,69 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+//识别动态批处理：把同一时间段内各个请求提交的文本行图片攒成一批再统一识别，
+//攒够maxBatch张或者等待超过maxWaitMs即发车，结果按请求拆分后送回
+class RecBatcher
+{
+public:
+    typedef std::function<std::vector<std::string>(const std::vector<cv::Mat> &)> RecognizeFunc;
+    typedef std::function<int()> ActiveFunc;
+
+    //recognize: 实际执行识别的函数
+    //activeRequests: 当前正在处理的请求数，所有请求都已提交时不必再等
+    RecBatcher(RecognizeFunc recognize, ActiveFunc activeRequests, size_t maxBatch, int maxWaitMs);
+    ~RecBatcher();
+
+    //提交一组图片并阻塞等待识别结果，可在多个线程中同时调用
+    std::vector<std::string> recognize(const std::vector<cv::Mat> &images);
+
+    void setLimits(size_t maxBatch, int maxWaitMs);
+
+private:
+    struct Request {
+        std::vector<cv::Mat> images;
+        std::promise<std::vector<std::string>> promise;
+    };
+
+    void dispatch();
+
+    RecognizeFunc m_recognize;
+    ActiveFunc m_activeRequests;
+    size_t m_maxBatch;
+    int m_maxWaitMs;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::shared_ptr<Request>> m_queue;
+    size_t m_queuedImages = 0;
+    bool m_stop = false;
+    std::thread m_thread;
+};
@@ -0,0 +1,252 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "taskscheduler.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+
+// ncnn
+#include "platform.h"
+#if NCNN_SIMPLEOMP
+#include "simpleomp.h"
+#endif
+
+//当前线程在线程池中的序号，不属于线程池的线程为-1
+static thread_local int currentWorker = -1;
+
+//当前线程正在执行的任务的嵌套层数：等待子任务时会在任务内部执行其他任务
+static thread_local int taskDepth = 0;
+
+#if NCNN_SIMPLEOMP
+static void forkTeam(void *backendData, int numThreads, kmp_team_member member, void *ctx)
+{
+    static_cast<TaskScheduler *>(backendData)->parallelFor(static_cast<size_t>(numThreads), [member, ctx](size_t threadNum) {
+        member(ctx, static_cast<int>(threadNum));
+    }, 1);
+}
+#endif
+
+TaskScheduler *TaskScheduler::instance()
+{
+    static TaskScheduler scheduler;
+    return &scheduler;
+}
+
+TaskScheduler::TaskScheduler()
+    : m_pending(0)
+    , m_nextVictim(0)
+    , m_spinTime(0)
+    , m_stop(false)
+{
+    //调用方线程也参与执行，只需要再创建 核心数-1 个工作线程
+    //多进程识别时每个工作进程只分到一部分核心，由环境变量LINGMO_OCR_THREADS指定
+    int count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (const char *threads = getenv("LINGMO_OCR_THREADS")) {
+        count = std::max(1, atoi(threads));
+    }
+    for (int i = 0; i < count; i++) {
+        m_workers.emplace_back(new Worker);
+    }
+    for (int i = 1; i < count; i++) {
+        m_threads.emplace_back(&TaskScheduler::workerLoop, this, i);
+    }
+    EngineMetrics::instance()->setGauge(EngineMetrics::WorkerThreads, count);
+
+#if NCNN_SIMPLEOMP
+    kmp_set_fork_backend(forkTeam, this);
+#endif
+}
+
+TaskScheduler::~TaskScheduler()
+{
+#if NCNN_SIMPLEOMP
+    kmp_set_fork_backend(nullptr, nullptr);
+#endif
+
+    {
+        std::lock_guard<std::mutex> locker(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_all();
+    for (std::thread &thread : m_threads) {
+        thread.join();
+    }
+}
+
+void TaskScheduler::setSpinTime(int microseconds)
+{
+    m_spinTime = std::max(0, microseconds);
+}
+
+int TaskScheduler::threadCount() const
+{
+    return static_cast<int>(m_workers.size());
+}
+
+void TaskScheduler::submit(std::function<void()> task)
+{
+    //工作线程放入自己的队列，外部线程轮流放入各个队列
+    size_t index = currentWorker >= 0 ? static_cast<size_t>(currentWorker) : m_nextVictim++ % m_workers.size();
+    {
+        std::lock_guard<std::mutex> locker(m_workers[index]->mutex);
+        m_workers[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> locker(m_sleepMutex);
+        ++m_pending;
+    }
+    m_wakeup.notify_one();
+}
+
+bool TaskScheduler::runOne()
+{
+    std::function<void()> task;
+    size_t count = m_workers.size();
+    size_t self = currentWorker >= 0 ? static_cast<size_t>(currentWorker) : 0;
+
+    //先取自己队列尾部的任务，数据还在缓存里
+    if (currentWorker >= 0) {
+        Worker &worker = *m_workers[self];
+        std::lock_guard<std::mutex> locker(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+    }
+
+    //再从其他队列头部窃取最早派生的任务，通常也是粒度最大的
+    for (size_t i = 1; !task && i <= count; i++) {
+        Worker &victim = *m_workers[(self + i) % count];
+        std::lock_guard<std::mutex> locker(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+    --m_pending;
+
+    //最外层任务的执行时间计入线程池的忙碌时间，除以线程数和经过的时间即为利用率
+    if (taskDepth > 0) {
+        task();
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ++taskDepth;
+    task();
+    --taskDepth;
+    auto busy = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    EngineMetrics::instance()->add(EngineMetrics::WorkerBusyUs, busy.count());
+    return true;
+}
+
+void TaskScheduler::workerLoop(int index)
+{
+    currentWorker = index;
+    for (;;) {
+        if (runOne()) {
+            continue;
+        }
+
+        auto spinEnd = std::chrono::steady_clock::now() + std::chrono::microseconds(m_spinTime.load());
+        while (m_pending == 0 && std::chrono::steady_clock::now() < spinEnd) {
+            std::this_thread::yield();
+        }
+        if (m_pending > 0) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> locker(m_sleepMutex);
+        m_wakeup.wait(locker, [this]() {
+            return m_stop || m_pending > 0;
+        });
+        if (m_stop) {
+            return;
+        }
+    }
+}
+
+void TaskScheduler::parallelFor(size_t count, const std::function<void(size_t)> &fn, size_t grain)
+{
+    if (count == 0) {
+        return;
+    }
+
+    //默认每个线程分到约4个任务，负载不均时靠窃取补齐
+    if (grain == 0) {
+        grain = std::max<size_t>(1, count / (m_workers.size() * 4));
+    }
+    size_t chunks = (count + grain - 1) / grain;
+
+    struct Group {
+        std::atomic<size_t> remaining;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto group = std::make_shared<Group>();
+    group->remaining = chunks;
+
+    auto runChunk = [group, &fn, grain, count](size_t chunk) {
+        try {
+            size_t end = std::min(count, (chunk + 1) * grain);
+            for (size_t i = chunk * grain; i < end; i++) {
+                fn(i);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> locker(group->mutex);
+            if (!group->error) {
+                group->error = std::current_exception();
+            }
+        }
+        if (--group->remaining == 0) {
+            std::lock_guard<std::mutex> locker(group->mutex);
+            group->finished.notify_all();
+        }
+    };
+
+    //第0块由调用方直接执行，其余的派发出去
+    for (size_t chunk = chunks - 1; chunk > 0; chunk--) {
+        submit([runChunk, chunk]() {
+            runChunk(chunk);
+        });
+    }
+    runChunk(0);
+
+    //等待期间帮忙执行任务；没有可执行的任务时说明剩下的都在别的线程上运行，
+    //短暂休眠后再看一次，期间这些任务可能又派生出了可以帮忙的子任务
+    while (group->remaining > 0) {
+        if (runOne()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> locker(group->mutex);
+        group->finished.wait_for(locker, std::chrono::milliseconds(1), [&group]() {
+            return group->remaining == 0;
+        });
+    }
+
+    if (group->error) {
+        std::rethrow_exception(group->error);
+    }
+}
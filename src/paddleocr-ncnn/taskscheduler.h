@@ -0,0 +1,72 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//工作窃取任务调度器，整个进程共用一个线程池
+//每个工作线程有自己的任务队列，优先后进先出地执行自己派生的任务，空闲时从其他线程的队列头部窃取任务。
+//等待任务完成的线程不会阻塞，而是一起执行队列中的任务，因此嵌套并行不会产生新线程，也不会因为线程都在等待而卡死。
+//ncnn以NCNN_SIMPLEOMP方式构建时，推理内部的并行循环也交给这个线程池执行
+class TaskScheduler
+{
+public:
+    static TaskScheduler *instance();
+
+    //线程总数，包括调用方自身
+    int threadCount() const;
+
+    //并行执行 fn(i)，i∈[0,count)，返回时全部执行完毕；任一任务抛出的异常会在这里重新抛出
+    //grain为每个任务最少处理的下标个数，为0时自动划分
+    void parallelFor(size_t count, const std::function<void(size_t)> &fn, size_t grain = 0);
+
+    //工作线程没有任务时先自旋等待的微秒数，请求密集时避免频繁休眠唤醒，为0时立即休眠
+    void setSpinTime(int microseconds);
+
+private:
+    TaskScheduler();
+    ~TaskScheduler();
+    TaskScheduler(const TaskScheduler &) = delete;
+    TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    void submit(std::function<void()> task);
+    bool runOne();
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<Worker> > m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_pending;
+    std::atomic<size_t> m_nextVictim;
+    std::atomic_int m_spinTime;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeup;
+    bool m_stop;
+};
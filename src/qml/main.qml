@@ -42,7 +42,7 @@ LingmoUI.Window {
                 width: 100
                 height: 30
                 padding: 0
-                model: ["简体中文","繁体中文","English"]
+                model: ["简体中文","繁体中文","English","自动"]
                 topInset: 0
                 bottomInset: 0
                 currentIndex: 0
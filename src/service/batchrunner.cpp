@@ -0,0 +1,341 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batchrunner.h"
+#include "jsonutil.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+//FNV-1a，按顺序对清单中的每条路径取摘要，记录到切块方式中
+unsigned long long manifestDigest(const std::vector<std::string> &paths)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const std::string &path : paths) {
+        for (unsigned char c : path) {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        hash = (hash ^ '\n') * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool makeDir(const std::string &path)
+{
+    return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool fileExists(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+bool readFile(const std::string &path, std::string &data)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    data = stream.str();
+    return !file.bad();
+}
+
+//先写到同目录下的临时文件并落盘，再改名覆盖目标，读者要么看到旧文件要么看到完整的新文件
+bool writeFileAtomic(const std::string &path, const std::string &data, const std::string &nodeId)
+{
+    std::string tmpPath = path + ".tmp." + nodeId;
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t ret = write(fd, data.data() + written, data.size() - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            break;
+        }
+        written += static_cast<size_t>(ret);
+    }
+    bool ok = written == data.size() && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+}
+
+BatchRunner::BatchRunner(const BatchOptions &options, const RecognizeFunc &recognize)
+    : m_options(options)
+    , m_recognize(recognize)
+{
+    if (m_options.chunkSize == 0) {
+        m_options.chunkSize = 1;
+    }
+    if (m_options.parallel < 1) {
+        m_options.parallel = 1;
+    }
+    m_workDir = m_options.workDir.empty() ? m_options.manifest + ".work" : m_options.workDir;
+    size_t slash = m_options.manifest.rfind('/');
+    m_baseDir = slash == std::string::npos ? std::string(".") : m_options.manifest.substr(0, slash + 1);
+
+    char host[256] = {0};
+    gethostname(host, sizeof(host) - 1);
+    m_nodeId = std::string(host) + "-" + std::to_string(getpid());
+}
+
+std::string BatchRunner::chunkPath(const char *dir, size_t chunk) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%08zu", chunk);
+    return m_workDir + "/" + dir + "/" + name + (strcmp(dir, "out") == 0 ? ".jsonl" : "");
+}
+
+bool BatchRunner::loadManifest()
+{
+    std::ifstream file(m_options.manifest);
+    if (!file) {
+        fprintf(stderr, "failed to open manifest %s\n", m_options.manifest.c_str());
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        //空行和注释不占序号，各节点读到的清单一致即可得到相同的切块
+        if (!line.empty() && line[0] != '#') {
+            m_paths.push_back(line);
+        }
+    }
+
+    if (!makeDir(m_workDir) || !makeDir(m_workDir + "/claims") || !makeDir(m_workDir + "/done") || !makeDir(m_workDir + "/out")) {
+        fprintf(stderr, "failed to create work directory %s: %s\n", m_workDir.c_str(), strerror(errno));
+        return false;
+    }
+
+    //第一个节点记录切块方式，之后的节点必须与之一致，否则结果文件对应的图片会错位
+    //只比较条数不够，清单改动了内容或顺序也会错位，因此一并记录路径的摘要
+    char digest[17];
+    snprintf(digest, sizeof(digest), "%016llx", manifestDigest(m_paths));
+    std::string layout = std::to_string(m_paths.size()) + " " + std::to_string(m_options.chunkSize) + " " + digest + "\n";
+    std::string layoutPath = m_workDir + "/layout";
+    int fd = open(layoutPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        bool ok = write(fd, layout.data(), layout.size()) == static_cast<ssize_t>(layout.size()) && fsync(fd) == 0;
+        close(fd);
+        if (ok) {
+            return true;
+        }
+        unlink(layoutPath.c_str());
+        return false;
+    }
+    std::string existing;
+    //创建者可能还没写完，稍等再读
+    for (int i = 0; i < 50 && readFile(layoutPath, existing) && existing.empty(); ++i) {
+        usleep(100000);
+    }
+    if (existing != layout) {
+        fprintf(stderr, "manifest or chunk size differs from the one recorded in %s\n", layoutPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool BatchRunner::claim(size_t chunk)
+{
+    std::string path = chunkPath("claims", chunk);
+    std::string owner = m_nodeId + "\n";
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            bool ok = write(fd, owner.data(), owner.size()) == static_cast<ssize_t>(owner.size());
+            close(fd);
+            //调用前检查过done，但别的节点可能恰好在这之后处理完并删掉了它的认领，此时不能再处理一遍
+            if (!ok || fileExists(chunkPath("done", chunk))) {
+                unlink(path.c_str());
+                return false;
+            }
+            return true;
+        }
+        if (errno != EEXIST) {
+            return false;
+        }
+
+        //认领文件在处理过程中不断更新修改时间，长时间没有更新说明认领的节点已经退出
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            continue;
+        }
+        if (time(nullptr) - st.st_mtime < m_options.staleSeconds || fileExists(chunkPath("done", chunk))) {
+            return false;
+        }
+        //原子改名只有一个节点能成功；改名后发现拿到的已是别人刚建的新认领，就放回去
+        std::string stalePath = path + ".stale." + m_nodeId;
+        if (rename(path.c_str(), stalePath.c_str()) != 0) {
+            return false;
+        }
+        if (stat(stalePath.c_str(), &st) == 0 && time(nullptr) - st.st_mtime < m_options.staleSeconds) {
+            //放回失败说明又有节点认领了，该块可能被处理两次，但结果相同
+            link(stalePath.c_str(), path.c_str());
+            unlink(stalePath.c_str());
+            return false;
+        }
+        unlink(stalePath.c_str());
+        fprintf(stderr, "taking over stale chunk %zu\n", chunk);
+    }
+    return false;
+}
+
+bool BatchRunner::processChunk(size_t chunk)
+{
+    size_t begin = chunk * m_options.chunkSize;
+    size_t end = std::min(begin + m_options.chunkSize, m_paths.size());
+    std::vector<std::string> lines(end - begin);
+    std::string claimPath = chunkPath("claims", chunk);
+
+    std::atomic<size_t> next(begin);
+    auto worker = [&]() {
+        size_t index;
+        while ((index = next.fetch_add(1)) < end) {
+            const std::string &path = m_paths[index];
+            std::string image, text, line = "{\"path\":" + jsonString(path);
+            if (!readFile(path[0] == '/' ? path : m_baseDir + path, image)) {
+                line += ",\"error\":\"unreadable\"}\n";
+            } else if (!m_recognize(image, text)) {
+                line += ",\"error\":\"recognition failed\"}\n";
+            } else {
+                line += ",\"text\":" + jsonString(text) + "}\n";
+            }
+            lines[index - begin] = std::move(line);
+            //刷新认领时间，表明本节点仍在处理
+            utimensat(AT_FDCWD, claimPath.c_str(), nullptr, 0);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < m_options.parallel; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    std::string output;
+    for (const std::string &line : lines) {
+        output += line;
+    }
+    //结果只由清单内容和识别结果决定，重复处理写出的是同一份文件
+    if (!writeFileAtomic(chunkPath("out", chunk), output, m_nodeId)
+            || !writeFileAtomic(chunkPath("done", chunk), std::string(), m_nodeId)) {
+        fprintf(stderr, "failed to write results of chunk %zu: %s\n", chunk, strerror(errno));
+        return false;
+    }
+    unlink(claimPath.c_str());
+    return true;
+}
+
+int BatchRunner::run()
+{
+    if (!loadManifest()) {
+        return -1;
+    }
+    size_t chunks = (m_paths.size() + m_options.chunkSize - 1) / m_options.chunkSize;
+    int processed = 0;
+
+    if (m_options.shardIndex >= 0) {
+        //静态分片不需要认领，重跑时跳过已完成的块
+        if (m_options.shardCount <= 0 || m_options.shardIndex >= m_options.shardCount) {
+            fprintf(stderr, "invalid shard %d/%d\n", m_options.shardIndex, m_options.shardCount);
+            return -1;
+        }
+        for (size_t chunk = static_cast<size_t>(m_options.shardIndex); chunk < chunks; chunk += static_cast<size_t>(m_options.shardCount)) {
+            if (fileExists(chunkPath("done", chunk))) {
+                continue;
+            }
+            if (!processChunk(chunk)) {
+                return -1;
+            }
+            ++processed;
+        }
+        return processed;
+    }
+
+    //动态领取：一直领到所有块完成为止，期间接管失效节点留下的块；等待其他节点时逐步拉长轮询间隔
+    useconds_t wait = 200000;
+    while (true) {
+        bool remaining = false;
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            if (fileExists(chunkPath("done", chunk))) {
+                continue;
+            }
+            if (!claim(chunk)) {
+                remaining = true;
+                continue;
+            }
+            if (!processChunk(chunk)) {
+                unlink(chunkPath("claims", chunk).c_str());
+                return -1;
+            }
+            ++processed;
+        }
+        if (!remaining) {
+            return processed;
+        }
+        usleep(wait);
+        wait = std::min<useconds_t>(wait * 2, 5000000);
+    }
+}
+
+bool BatchRunner::merge(const std::string &output)
+{
+    if (m_paths.empty() && !loadManifest()) {
+        return false;
+    }
+    size_t chunks = (m_paths.size() + m_options.chunkSize - 1) / m_options.chunkSize;
+    std::string merged;
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        std::string data;
+        if (!fileExists(chunkPath("done", chunk)) || !readFile(chunkPath("out", chunk), data)) {
+            fprintf(stderr, "chunk %zu is not finished yet\n", chunk);
+            return false;
+        }
+        merged += data;
+    }
+    return writeFileAtomic(output, merged, m_nodeId);
+}
@@ -0,0 +1,72 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+//批量识别的可选项
+struct BatchOptions {
+    std::string manifest;     //待识别图片清单，每行一个路径，相对路径相对于清单所在目录
+    std::string workDir;      //多个节点共享的工作目录，为空时为 清单路径.work
+    int shardIndex = -1;      //静态分片：只处理 块序号 % shardCount == shardIndex 的块；为-1时从共享目录动态领取
+    int shardCount = 0;
+    size_t chunkSize = 100;   //每块的图片数，所有节点必须一致
+    int staleSeconds = 600;   //认领后超过该时间没有进展的块视为节点已失效，可被其他节点接管
+    int parallel = 2;         //本节点同时识别的图片数
+};
+
+/*
+ * @bref: BatchRunner 多节点批量识别：清单按固定大小切块，每块的结果写成 out/<块序号>.jsonl
+ * 动态领取时以O_EXCL创建 claims/<块序号> 认领，完成后创建 done/<块序号>；失效的认领通过原子改名接管，只有一个节点能成功
+ * 结果文件先写临时文件再改名，重复处理同一块只会得到相同的文件，按块序号依次拼接即为完整结果
+*/
+class BatchRunner
+{
+public:
+    typedef std::function<bool(const std::string &image, std::string &text)> RecognizeFunc;
+
+    BatchRunner(const BatchOptions &options, const RecognizeFunc &recognize);
+
+    //处理完所有能领取的块后返回本节点处理的块数，出错时返回-1
+    int run();
+
+    //所有块都已完成时，按块序号把结果合并到output，返回是否成功
+    bool merge(const std::string &output);
+
+    std::string workDir() const
+    {
+        return m_workDir;
+    }
+
+private:
+    bool loadManifest();
+    bool claim(size_t chunk);
+    bool processChunk(size_t chunk);
+    std::string chunkPath(const char *dir, size_t chunk) const;
+
+    BatchOptions m_options;
+    RecognizeFunc m_recognize;
+    std::string m_workDir;
+    std::string m_baseDir;            //清单所在目录
+    std::string m_nodeId;             //主机名-进程号，写入认领文件便于排查
+    std::vector<std::string> m_paths;
+};
+
+#endif // BATCHRUNNER_H
@@ -21,6 +21,7 @@
 
 
 #include "dbusocr_adaptor.h"
+#include "paddleocr-ncnn/metrics.h"
 #include <QtCore/QMetaObject>
 #include <QtCore/QByteArray>
 #include <QtCore/QList>
@@ -51,6 +52,63 @@ bool DbusOcrAdaptor::openFile(QString filePath)
     return true;
 }
 
+QVariantMap DbusOcrAdaptor::metrics() const
+{
+    EngineMetrics::Snapshot snapshot = EngineMetrics::instance()->snapshot();
+    QVariantMap map;
+    map["requests"] = qlonglong(snapshot.counters[EngineMetrics::Requests]);
+    map["requestsDropped"] = qlonglong(snapshot.counters[EngineMetrics::RequestsDropped]);
+    map["requestsInFlight"] = qlonglong(snapshot.counters[EngineMetrics::RequestsInFlight]);
+    map["textLines"] = qlonglong(snapshot.counters[EngineMetrics::TextLines]);
+    map["memoryPlanHitRate"] = snapshot.hitRate(EngineMetrics::MemoryPlanHits, EngineMetrics::MemoryPlanMisses);
+    map["convTuneHitRate"] = snapshot.hitRate(EngineMetrics::ConvTuneHits, EngineMetrics::ConvTuneMisses);
+    map["modelBytes"] = qlonglong(snapshot.gauges[EngineMetrics::ModelBytes]);
+    map["recognizeQueueDepth"] = qlonglong(snapshot.gauges[EngineMetrics::RecognizeQueueDepth]);
+    map["watchQueueDepth"] = qlonglong(snapshot.gauges[EngineMetrics::WatchQueueDepth]);
+
+    //线程利用率：自启动以来线程池忙碌时间占全部线程时间的比例
+    double busySeconds = snapshot.counters[EngineMetrics::WorkerBusyUs] / 1e6;
+    long long threads = snapshot.gauges[EngineMetrics::WorkerThreads];
+    map["workerThreads"] = qlonglong(threads);
+    map["workerBusySeconds"] = busySeconds;
+    map["workerUtilization"] = threads > 0 && snapshot.uptimeSeconds > 0 ? busySeconds / (threads * snapshot.uptimeSeconds) : 0.0;
+    map["uptimeSeconds"] = snapshot.uptimeSeconds;
+
+    //各阶段耗时：次数、均值和分位数，单位毫秒
+    const char *stages[EngineMetrics::StageCount] = {"request", "detect", "recognize"};
+    for (int i = 0; i < EngineMetrics::StageCount; i++) {
+        const EngineMetrics::Histogram &histogram = snapshot.stages[i];
+        QString stage(stages[i]);
+        map[stage + "Count"] = qlonglong(histogram.count);
+        map[stage + "MeanMs"] = histogram.count > 0 ? histogram.sumMs / histogram.count : 0.0;
+        map[stage + "P50Ms"] = histogram.quantileMs(0.5);
+        map[stage + "P95Ms"] = histogram.quantileMs(0.95);
+        map[stage + "P99Ms"] = histogram.quantileMs(0.99);
+    }
+    return map;
+}
+
+QString DbusOcrAdaptor::metricsText() const
+{
+    return QString::fromStdString(EngineMetrics::instance()->prometheusText());
+}
+
+bool DbusOcrAdaptor::reloadModels()
+{
+    qDebug() << __FUNCTION__ << __LINE__;
+    bool started = false;
+    QMetaObject::invokeMethod(parent(), "reloadModels", Q_RETURN_ARG(bool, started));
+    return started;
+}
+
+bool DbusOcrAdaptor::setLexicon(QString path)
+{
+    qDebug() << __FUNCTION__ << __LINE__ << path;
+    bool loaded = false;
+    QMetaObject::invokeMethod(parent(), "setLexicon", Q_RETURN_ARG(bool, loaded), Q_ARG(QString, path));
+    return loaded;
+}
+
 void DbusOcrAdaptor::openImageAndName(QByteArray images,QString imageName)
 {
     qDebug() << __FUNCTION__ << __LINE__;
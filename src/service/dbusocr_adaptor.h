@@ -56,17 +56,40 @@ class DbusOcrAdaptor: public QDBusAbstractAdaptor
                                        "      <arg direction=\"out\" type=\"b\"/>\n"
                                        "    </method>\n"
 
+                                       "    <method name=\"reloadModels\">\n"
+                                       "      <arg direction=\"out\" type=\"b\"/>\n"
+                                       "    </method>\n"
+
+                                       "    <method name=\"setLexicon\">\n"
+                                       "      <arg direction=\"in\" type=\"s\" name=\"path\"/>\n"
+                                       "      <arg direction=\"out\" type=\"b\"/>\n"
+                                       "    </method>\n"
+
+                                       "    <property name=\"Metrics\" type=\"a{sv}\" access=\"read\"/>\n"
+                                       "    <property name=\"MetricsText\" type=\"s\" access=\"read\"/>\n"
+
                                        "  </interface>\n")
+    //引擎运行指标，读取时现场合并，不发送属性变化通知
+    Q_PROPERTY(QVariantMap Metrics READ metrics)
+    //同一份指标的Prometheus文本格式
+    Q_PROPERTY(QString MetricsText READ metricsText)
 public:
     explicit DbusOcrAdaptor(QObject *parent);
     virtual ~DbusOcrAdaptor();
 
+    QVariantMap metrics() const;
+    QString metricsText() const;
+
 public Q_SLOTS: // METHODS
     void openImage(QByteArray images);
     void openImageAndName(QByteArray images,QString imageName);
 
     bool openFile(QString filePath);
 
+    bool reloadModels();
+
+    bool setLexicon(QString path);
+
 Q_SIGNALS: // SIGNALS
 };
 
@@ -0,0 +1,673 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "httpserver.h"
+#include "jsonutil.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const char *statusText(int status)
+{
+    switch (status) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 422: return "Unprocessable Entity";
+    case 431: return "Request Header Fields Too Large";
+    case 503: return "Service Unavailable";
+    default: return "Internal Server Error";
+    }
+}
+
+std::string toLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return text;
+}
+
+std::string trim(const std::string &text)
+{
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+//取出形如 key=value 或 key="value" 的参数
+std::string headerParam(const std::string &header, const std::string &key)
+{
+    std::string lower = toLower(header);
+    size_t pos = 0;
+    while ((pos = lower.find(key + "=", pos)) != std::string::npos) {
+        if (pos == 0 || lower[pos - 1] == ';' || lower[pos - 1] == ' ' || lower[pos - 1] == '\t') {
+            size_t begin = pos + key.size() + 1;
+            if (begin < header.size() && header[begin] == '"') {
+                size_t end = header.find('"', begin + 1);
+                return header.substr(begin + 1, end == std::string::npos ? std::string::npos : end - begin - 1);
+            }
+            size_t end = header.find(';', begin);
+            return trim(header.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+        }
+        pos += key.size();
+    }
+    return std::string();
+}
+
+std::string jsonError(const std::string &message)
+{
+    return "{\"error\":" + jsonString(message) + "}";
+}
+
+//连接上的读缓冲，已解析的部分用pos标记，攒够一定量再从头部删除
+class Connection
+{
+public:
+    Connection(int fd, int timeoutMs)
+        : m_fd(fd)
+        , m_timeoutMs(timeoutMs)
+        , pos(0)
+    {
+    }
+
+    //读取更多数据，对端关闭、超时或出错时返回false
+    bool fill()
+    {
+        if (pos == buffer.size() || pos > 1024 * 1024) {
+            buffer.erase(0, pos);
+            pos = 0;
+        }
+        struct pollfd pfd = {m_fd, POLLIN, 0};
+        if (poll(&pfd, 1, m_timeoutMs) <= 0) {
+            return false;
+        }
+        char chunk[64 * 1024];
+        ssize_t size = recv(m_fd, chunk, sizeof(chunk), 0);
+        if (size <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(size));
+        return true;
+    }
+
+    //读取一行，不含行尾的CRLF
+    bool readLine(std::string &line, size_t limit)
+    {
+        size_t end;
+        while ((end = buffer.find("\r\n", pos)) == std::string::npos) {
+            if (buffer.size() - pos > limit || !fill()) {
+                return false;
+            }
+        }
+        line = buffer.substr(pos, end - pos);
+        pos = end + 2;
+        return true;
+    }
+
+    bool sendAll(const std::string &data)
+    {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t size = send(m_fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (size <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(size);
+        }
+        return true;
+    }
+
+private:
+    int m_fd;
+    int m_timeoutMs;
+
+public:
+    std::string buffer;
+    size_t pos;
+};
+
+//流式multipart解析：只保留第一个文件部分的内容，其余部分直接丢弃
+class MultipartParser
+{
+public:
+    explicit MultipartParser(const std::string &boundary)
+        : m_delimiter("\r\n--" + boundary)
+        , m_pending("\r\n") //第一个分隔符前没有换行，补上后所有分隔符形式一致
+        , m_state(Preamble)
+        , m_inFile(false)
+        , m_haveFile(false)
+    {
+    }
+
+    //格式错误时返回false
+    bool feed(const char *data, size_t size, std::string &file)
+    {
+        m_pending.append(data, size);
+        for (;;) {
+            if (m_state == Preamble || m_state == Data) {
+                size_t found = m_pending.find(m_delimiter);
+                if (found == std::string::npos) {
+                    //末尾可能是半个分隔符，留到下次
+                    size_t keep = std::min(m_pending.size(), m_delimiter.size() - 1);
+                    if (m_inFile) {
+                        file.append(m_pending, 0, m_pending.size() - keep);
+                    }
+                    m_pending.erase(0, m_pending.size() - keep);
+                    return true;
+                }
+                if (m_inFile) {
+                    file.append(m_pending, 0, found);
+                    m_haveFile = true;
+                    m_inFile = false;
+                }
+                m_pending.erase(0, found + m_delimiter.size());
+                m_state = Delimiter;
+            } else if (m_state == Delimiter) {
+                if (m_pending.size() < 2) {
+                    return true;
+                }
+                if (m_pending.compare(0, 2, "--") == 0) {
+                    m_state = Epilogue;
+                    continue;
+                }
+                size_t lineEnd = m_pending.find("\r\n");
+                if (lineEnd == std::string::npos) {
+                    return m_pending.size() < 256;
+                }
+                m_pending.erase(0, lineEnd + 2);
+                m_state = Headers;
+            } else if (m_state == Headers) {
+                size_t end = m_pending.find("\r\n\r\n");
+                if (end == std::string::npos) {
+                    return m_pending.size() < 16 * 1024;
+                }
+                //第一个带文件名的部分，或者名为image/file的部分
+                std::string headers = m_pending.substr(0, end + 2);
+                std::string disposition;
+                size_t lineBegin = 0;
+                size_t lineEnd;
+                while ((lineEnd = headers.find("\r\n", lineBegin)) != std::string::npos) {
+                    std::string line = headers.substr(lineBegin, lineEnd - lineBegin);
+                    lineBegin = lineEnd + 2;
+                    size_t colon = line.find(':');
+                    if (colon != std::string::npos && toLower(trim(line.substr(0, colon))) == "content-disposition") {
+                        disposition = line.substr(colon + 1);
+                    }
+                }
+                std::string name = headerParam(disposition, "name");
+                m_inFile = !m_haveFile && (!headerParam(disposition, "filename").empty() || name == "image" || name == "file");
+                m_pending.erase(0, end + 4);
+                m_state = Data;
+            } else {
+                m_pending.clear();
+                return true;
+            }
+        }
+    }
+
+    bool finished() const
+    {
+        return m_state == Epilogue;
+    }
+
+    bool haveFile() const
+    {
+        return m_haveFile;
+    }
+
+private:
+    enum State {
+        Preamble,  //第一个分隔符之前
+        Delimiter, //分隔符之后，判断是下一部分还是结束
+        Headers,   //部分的头
+        Data,      //部分的内容
+        Epilogue   //结束分隔符之后
+    };
+
+    std::string m_delimiter;
+    std::string m_pending;
+    State m_state;
+    bool m_inFile;
+    bool m_haveFile;
+};
+
+}
+
+OcrHttpServer::OcrHttpServer(const RecognizeFunc &recognize, const OcrHttpServerOptions &options)
+    : m_recognize(recognize)
+    , m_options(options)
+    , m_listenFd(-1)
+    , m_port(0)
+    , m_stopping(false)
+    , m_recognizing(0)
+{
+}
+
+OcrHttpServer::~OcrHttpServer()
+{
+    stop();
+}
+
+bool OcrHttpServer::listenUnix(const std::string &path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+
+    //只替换上次遗留的套接字文件，不删除普通文件
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            return false;
+        }
+        unlink(path.c_str());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || chmod(path.c_str(), 0600) != 0) {
+        close(fd);
+        return false;
+    }
+    m_unixPath = path;
+    return startAccepting(fd);
+}
+
+bool OcrHttpServer::listenTcp(const std::string &host, int port)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    struct addrinfo *result = nullptr;
+    if (getaddrinfo(host.empty() ? "127.0.0.1" : host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) {
+        return false;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = result; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct sockaddr_storage bound;
+    socklen_t length = sizeof(bound);
+    if (getsockname(fd, reinterpret_cast<struct sockaddr *>(&bound), &length) == 0) {
+        if (bound.ss_family == AF_INET) {
+            m_port = ntohs(reinterpret_cast<struct sockaddr_in *>(&bound)->sin_port);
+        } else if (bound.ss_family == AF_INET6) {
+            m_port = ntohs(reinterpret_cast<struct sockaddr_in6 *>(&bound)->sin6_port);
+        }
+    }
+    return startAccepting(fd);
+}
+
+bool OcrHttpServer::startAccepting(int fd)
+{
+    if (m_listenFd >= 0 || listen(fd, 128) != 0) {
+        close(fd);
+        return false;
+    }
+    m_listenFd = fd;
+    m_stopping = false;
+    m_acceptThread = std::thread(&OcrHttpServer::acceptLoop, this);
+    return true;
+}
+
+void OcrHttpServer::stop()
+{
+    m_stopping = true;
+    if (m_acceptThread.joinable()) {
+        m_acceptThread.join();
+    }
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        m_listenFd = -1;
+    }
+    if (!m_unixPath.empty()) {
+        unlink(m_unixPath.c_str());
+        m_unixPath.clear();
+    }
+
+    //关闭读写唤醒阻塞在poll上的连接，排队的请求不再等待，正在识别的请求做完后自行退出
+    std::unique_lock<std::mutex> locker(m_mutex);
+    m_admitCond.notify_all();
+    for (int fd : m_connections) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    m_cond.wait(locker, [this]() {
+        return m_connections.empty();
+    });
+}
+
+void OcrHttpServer::acceptLoop()
+{
+    while (!m_stopping) {
+        struct pollfd pfd = {m_listenFd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        std::lock_guard<std::mutex> locker(m_mutex);
+        if (static_cast<int>(m_connections.size()) >= m_options.maxConnections) {
+            std::string body = jsonError("too many connections");
+            std::string response = "HTTP/1.1 503 Service Unavailable\r\nContent-Type: application/json\r\nConnection: close\r\nContent-Length: "
+                                   + std::to_string(body.size()) + "\r\n\r\n" + body;
+            send(fd, response.data(), response.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            close(fd);
+            continue;
+        }
+        m_connections.insert(fd);
+        std::thread(&OcrHttpServer::serveConnection, this, fd).detach();
+    }
+}
+
+//计数信号量：有空位或者不限数量时立即返回true，否则排队等待，超时或服务停止时返回false
+bool OcrHttpServer::admitRecognition()
+{
+    std::unique_lock<std::mutex> locker(m_mutex);
+    bool admitted = m_admitCond.wait_for(locker, std::chrono::milliseconds(m_options.admissionTimeoutMs), [this]() {
+        return m_stopping || m_options.maxRecognitions <= 0 || m_recognizing < m_options.maxRecognitions;
+    });
+    if (!admitted || m_stopping) {
+        return false;
+    }
+    ++m_recognizing;
+    return true;
+}
+
+void OcrHttpServer::finishRecognition()
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    --m_recognizing;
+    m_admitCond.notify_one();
+}
+
+void OcrHttpServer::serveConnection(int fd)
+{
+    Connection connection(fd, m_options.idleTimeoutMs);
+    auto respondAs = [&connection](int status, const char *contentType, const std::string &body, bool keepAlive, const char *extraHeaders) {
+        std::string response = "HTTP/1.1 " + std::to_string(status) + " " + statusText(status) + "\r\n"
+                               + "Content-Type: " + contentType + "\r\n"
+                               + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               + (keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n")
+                               + extraHeaders + "\r\n" + body;
+        return connection.sendAll(response);
+    };
+    auto respond = [&respondAs](int status, const std::string &body, bool keepAlive, const char *extraHeaders) {
+        return respondAs(status, "application/json; charset=utf-8", body, keepAlive, extraHeaders);
+    };
+
+    for (;;) {
+        //1.请求行和请求头
+        std::string requestLine;
+        if (!connection.readLine(requestLine, m_options.maxHeaderSize)) {
+            if (connection.buffer.size() - connection.pos > m_options.maxHeaderSize) {
+                respond(431, jsonError("request header too large"), false, "");
+            }
+            break;
+        }
+        if (requestLine.empty()) {
+            continue; //请求之间允许多余的空行
+        }
+        std::map<std::string, std::string> headers;
+        std::string line;
+        size_t headerSize = requestLine.size();
+        bool headerOk = true;
+        while ((headerOk = connection.readLine(line, m_options.maxHeaderSize)) && !line.empty()) {
+            headerSize += line.size() + 2;
+            if (headerSize > m_options.maxHeaderSize) {
+                headerOk = false;
+                break;
+            }
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                headers[toLower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+            }
+        }
+        if (!headerOk) {
+            respond(headerSize > m_options.maxHeaderSize ? 431 : 400, jsonError("bad request header"), false, "");
+            break;
+        }
+
+        size_t methodEnd = requestLine.find(' ');
+        size_t targetEnd = requestLine.rfind(' ');
+        if (methodEnd == std::string::npos || targetEnd <= methodEnd) {
+            respond(400, jsonError("bad request line"), false, "");
+            break;
+        }
+        std::string method = requestLine.substr(0, methodEnd);
+        std::string target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+        std::string version = requestLine.substr(targetEnd + 1);
+        std::string path = target.substr(0, target.find('?'));
+        std::string connectionHeader = toLower(headers["connection"]);
+        bool keepAlive = version == "HTTP/1.1" ? connectionHeader != "close" : connectionHeader == "keep-alive";
+
+        //2.请求体：边读边交给multipart解析，只保留图片内容
+        bool isOcr = path == "/v1/ocr" && method == "POST";
+        std::string contentType = headers["content-type"];
+        std::unique_ptr<MultipartParser> multipart;
+        if (isOcr && toLower(contentType).compare(0, 10, "multipart/") == 0) {
+            std::string boundary = headerParam(contentType, "boundary");
+            if (boundary.empty()) {
+                respond(400, jsonError("multipart boundary missing"), false, "");
+                break;
+            }
+            multipart.reset(new MultipartParser(boundary));
+        }
+
+        std::string image;
+        size_t bodySize = 0;
+        int bodyStatus = 0;
+        auto sink = [&](const char *data, size_t size) {
+            bodySize += size;
+            if (bodySize > m_options.maxBodySize) {
+                bodyStatus = 413;
+            } else if (multipart) {
+                if (!multipart->feed(data, size, image)) {
+                    bodyStatus = 400;
+                }
+            } else if (isOcr) {
+                image.append(data, size);
+            }
+            return bodyStatus == 0;
+        };
+        //从缓冲区和套接字中读出size字节交给sink
+        auto readBody = [&](size_t size) {
+            while (size > 0) {
+                if (connection.pos == connection.buffer.size() && !connection.fill()) {
+                    return false;
+                }
+                size_t take = std::min(size, connection.buffer.size() - connection.pos);
+                bool ok = sink(connection.buffer.data() + connection.pos, take);
+                connection.pos += take;
+                size -= take;
+                if (!ok) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        bool chunked = toLower(headers["transfer-encoding"]).find("chunked") != std::string::npos;
+        size_t contentLength = 0;
+        if (!chunked && headers.count("content-length")) {
+            char *end = nullptr;
+            contentLength = strtoull(headers["content-length"].c_str(), &end, 10);
+            if (end == nullptr || *end != '\0') {
+                respond(400, jsonError("bad content length"), false, "");
+                break;
+            }
+            if (contentLength > m_options.maxBodySize) {
+                respond(413, jsonError("request body too large"), false, "");
+                break;
+            }
+        }
+        if (toLower(headers["expect"]) == "100-continue" && !connection.sendAll("HTTP/1.1 100 Continue\r\n\r\n")) {
+            break;
+        }
+
+        bool bodyOk = true;
+        if (chunked) {
+            for (;;) {
+                if (!connection.readLine(line, 1024)) {
+                    bodyOk = false;
+                    break;
+                }
+                char *end = nullptr;
+                size_t chunkSize = strtoull(line.c_str(), &end, 16);
+                if (end == line.c_str()) {
+                    bodyStatus = 400;
+                    bodyOk = false;
+                    break;
+                }
+                if (chunkSize == 0) {
+                    //跳过结尾的trailer
+                    while ((bodyOk = connection.readLine(line, m_options.maxHeaderSize)) && !line.empty()) {
+                    }
+                    break;
+                }
+                if (!readBody(chunkSize) || !connection.readLine(line, 2) || !line.empty()) {
+                    bodyOk = false;
+                    break;
+                }
+            }
+        } else {
+            bodyOk = readBody(contentLength);
+        }
+        if (!bodyOk) {
+            //请求体不完整时连接已无法继续使用
+            if (bodyStatus != 0) {
+                respond(bodyStatus, jsonError(bodyStatus == 413 ? "request body too large" : "malformed request body"), false, "");
+            }
+            break;
+        }
+
+        //3.路由
+        if (path == "/v1/health") {
+            if (!respond(200, "{\"status\":\"ok\"}", keepAlive, "")) {
+                break;
+            }
+        } else if (path == "/metrics" && m_options.metrics) {
+            if (!respondAs(200, "text/plain; version=0.0.4; charset=utf-8", m_options.metrics(), keepAlive, "")) {
+                break;
+            }
+        } else if (path == "/v1/ocr" && method != "POST") {
+            if (!respond(405, jsonError("method not allowed"), keepAlive, "Allow: POST\r\n")) {
+                break;
+            }
+        } else if (path != "/v1/ocr") {
+            if (!respond(404, jsonError("not found"), keepAlive, "")) {
+                break;
+            }
+        } else if (multipart && !multipart->haveFile()) {
+            if (!respond(400, jsonError("no file part in multipart body"), keepAlive, "")) {
+                break;
+            }
+        } else if (image.empty()) {
+            if (!respond(400, jsonError("empty image"), keepAlive, "")) {
+                break;
+            }
+        } else if (!admitRecognition()) {
+            if (!respond(503, jsonError("too many recognitions in progress"), keepAlive, "Retry-After: 1\r\n")) {
+                break;
+            }
+        } else {
+            std::string text;
+            bool recognized = m_recognize(image, text);
+            finishRecognition();
+            if (!recognized) {
+                if (!respond(422, jsonError("cannot decode image"), keepAlive, "")) {
+                    break;
+                }
+            } else {
+                //按行拆分，去掉末尾的空行
+                std::string body = "{\"text\":" + jsonString(text) + ",\"lines\":[";
+                size_t begin = 0;
+                bool first = true;
+                while (begin < text.size()) {
+                    size_t end = text.find('\n', begin);
+                    if (end == std::string::npos) {
+                        end = text.size();
+                    }
+                    body += (first ? "" : ",") + jsonString(text.substr(begin, end - begin));
+                    first = false;
+                    begin = end + 1;
+                }
+                body += "]}";
+                if (!respond(200, body, keepAlive, "")) {
+                    break;
+                }
+            }
+        }
+        if (!keepAlive) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_connections.erase(fd);
+    close(fd);
+    m_cond.notify_all();
+}
@@ -0,0 +1,94 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+//服务可选项
+struct OcrHttpServerOptions {
+    size_t maxBodySize = 64 * 1024 * 1024; //请求体上限，超过时返回413
+    size_t maxHeaderSize = 16 * 1024;      //请求头上限，超过时返回431
+    int idleTimeoutMs = 30000;             //keep-alive连接的空闲超时，也是读取请求的超时
+    int maxConnections = 64;               //同时保持的连接数上限，超过时返回503
+    int maxRecognitions = 0;               //同时交给引擎识别的请求数上限，0表示不限；超出的请求排队等待
+    int admissionTimeoutMs = 10000;        //排队等待识别的超时，超过时返回503
+    std::function<std::string()> metrics;  //返回Prometheus文本格式的运行指标，为空时不提供/metrics
+};
+
+/*
+ * @bref: OcrHttpServer 本地HTTP/1.1识别服务，监听Unix域套接字或本机TCP端口，不依赖会话总线
+ * POST /v1/ocr      请求体为图片本身，或multipart/form-data中的第一个文件；返回 {"text": ..., "lines": [...]}
+ * GET  /v1/health   返回 {"status": "ok"}
+ * GET  /metrics     设置了metrics时返回Prometheus文本格式的运行指标
+ * 支持keep-alive、chunked请求体和Expect: 100-continue；请求体边读边解析，multipart只保留文件内容
+ * 每个连接一个线程，识别本身在引擎的线程池中执行，多个连接同时请求时由引擎合批；
+ * 同时识别的请求数按引擎的并行能力限制，多出的连接在服务端排队，不会一起压到引擎上
+*/
+class OcrHttpServer
+{
+public:
+    //识别图片文件内容，图片无法解码时返回false
+    typedef std::function<bool(const std::string &image, std::string &text)> RecognizeFunc;
+
+    explicit OcrHttpServer(const RecognizeFunc &recognize, const OcrHttpServerOptions &options = OcrHttpServerOptions());
+    ~OcrHttpServer();
+
+    //监听Unix域套接字，已存在的同名套接字文件会被替换
+    bool listenUnix(const std::string &path);
+
+    //监听TCP端口，host默认只绑定本机；port为0时由系统分配，可通过port()获取
+    bool listenTcp(const std::string &host, int port);
+
+    int port() const
+    {
+        return m_port;
+    }
+
+    //停止接受新连接并关闭所有连接，等待正在处理的请求结束
+    void stop();
+
+private:
+    bool startAccepting(int fd);
+    void acceptLoop();
+    void serveConnection(int fd);
+    bool admitRecognition();
+    void finishRecognition();
+
+    RecognizeFunc m_recognize;
+    OcrHttpServerOptions m_options;
+    int m_listenFd;
+    int m_port;
+    std::string m_unixPath;
+    std::thread m_acceptThread;
+    std::atomic_bool m_stopping;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::set<int> m_connections; //活动连接，停止时统一关闭
+    int m_recognizing;           //正在识别的请求数，由m_mutex保护
+    std::condition_variable m_admitCond;
+};
+
+#endif // HTTPSERVER_H
@@ -36,6 +36,8 @@
 class OcrInterface: public QDBusAbstractInterface
 {
     Q_OBJECT
+    Q_PROPERTY(QVariantMap Metrics READ metrics)
+    Q_PROPERTY(QString MetricsText READ metricsText)
 public:
     static inline const char *staticInterfaceName()
     {
@@ -52,6 +54,22 @@ public:
     QDBusConnection dbus = QDBusConnection::sessionBus();
     ~OcrInterface();
 
+    /*
+    * @bref:metrics 引擎运行指标：请求数、拒绝数、各阶段耗时分位数、缓存命中率、模型内存和线程利用率
+    */
+    inline QVariantMap metrics() const
+    {
+        return qvariant_cast<QVariantMap>(property("Metrics"));
+    }
+
+    /*
+    * @bref:metricsText 同一份指标的Prometheus文本格式
+    */
+    inline QString metricsText() const
+    {
+        return qvariant_cast<QString>(property("MetricsText"));
+    }
+
 public Q_SLOTS: // METHODS
     /*
     * @bref:openFile 通过路径打开图片文件
@@ -63,6 +81,25 @@ public Q_SLOTS: // METHODS
         return call(QStringLiteral("openFile"), filePath);
     }
 
+    /*
+    * @bref:reloadModels 在后台重新加载模型，预热完成后切换
+    * @return: QDBusPendingReply 是否开始加载，已有重新加载在进行时为false
+    */
+    inline QDBusPendingReply<bool> reloadModels()
+    {
+        return call(QStringLiteral("reloadModels"));
+    }
+
+    /*
+    * @bref:setLexicon 设置约束解码的词表文件，识别结果须整行匹配其中一项
+    * @param: path 词表文件的路径，每行一项，为空时恢复不受约束的识别
+    * @return: QDBusPendingReply 是否加载成功，文件无法打开时为false
+    */
+    inline QDBusPendingReply<bool> setLexicon(const QString &path)
+    {
+        return call(QStringLiteral("setLexicon"), path);
+    }
+
     /*
     * @bref:openImages
     * @param: image 图片
@@ -0,0 +1,352 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "watchfolder.h"
+#include "paddleocr-ncnn/paddleocr.h"
+#include "paddleocr-ncnn/metrics.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QSocketNotifier>
+#include <QThread>
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static const char *journalName = ".lingmo-ocr.journal";
+
+WatchFolder::WatchFolder(const QString &dirPath, int workers, QObject *parent)
+    : QObject(parent)
+    , m_dirPath(QDir(dirPath).absolutePath())
+    , m_workerCount(workers)
+    , m_inotifyFd(-1)
+    , m_notifier(nullptr)
+    , m_stopping(false)
+    , m_journalFd(-1)
+    , m_lastProcessed(0)
+    , m_lastReportMs(0)
+{
+    //识别引擎内部已经是多线程的，同时识别的图片数不宜过多，否则只是互相争抢CPU
+    if (m_workerCount <= 0) {
+        m_workerCount = qBound(1, QThread::idealThreadCount() / 2, 4);
+    }
+
+    m_statsTimer.setInterval(10000);
+    connect(&m_statsTimer, &QTimer::timeout, this, &WatchFolder::reportStats);
+}
+
+WatchFolder::~WatchFolder()
+{
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_stopping = true;
+    }
+    m_cond.notify_all();
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+    if (m_journalFd >= 0) {
+        ::close(m_journalFd);
+    }
+}
+
+bool WatchFolder::isImageFile(const QString &fileName)
+{
+    static const QStringList suffixes = {"png", "jpg", "jpeg", "bmp", "tif", "tiff", "webp"};
+    return !fileName.startsWith('.') && !fileName.contains('\n')
+           && suffixes.contains(QFileInfo(fileName).suffix().toLower());
+}
+
+bool WatchFolder::start()
+{
+    if (!QFileInfo(m_dirPath).isDir()) {
+        qWarning() << "watch folder does not exist:" << m_dirPath;
+        return false;
+    }
+
+    //写完关闭和移入都代表文件已经完整，新建事件时文件可能还没写完，不监听
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0 || inotify_add_watch(m_inotifyFd, QFile::encodeName(m_dirPath).constData(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0) {
+        qWarning() << "failed to watch folder:" << m_dirPath;
+        return false;
+    }
+
+    loadJournal();
+    m_journalFd = ::open(QFile::encodeName(m_dirPath + "/" + journalName).constData(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (m_journalFd < 0) {
+        qWarning() << "failed to open journal in" << m_dirPath;
+        return false;
+    }
+
+    m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &WatchFolder::readEvents);
+
+    //在主线程先把模型加载好，再开始识别
+    if (!m_recognize) {
+        PaddleOCRApp::instance();
+    }
+    for (int i = 0; i < m_workerCount; i++) {
+        m_workers.emplace_back(&WatchFolder::workerLoop, this);
+    }
+
+    //先开始监听再扫描，扫描期间放入的文件不会漏掉，重复的由队列去重
+    scanDirectory();
+    m_lastReportMs = QDateTime::currentMSecsSinceEpoch();
+    m_statsTimer.start();
+    qInfo() << "watching" << m_dirPath << "with" << m_workerCount << "workers," << m_stats.resumed.load() << "already done";
+    return true;
+}
+
+QString WatchFolder::journalRecord(const QString &fileName) const
+{
+    //文件名相同但内容被替换的图片需要重新识别，记录中带上大小和修改时间
+    QFileInfo info(m_dirPath + "/" + fileName);
+    if (!info.exists()) {
+        return QString();
+    }
+    return QString("%1 %2 %3").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()).arg(fileName);
+}
+
+void WatchFolder::loadJournal()
+{
+    QString journalPath = m_dirPath + "/" + journalName;
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QByteArray content = file.readAll();
+    file.close();
+
+    //最后一行没有换行符说明写到一半时崩溃了，丢弃；文件已删除或已改变的记录也不再保留
+    QStringList kept;
+    int lines = 0;
+    int begin = 0;
+    int end;
+    while ((end = content.indexOf('\n', begin)) >= 0) {
+        QString record = QString::fromUtf8(content.constData() + begin, end - begin);
+        begin = end + 1;
+        ++lines;
+        QString fileName = record.section(' ', 2);
+        if (!fileName.isEmpty() && journalRecord(fileName) == record && !m_done.contains(record)) {
+            m_done.insert(record);
+            kept.append(record);
+        }
+    }
+    if (kept.size() == lines && begin == content.size()) {
+        return;
+    }
+
+    //压缩日志：写临时文件落盘后替换
+    QString tempPath = m_dirPath + "/" + journalName + ".tmp";
+    QFile temp(tempPath);
+    if (!temp.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return;
+    }
+    for (const QString &record : kept) {
+        temp.write(record.toUtf8());
+        temp.write("\n");
+    }
+    temp.flush();
+    fsync(temp.handle());
+    temp.close();
+    if (::rename(QFile::encodeName(tempPath).constData(), QFile::encodeName(journalPath).constData()) != 0) {
+        QFile::remove(tempPath);
+    }
+}
+
+void WatchFolder::scanDirectory()
+{
+    QDir dir(m_dirPath);
+    for (const QString &fileName : dir.entryList(QDir::Files, QDir::Name)) {
+        if (isImageFile(fileName) && !enqueue(fileName)) {
+            ++m_stats.resumed;
+        }
+    }
+}
+
+bool WatchFolder::enqueue(const QString &fileName)
+{
+    QString record = journalRecord(fileName);
+    if (record.isEmpty()) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_queued.contains(fileName)) {
+        m_dirty.insert(fileName);
+        return true;
+    }
+    if (m_done.contains(record)) {
+        return false;
+    }
+    m_queued.insert(fileName);
+    m_pending.push_back(fileName);
+    updateQueueDepth();
+    ++m_stats.discovered;
+    m_cond.notify_one();
+    return true;
+}
+
+//调用方须持有m_mutex
+void WatchFolder::updateQueueDepth()
+{
+    m_stats.queueDepth = static_cast<int>(m_pending.size());
+    EngineMetrics::instance()->setGauge(EngineMetrics::WatchQueueDepth, m_stats.queueDepth);
+}
+
+void WatchFolder::readEvents()
+{
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = ::read(m_inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char *pos = buffer; pos < buffer + length;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(pos);
+            pos += sizeof(struct inotify_event) + event->len;
+
+            //事件队列溢出时有事件丢失，重新扫描整个目录
+            if (event->mask & IN_Q_OVERFLOW) {
+                scanDirectory();
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+            QString fileName = QFile::decodeName(event->name);
+            if (isImageFile(fileName)) {
+                enqueue(fileName);
+            }
+        }
+    }
+}
+
+void WatchFolder::workerLoop()
+{
+    for (;;) {
+        QString fileName;
+        {
+            std::unique_lock<std::mutex> locker(m_mutex);
+            m_cond.wait(locker, [this]() {
+                return m_stopping || !m_pending.empty();
+            });
+            if (m_stopping) {
+                return;
+            }
+            fileName = m_pending.front();
+            m_pending.pop_front();
+            updateQueueDepth();
+        }
+
+        ++m_stats.inFlight;
+        bool ok = processImage(fileName);
+        --m_stats.inFlight;
+        if (ok) {
+            ++m_stats.processed;
+        } else {
+            ++m_stats.failed;
+        }
+
+        std::lock_guard<std::mutex> locker(m_mutex);
+        if (m_dirty.remove(fileName)) {
+            m_pending.push_back(fileName);
+            updateQueueDepth();
+            m_cond.notify_one();
+        } else {
+            m_queued.remove(fileName);
+        }
+    }
+}
+
+bool WatchFolder::processImage(const QString &fileName)
+{
+    //记录取识别前的状态，识别期间文件被改写时下次启动会重新识别
+    QString record = journalRecord(fileName);
+    QString path = m_dirPath + "/" + fileName;
+    QString text;
+    if (m_recognize) {
+        QFile file(path);
+        std::string result;
+        if (record.isEmpty() || !file.open(QIODevice::ReadOnly) || !m_recognize(file.readAll().toStdString(), result)) {
+            qWarning() << "failed to recognize image:" << path;
+            return false;
+        }
+        text = QString::fromStdString(result);
+    } else {
+        QImage image(path);
+        if (record.isEmpty() || image.isNull()) {
+            qWarning() << "failed to read image:" << path;
+            return false;
+        }
+        text = PaddleOCRApp::instance()->getRecogitionResult(image);
+    }
+
+    //旁路文件先写临时文件并落盘再改名，崩溃后要么是完整的结果要么没有结果
+    QString tempPath = m_dirPath + "/." + fileName + ".txt.tmp";
+    QFile temp(tempPath);
+    if (!temp.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "failed to write result:" << tempPath;
+        return false;
+    }
+    QByteArray data = text.toUtf8();
+    bool written = temp.write(data) == data.size() && temp.flush() && fsync(temp.handle()) == 0;
+    temp.close();
+    if (!written || ::rename(QFile::encodeName(tempPath).constData(), QFile::encodeName(path + ".txt").constData()) != 0) {
+        QFile::remove(tempPath);
+        qWarning() << "failed to write result:" << path + ".txt";
+        return false;
+    }
+
+    //结果落盘之后才记入日志
+    appendJournal(record);
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_done.insert(record);
+    return true;
+}
+
+void WatchFolder::appendJournal(const QString &record)
+{
+    QByteArray line = record.toUtf8() + '\n';
+    std::lock_guard<std::mutex> locker(m_journalMutex);
+    if (::write(m_journalFd, line.constData(), static_cast<size_t>(line.size())) != line.size() || fdatasync(m_journalFd) != 0) {
+        qWarning() << "failed to append journal for" << record;
+    }
+}
+
+void WatchFolder::reportStats()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    unsigned long long processed = m_stats.processed;
+    qint64 elapsed = qMax<qint64>(1, now - m_lastReportMs);
+    m_stats.perMinute = (processed - m_lastProcessed) * 60000 / static_cast<unsigned long long>(elapsed);
+
+    //空闲时不刷屏
+    if (processed != m_lastProcessed || m_stats.queueDepth > 0 || m_stats.inFlight > 0) {
+        qInfo() << "watch" << m_dirPath << "processed" << processed << "failed" << m_stats.failed.load()
+                << "queue" << m_stats.queueDepth.load() << "in flight" << m_stats.inFlight.load()
+                << "per minute" << m_stats.perMinute.load();
+    }
+    m_lastProcessed = processed;
+    m_lastReportMs = now;
+}
@@ -0,0 +1,115 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef WATCHFOLDER_H
+#define WATCHFOLDER_H
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class QSocketNotifier;
+
+//监视目录的运行统计
+struct WatchStats {
+    std::atomic<unsigned long long> discovered{0}; //发现的待识别图片数
+    std::atomic<unsigned long long> processed{0};  //完成识别并写出结果的图片数
+    std::atomic<unsigned long long> failed{0};     //无法读取或无法写出结果的图片数
+    std::atomic<unsigned long long> resumed{0};    //启动时按日志跳过的已完成图片数
+    std::atomic<int> queueDepth{0};                //等待识别的图片数
+    std::atomic<int> inFlight{0};                  //正在识别的图片数
+    std::atomic<unsigned long long> perMinute{0};  //最近一个统计周期的吞吐，张/分钟
+};
+
+/*
+ * @bref: WatchFolder 监视目录，新放入的图片自动识别，结果写到同名的.txt旁路文件
+ * 完成的图片记录在目录下只追加的日志中，重启后跳过已完成的图片，中途崩溃只会重做未记录的图片
+*/
+class WatchFolder : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<bool(const std::string &image, std::string &text)> RecognizeFunc;
+
+    //workers: 同时识别的图片数，0表示按CPU核数自动选择
+    explicit WatchFolder(const QString &dirPath, int workers = 0, QObject *parent = nullptr);
+    ~WatchFolder();
+
+    //由外部识别图片文件内容，例如交给多进程识别；不设置时在本进程中识别，须在start之前设置
+    void setRecognizer(const RecognizeFunc &recognize)
+    {
+        m_recognize = recognize;
+    }
+
+    //开始监视，目录不存在或无法监视时返回false
+    bool start();
+
+    const WatchStats &stats() const
+    {
+        return m_stats;
+    }
+
+    //日志和临时文件不算作图片
+    static bool isImageFile(const QString &fileName);
+
+private slots:
+    void readEvents();
+    void reportStats();
+
+private:
+    void loadJournal();
+    void scanDirectory();
+    bool enqueue(const QString &fileName);
+    void updateQueueDepth();
+    void workerLoop();
+    bool processImage(const QString &fileName);
+    void appendJournal(const QString &record);
+    QString journalRecord(const QString &fileName) const;
+
+    QString m_dirPath;
+    int m_workerCount;
+    RecognizeFunc m_recognize;
+    int m_inotifyFd;
+    QSocketNotifier *m_notifier;
+    QTimer m_statsTimer;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<QString> m_pending;  //待识别的文件名，相对于监视目录
+    QSet<QString> m_queued;         //已在队列中或正在识别，避免同一文件的多次事件重复入队
+    QSet<QString> m_dirty;          //识别过程中又被改写的文件，完成后重新入队
+    QSet<QString> m_done;           //日志中已完成的记录：文件名 + 大小 + 修改时间
+    bool m_stopping;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_journalMutex;
+    int m_journalFd;
+
+    WatchStats m_stats;
+    unsigned long long m_lastProcessed; //上次报告时的完成数，用于计算吞吐
+    qint64 m_lastReportMs;
+};
+
+#endif // WATCHFOLDER_H
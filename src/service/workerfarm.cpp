@@ -0,0 +1,482 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "workerfarm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace {
+
+const uint32_t farmMagic = 0x4d524146; //"FARM"
+const int maxSlots = 8;
+const int workerFd = 3;
+const size_t maxReportSize = 4096;
+
+enum SlotState : uint32_t {
+    SlotFree = 0,
+    SlotRequest,  //主进程已写入图片，等待工作进程取走
+    SlotRunning,  //工作进程正在识别
+    SlotDone,     //结果已写回槽中
+    SlotFailed    //无法解码，或者工作进程在识别时退出
+};
+
+long long monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+//跨进程的futex，不能使用PRIVATE标志
+void futexWait(std::atomic<uint32_t> *word, uint32_t expected, int timeoutMs)
+{
+    struct timespec ts = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t> *word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+}
+
+//共享内存开头的控制区，之后按页对齐依次是各个槽的数据区
+struct FarmSlot {
+    std::atomic<uint32_t> state;
+    uint32_t reserved;
+    uint64_t ticket;            //主进程写入的顺序号，工作进程按顺序处理
+    uint64_t size;              //请求时为图片大小，完成后为结果大小
+    std::atomic<int64_t> startedMs; //工作进程开始识别的时间，用于判断卡死
+};
+
+//工作进程上报的内容，顺序锁保护：写入期间序号为奇数，读取前后序号不同则重读
+struct FarmReport {
+    std::atomic<uint32_t> sequence;
+    uint32_t size;
+    char data[maxReportSize];
+};
+
+struct FarmHeader {
+    uint32_t magic;
+    uint32_t slotCount;
+    uint64_t slotCapacity;
+    std::atomic<uint32_t> doorbell; //有新请求时加一并唤醒工作进程
+    uint32_t reserved;
+    FarmSlot slots[maxSlots];
+    FarmReport report;
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "shared memory atomics must be lock free");
+
+//同一时间只有一个写入方：工作进程，或者工作进程退出后的主进程
+static void writeReport(FarmReport &report, const std::string &data)
+{
+    if (data.size() > maxReportSize) {
+        return;
+    }
+    uint32_t sequence = report.sequence.load(std::memory_order_relaxed);
+    report.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(report.data, data.data(), data.size());
+    report.size = static_cast<uint32_t>(data.size());
+    report.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+//工作进程可能在写入途中被杀死，序号停在奇数，重试有限次后放弃
+static bool readReport(const FarmReport &report, std::string &data)
+{
+    for (int attempt = 0; attempt < 100; attempt++) {
+        uint32_t sequence = report.sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t size = std::min(report.size, static_cast<uint32_t>(maxReportSize));
+        data.assign(report.data, size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (report.sequence.load(std::memory_order_relaxed) == sequence) {
+            return size > 0;
+        }
+    }
+    return false;
+}
+
+static size_t headerSize()
+{
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (sizeof(FarmHeader) + page - 1) / page * page;
+}
+
+WorkerFarm::WorkerFarm(const std::string &program, const std::vector<std::string> &arguments, const WorkerFarmOptions &options)
+    : m_program(program)
+    , m_arguments(arguments)
+    , m_options(options)
+    , m_ticket(0)
+    , m_nextWorker(0)
+    , m_stopping(false)
+    , m_restarts(0)
+{
+    m_options.workers = std::max(1, m_options.workers);
+    m_options.slotsPerWorker = std::min(std::max(1, m_options.slotsPerWorker), maxSlots);
+}
+
+WorkerFarm::~WorkerFarm()
+{
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_stopping = true;
+    }
+    m_cond.notify_all();
+    if (m_monitor.joinable()) {
+        m_monitor.join();
+    }
+
+    for (Worker &worker : m_workers) {
+        if (worker.pid > 0) {
+            kill(worker.pid, SIGTERM);
+            waitpid(worker.pid, nullptr, 0);
+        }
+        if (worker.header) {
+            munmap(worker.header, worker.mapSize);
+        }
+        if (worker.fd >= 0) {
+            close(worker.fd);
+        }
+    }
+}
+
+bool WorkerFarm::createShared(Worker &worker)
+{
+    //描述符避开0~3，生成子进程时才能安全地dup2到3号
+    int fd = static_cast<int>(syscall(SYS_memfd_create, "lingmo-ocr-farm", MFD_CLOEXEC));
+    if (fd < 0) {
+        return false;
+    }
+    worker.fd = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+    close(fd);
+    worker.mapSize = headerSize() + static_cast<size_t>(m_options.slotsPerWorker) * m_options.slotCapacity;
+    if (worker.fd < 0 || ftruncate(worker.fd, static_cast<off_t>(worker.mapSize)) != 0) {
+        return false;
+    }
+    void *mapped = mmap(nullptr, worker.mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, worker.fd, 0);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    //memfd初始全为零，即所有槽都是空闲的
+    worker.header = static_cast<FarmHeader *>(mapped);
+    worker.header->magic = farmMagic;
+    worker.header->slotCount = static_cast<uint32_t>(m_options.slotsPerWorker);
+    worker.header->slotCapacity = m_options.slotCapacity;
+    worker.data = static_cast<char *>(mapped) + headerSize();
+    worker.slotBusy.assign(static_cast<size_t>(m_options.slotsPerWorker), false);
+    return true;
+}
+
+bool WorkerFarm::spawn(Worker &worker)
+{
+    //工作进程各自的线程数按核数平分，避免多个进程争抢同一批核心
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    std::string threads = std::to_string(std::max(1L, cores / m_options.workers));
+    std::vector<std::string> envStrings = {"LINGMO_OCR_THREADS=" + threads, "OMP_NUM_THREADS=" + threads};
+    std::vector<char *> envp;
+    for (std::string &entry : envStrings) {
+        envp.push_back(&entry[0]);
+    }
+    for (char **env = environ; *env; ++env) {
+        if (strncmp(*env, "LINGMO_OCR_THREADS=", 19) != 0 && strncmp(*env, "OMP_NUM_THREADS=", 16) != 0) {
+            envp.push_back(*env);
+        }
+    }
+    envp.push_back(nullptr);
+
+    std::vector<char *> argv;
+    argv.push_back(&m_program[0]);
+    for (std::string &argument : m_arguments) {
+        argv.push_back(&argument[0]);
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, worker.fd, workerFd);
+    pid_t pid = -1;
+    int ret = posix_spawn(&pid, m_program.c_str(), &actions, nullptr, argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    if (ret != 0) {
+        fprintf(stderr, "failed to start ocr worker: %s\n", strerror(ret));
+        return false;
+    }
+    worker.pid = pid;
+    worker.startedMs = monotonicMs();
+    return true;
+}
+
+bool WorkerFarm::start()
+{
+    m_workers.resize(static_cast<size_t>(m_options.workers));
+    for (Worker &worker : m_workers) {
+        if (!createShared(worker) || !spawn(worker)) {
+            return false;
+        }
+    }
+    m_monitor = std::thread(&WorkerFarm::monitorLoop, this);
+    return true;
+}
+
+bool WorkerFarm::recognize(const std::string &image, std::string &text)
+{
+    if (image.size() > m_options.slotCapacity) {
+        return false;
+    }
+
+    //1.选出在途请求最少且有空闲槽的工作进程，正在重启的进程暂不分配
+    Worker *worker = nullptr;
+    size_t slotIndex = 0;
+    uint64_t ticket;
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        m_cond.wait(locker, [&]() {
+            if (m_stopping) {
+                return true;
+            }
+            for (size_t i = 0; i < m_workers.size(); i++) {
+                Worker &candidate = m_workers[(m_nextWorker + i) % m_workers.size()];
+                if (candidate.pid < 0 || (worker && candidate.inFlight >= worker->inFlight)) {
+                    continue;
+                }
+                for (size_t slot = 0; slot < candidate.slotBusy.size(); slot++) {
+                    if (!candidate.slotBusy[slot]) {
+                        worker = &candidate;
+                        slotIndex = slot;
+                        break;
+                    }
+                }
+            }
+            return worker != nullptr;
+        });
+        if (m_stopping) {
+            return false;
+        }
+        worker->slotBusy[slotIndex] = true;
+        ++worker->inFlight;
+        ++m_nextWorker;
+        ticket = ++m_ticket;
+    }
+
+    //2.图片写入共享内存槽，通知工作进程
+    FarmSlot &slot = worker->header->slots[slotIndex];
+    char *data = worker->data + slotIndex * m_options.slotCapacity;
+    memcpy(data, image.data(), image.size());
+    slot.size = image.size();
+    slot.ticket = ticket;
+    slot.state.store(SlotRequest, std::memory_order_release);
+    worker->header->doorbell.fetch_add(1, std::memory_order_release);
+    futexWake(&worker->header->doorbell);
+
+    //3.等待结果，工作进程退出时由监视线程把槽置为失败
+    //排队也计入超时：工作进程启动即崩溃（模型缺失、损坏或无法执行）时会被反复重启，请求永远不会被取走
+    long long queuedMs = monotonicMs();
+    uint32_t state;
+    while ((state = slot.state.load(std::memory_order_acquire)) != SlotDone && state != SlotFailed) {
+        if (state == SlotRequest && monotonicMs() - queuedMs > m_options.requestTimeoutMs) {
+            //与工作进程取走请求竞争，只有一方能改掉SlotRequest
+            uint32_t expected = SlotRequest;
+            if (slot.state.compare_exchange_strong(expected, SlotFailed)) {
+                fprintf(stderr, "ocr request was not picked up by a worker in time\n");
+                state = SlotFailed;
+                break;
+            }
+            continue;
+        }
+        futexWait(&slot.state, state, 100);
+    }
+    bool ok = state == SlotDone;
+    if (ok) {
+        text.assign(data, static_cast<size_t>(slot.size));
+    }
+    slot.state.store(SlotFree, std::memory_order_release);
+
+    std::lock_guard<std::mutex> locker(m_mutex);
+    worker->slotBusy[slotIndex] = false;
+    --worker->inFlight;
+    m_cond.notify_all();
+    return ok;
+}
+
+std::vector<std::string> WorkerFarm::reports()
+{
+    std::vector<std::string> result;
+    std::lock_guard<std::mutex> locker(m_mutex);
+    for (Worker &worker : m_workers) {
+        std::string report;
+        if (worker.pid > 0 && readReport(worker.header->report, report)) {
+            result.push_back(report);
+        }
+    }
+    return result;
+}
+
+void WorkerFarm::monitorLoop()
+{
+    std::unique_lock<std::mutex> locker(m_mutex);
+    while (!m_stopping) {
+        long long now = monotonicMs();
+        for (Worker &worker : m_workers) {
+            //频繁崩溃时至少间隔一秒再重启，避免空转
+            if (worker.pid < 0) {
+                if (now - worker.startedMs >= 1000 && spawn(worker)) {
+                    ++m_restarts;
+                    m_cond.notify_all();
+                }
+                continue;
+            }
+
+            int status = 0;
+            if (waitpid(worker.pid, &status, WNOHANG) == worker.pid) {
+                fprintf(stderr, "ocr worker %d exited (status %d), restarting\n", worker.pid, status);
+                handleExit(worker);
+                if (now - worker.startedMs >= 1000 && spawn(worker)) {
+                    ++m_restarts;
+                    m_cond.notify_all();
+                }
+                continue;
+            }
+
+            //单张图片识别过久视为卡死，强制结束后按崩溃处理
+            for (uint32_t i = 0; i < worker.header->slotCount; i++) {
+                FarmSlot &slot = worker.header->slots[i];
+                if (slot.state.load(std::memory_order_acquire) == SlotRunning
+                        && now - slot.startedMs.load() > m_options.requestTimeoutMs) {
+                    fprintf(stderr, "ocr worker %d timed out, killing\n", worker.pid);
+                    kill(worker.pid, SIGKILL);
+                    break;
+                }
+            }
+        }
+        m_cond.wait_for(locker, std::chrono::milliseconds(100));
+    }
+}
+
+void WorkerFarm::handleExit(Worker &worker)
+{
+    //最后一次上报交给主进程累计，再清空，免得在新进程上报之前被重复计入
+    std::string report;
+    if (readReport(worker.header->report, report) && m_options.reportRetired) {
+        m_options.reportRetired(report);
+    }
+    writeReport(worker.header->report, std::string());
+
+    //正在识别的图片判定为失败；还没取走的请求留给重启后的进程
+    worker.pid = -1;
+    for (uint32_t i = 0; i < worker.header->slotCount; i++) {
+        FarmSlot &slot = worker.header->slots[i];
+        uint32_t expected = SlotRunning;
+        if (slot.state.compare_exchange_strong(expected, SlotFailed)) {
+            futexWake(&slot.state);
+        }
+    }
+}
+
+int WorkerFarm::runWorker(int fd, const RecognizeFunc &recognize, const ReportFunc &report)
+{
+    //主进程退出时随之退出
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() == 1) {
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < headerSize()) {
+        return 1;
+    }
+    size_t mapSize = static_cast<size_t>(st.st_size);
+    void *mapped = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        return 1;
+    }
+    FarmHeader *header = static_cast<FarmHeader *>(mapped);
+    if (header->magic != farmMagic || header->slotCount > maxSlots
+            || headerSize() + header->slotCount * header->slotCapacity > mapSize) {
+        return 1;
+    }
+    char *data = static_cast<char *>(mapped) + headerSize();
+    if (report) {
+        writeReport(header->report, report());
+    }
+
+    for (;;) {
+        //先记下门铃再查找请求，查找之后到达的请求会改变门铃，futex不会睡过去
+        uint32_t doorbell = header->doorbell.load(std::memory_order_acquire);
+        int next = -1;
+        for (uint32_t i = 0; i < header->slotCount; i++) {
+            if (header->slots[i].state.load(std::memory_order_acquire) == SlotRequest
+                    && (next < 0 || header->slots[i].ticket < header->slots[next].ticket)) {
+                next = static_cast<int>(i);
+            }
+        }
+        if (next < 0) {
+            futexWait(&header->doorbell, doorbell, 1000);
+            continue;
+        }
+
+        //主进程可能刚好因排队超时放弃了这个请求
+        FarmSlot &slot = header->slots[next];
+        char *slotData = data + static_cast<size_t>(next) * header->slotCapacity;
+        slot.startedMs = monotonicMs();
+        uint32_t expected = SlotRequest;
+        if (!slot.state.compare_exchange_strong(expected, SlotRunning, std::memory_order_acq_rel)) {
+            continue;
+        }
+
+        std::string image(slotData, static_cast<size_t>(slot.size));
+        std::string text;
+        bool ok = recognize(image, text);
+        if (ok) {
+            size_t size = std::min(text.size(), static_cast<size_t>(header->slotCapacity));
+            memcpy(slotData, text.data(), size);
+            slot.size = size;
+        }
+        //先上报再交回结果，主进程拿到结果时指标已经包含了这次识别
+        if (report) {
+            writeReport(header->report, report());
+        }
+        slot.state.store(ok ? SlotDone : SlotFailed, std::memory_order_release);
+        futexWake(&slot.state);
+    }
+}
@@ -0,0 +1,111 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef WORKERFARM_H
+#define WORKERFARM_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FarmHeader;
+
+//多进程识别的可选项
+struct WorkerFarmOptions {
+    int workers = 2;                       //工作进程数
+    int slotsPerWorker = 2;                //每个工作进程的共享内存槽数，一个在识别时另一个可以提前写入下一张图片
+    size_t slotCapacity = 32 * 1024 * 1024;//每个槽的容量，决定了单张图片的大小上限
+    int requestTimeoutMs = 120000;         //单张图片识别超过该时间即认为工作进程卡死，强制重启；排队超过该时间的请求判定为失败
+    std::function<void(const std::string &report)> reportRetired; //工作进程退出时交出它最后一次上报的内容，在监视线程中调用
+};
+
+/*
+ * @bref: WorkerFarm 多进程识别：主进程负责分发，N个工作进程各自加载引擎执行识别
+ * 图片和结果经由每个工作进程独占的共享内存槽环传递，状态字用futex通知，不经过管道拷贝
+ * 工作进程崩溃或卡死时只有正在识别的那张图片失败，主进程立即拉起新的工作进程，排队的图片由新进程继续处理
+ * 工作进程是重新执行的本程序（--farm-worker），模型权重直接私有映射模型文件，多个进程共享同一份页缓存，
+ * 因此模型文件只能以改名的方式整体替换，不能原地改写
+*/
+class WorkerFarm
+{
+public:
+    typedef std::function<bool(const std::string &image, std::string &text)> RecognizeFunc;
+    //工作进程上报的内容，例如运行指标，主进程不解析
+    typedef std::function<std::string()> ReportFunc;
+
+    //program/arguments: 工作进程的启动命令，共享内存固定以3号描述符传入
+    WorkerFarm(const std::string &program, const std::vector<std::string> &arguments,
+               const WorkerFarmOptions &options = WorkerFarmOptions());
+    ~WorkerFarm();
+
+    //启动所有工作进程
+    bool start();
+
+    //交给负载最低的工作进程识别，图片过大、无法解码或工作进程崩溃时返回false
+    bool recognize(const std::string &image, std::string &text);
+
+    //各个运行中的工作进程最近一次上报的内容
+    std::vector<std::string> reports();
+
+    //工作进程入口：在fd对应的共享内存上循环处理请求，不会返回
+    //report不为空时在启动后和每张图片识别完成后上报一次
+    static int runWorker(int fd, const RecognizeFunc &recognize, const ReportFunc &report = ReportFunc());
+
+    unsigned long long restarts() const
+    {
+        return m_restarts;
+    }
+
+private:
+    struct Worker {
+        pid_t pid = -1;
+        int fd = -1;
+        FarmHeader *header = nullptr;
+        char *data = nullptr;
+        size_t mapSize = 0;
+        int inFlight = 0;
+        std::vector<bool> slotBusy;
+        long long startedMs = 0; //最近一次启动的时间，频繁崩溃时推迟重启
+    };
+
+    bool createShared(Worker &worker);
+    bool spawn(Worker &worker);
+    void monitorLoop();
+    void handleExit(Worker &worker);
+
+    std::string m_program;
+    std::vector<std::string> m_arguments;
+    WorkerFarmOptions m_options;
+    std::vector<Worker> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    uint64_t m_ticket;
+    size_t m_nextWorker; //负载相同时轮流选择
+    bool m_stopping;
+    std::thread m_monitor;
+    std::atomic<unsigned long long> m_restarts;
+};
+
+#endif // WORKERFARM_H
@@ -0,0 +1,230 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include <ftw.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "batchrunner.h"
+
+//识别结果即图片内容，每次识别在日志里记一行，用来检查是否重复处理
+static BatchRunner::RecognizeFunc loggingRecognize(const std::string &log)
+{
+    return [log](const std::string &image, std::string &text) {
+        if (image == "bad") {
+            return false;
+        }
+        text = image;
+        std::ofstream(log, std::ios::app) << image << "\n";
+        return true;
+    };
+}
+
+static std::string readAll(const std::string &path)
+{
+    std::ifstream file(path);
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+//在临时目录下生成count张"图片"和清单，返回清单路径
+static std::string makeManifest(const std::string &dir, int count)
+{
+    std::ofstream manifest(dir + "/manifest.txt");
+    for (int i = 0; i < count; ++i) {
+        std::string name = "img" + std::to_string(i) + ".png";
+        std::ofstream(dir + "/" + name) << "image-" << i;
+        manifest << name << "\n";
+    }
+    return dir + "/manifest.txt";
+}
+
+static std::string expectedResult(int count)
+{
+    std::string result;
+    for (int i = 0; i < count; ++i) {
+        result += "{\"path\":\"img" + std::to_string(i) + ".png\",\"text\":\"image-" + std::to_string(i) + "\"}\n";
+    }
+    return result;
+}
+
+static int removeEntry(const char *path, const struct stat *, int, struct FTW *)
+{
+    return remove(path);
+}
+
+//每个用例使用单独的临时目录，结束后连同工作目录一起删除
+class BatchRunnerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char path[] = "/tmp/lingmo-ocr-batch-XXXXXX";
+        ASSERT_NE(mkdtemp(path), nullptr);
+        dir = path;
+    }
+
+    void TearDown() override
+    {
+        if (!dir.empty()) {
+            nftw(dir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+        }
+    }
+
+    std::string dir;
+};
+
+//用多个进程模拟多个节点从同一个清单领取任务
+TEST_F(BatchRunnerTest, ClaimsEveryChunkOnceAcrossProcesses)
+{
+    const int count = 103;
+    std::string manifest = makeManifest(dir, count);
+
+    const int nodes = 4;
+    for (int node = 0; node < nodes; ++node) {
+        pid_t pid = fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0) {
+            BatchOptions options;
+            options.manifest = manifest;
+            options.chunkSize = 7;
+            BatchRunner runner(options, loggingRecognize(dir + "/log" + std::to_string(node)));
+            _exit(runner.run() >= 0 ? 0 : 1);
+        }
+    }
+    for (int node = 0; node < nodes; ++node) {
+        int status = 0;
+        wait(&status);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    std::multiset<std::string> seen;
+    for (int node = 0; node < nodes; ++node) {
+        std::istringstream log(readAll(dir + "/log" + std::to_string(node)));
+        std::string line;
+        while (std::getline(log, line)) {
+            seen.insert(line);
+        }
+    }
+    EXPECT_EQ(seen.size(), static_cast<size_t>(count));
+    EXPECT_EQ(std::set<std::string>(seen.begin(), seen.end()).size(), static_cast<size_t>(count));
+
+    BatchOptions options;
+    options.manifest = manifest;
+    options.chunkSize = 7;
+    BatchRunner runner(options, loggingRecognize(dir + "/unused"));
+    ASSERT_TRUE(runner.merge(dir + "/merged.jsonl"));
+    EXPECT_EQ(readAll(dir + "/merged.jsonl"), expectedResult(count));
+}
+
+//静态分片各自处理自己的块，合并结果与单节点一致，重跑不会重复识别
+TEST_F(BatchRunnerTest, StaticShardsMergeAndRerunIdempotently)
+{
+    const int count = 20;
+    std::string manifest = makeManifest(dir, count);
+
+    BatchOptions options;
+    options.manifest = manifest;
+    options.chunkSize = 3;
+    options.shardCount = 3;
+    BatchRunner first(options, loggingRecognize(dir + "/log"));
+    EXPECT_FALSE(first.merge(dir + "/merged.jsonl"));
+
+    int chunks = 0;
+    for (int shard = 0; shard < 3; ++shard) {
+        options.shardIndex = shard;
+        BatchRunner runner(options, loggingRecognize(dir + "/log"));
+        chunks += runner.run();
+    }
+    EXPECT_EQ(chunks, 7);
+
+    options.shardIndex = 1;
+    BatchRunner rerun(options, loggingRecognize(dir + "/log"));
+    EXPECT_EQ(rerun.run(), 0);
+    ASSERT_TRUE(rerun.merge(dir + "/merged.jsonl"));
+    EXPECT_EQ(readAll(dir + "/merged.jsonl"), expectedResult(count));
+
+    std::istringstream log(readAll(dir + "/log"));
+    std::string line;
+    int recognized = 0;
+    while (std::getline(log, line)) {
+        ++recognized;
+    }
+    EXPECT_EQ(recognized, count);
+
+    //切块方式与已记录的不一致时拒绝运行
+    options.chunkSize = 4;
+    BatchRunner mismatched(options, loggingRecognize(dir + "/log"));
+    EXPECT_EQ(mismatched.run(), -1);
+}
+
+//清单条数不变但顺序变了，结果也会错位，同样拒绝运行
+TEST_F(BatchRunnerTest, RejectsReorderedManifest)
+{
+    std::string manifest = makeManifest(dir, 6);
+
+    BatchOptions options;
+    options.manifest = manifest;
+    options.chunkSize = 2;
+    options.shardIndex = 0;
+    options.shardCount = 3;
+    BatchRunner first(options, loggingRecognize(dir + "/log"));
+    EXPECT_EQ(first.run(), 1);
+
+    std::ofstream(manifest) << "img1.png\nimg0.png\nimg2.png\nimg3.png\nimg4.png\nimg5.png\n";
+    options.shardIndex = 1;
+    BatchRunner reordered(options, loggingRecognize(dir + "/log"));
+    EXPECT_EQ(reordered.run(), -1);
+}
+
+//失效节点留下的认领会被接管，识别失败的图片记录错误
+TEST_F(BatchRunnerTest, TakesOverStaleClaims)
+{
+    std::string manifest = makeManifest(dir, 4);
+    std::ofstream(dir + "/img2.png") << "bad";
+
+    BatchOptions options;
+    options.manifest = manifest;
+    options.chunkSize = 2;
+    options.staleSeconds = 60;
+    BatchRunner runner(options, loggingRecognize(dir + "/log"));
+
+    std::string claims = runner.workDir() + "/claims";
+    mkdir(runner.workDir().c_str(), 0755);
+    mkdir(claims.c_str(), 0755);
+    std::ofstream(claims + "/00000001") << "lost-node\n";
+    struct utimbuf old = {time(nullptr) - 120, time(nullptr) - 120};
+    utime((claims + "/00000001").c_str(), &old);
+
+    EXPECT_EQ(runner.run(), 2);
+    ASSERT_TRUE(runner.merge(dir + "/merged.jsonl"));
+    EXPECT_EQ(readAll(dir + "/merged.jsonl"),
+              "{\"path\":\"img0.png\",\"text\":\"image-0\"}\n"
+              "{\"path\":\"img1.png\",\"text\":\"image-1\"}\n"
+              "{\"path\":\"img2.png\",\"error\":\"recognition failed\"}\n"
+              "{\"path\":\"img3.png\",\"text\":\"image-3\"}\n");
+}
@@ -0,0 +1,98 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "chardict.h"
+#include "ctcdecoder.h"
+
+//0号为空白占位符
+static std::unique_ptr<CharDict> testDict()
+{
+    return std::unique_ptr<CharDict>(CharDict::fromEntries({"#", "a", "b", "1", "7", "l", " "}));
+}
+
+//把每个时间步的概率转成topK候选
+static std::vector<CtcCandidate> framesOf(const std::vector<std::vector<float>> &rows, int topK)
+{
+    std::vector<CtcCandidate> candidates(rows.size() * static_cast<size_t>(topK));
+    for (size_t t = 0; t < rows.size(); t++) {
+        ctcTopK(rows[t].data(), static_cast<int>(rows[t].size()), topK, candidates.data() + t * static_cast<size_t>(topK));
+    }
+    return candidates;
+}
+
+TEST(CtcDecoder, topKKeepsOrder)
+{
+    float row[] = {0.1f, 0.4f, 0.05f, 0.4f, 0.05f};
+    CtcCandidate out[3];
+    ctcTopK(row, 5, 3, out);
+    EXPECT_EQ(out[0].label, 1);
+    EXPECT_EQ(out[1].label, 3);
+    EXPECT_EQ(out[2].label, 0);
+}
+
+TEST(CtcDecoder, lexiconCorrectsLookalike)
+{
+    auto dict = testDict();
+    //贪心结果是"a1"，但第二个字也可能是"l"，词表只允许"al"
+    std::vector<std::vector<float>> rows = {
+        {0.05f, 0.9f, 0.01f, 0.01f, 0.01f, 0.01f, 0.01f},
+        {0.9f, 0.02f, 0.02f, 0.02f, 0.02f, 0.01f, 0.01f},
+        {0.05f, 0.01f, 0.01f, 0.5f, 0.03f, 0.4f, 0.0f},
+    };
+    CtcLexicon lexicon({"al", "bb"}, *dict);
+    EXPECT_EQ(lexicon.entryCount(), 2u);
+
+    std::string text;
+    ASSERT_TRUE(ctcBeamDecode(framesOf(rows, 3), 3, lexicon, *dict, CtcBeamOptions(), text));
+    EXPECT_EQ(text, "al");
+}
+
+TEST(CtcDecoder, characterClassAndRepeats)
+{
+    auto dict = testDict();
+    //"1 空白 1 7"：空白隔开的重复字算两个字
+    std::vector<std::vector<float>> rows = {
+        {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f},
+        {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+        {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f},
+        {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f},
+        {0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f},
+    };
+    CtcLexicon lexicon({"\\d\\d\\d", "[ab]"}, *dict);
+
+    std::string text;
+    ASSERT_TRUE(ctcBeamDecode(framesOf(rows, 2), 2, lexicon, *dict, CtcBeamOptions(), text));
+    EXPECT_EQ(text, "117");
+}
+
+TEST(CtcDecoder, unmatchedFallsBack)
+{
+    auto dict = testDict();
+    std::vector<std::vector<float>> rows = {
+        {0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+    };
+    //字典中没有的字使该项被跳过
+    CtcLexicon lexicon({"b", "x"}, *dict);
+    EXPECT_EQ(lexicon.entryCount(), 1u);
+
+    std::string text = "a";
+    EXPECT_FALSE(ctcBeamDecode(framesOf(rows, 2), 2, lexicon, *dict, CtcBeamOptions(), text));
+    EXPECT_EQ(text, "a");
+}
@@ -0,0 +1,190 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <opencv2/imgproc.hpp>
+
+#include "chardict.h"
+#include "details.h"
+#include "metrics.h"
+
+//源码树中的assets目录，由构建系统传入
+#ifndef TEST_ASSETS_DIR
+#define TEST_ASSETS_DIR "../assets/"
+#endif
+
+//与PaddleOCRApp::loadDict相同：开头插入占位符，末尾插入空格
+static std::shared_ptr<const CharDict> loadDict(const std::string &name)
+{
+    std::vector<std::string> entries;
+    entries.push_back("#");
+    std::ifstream file(std::string(TEST_ASSETS_DIR) + "dict/" + name);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        entries.push_back(line);
+    }
+    entries.push_back(" ");
+    return std::shared_ptr<const CharDict>(CharDict::fromEntries(entries));
+}
+
+static ModelSpec modelSpec(const std::string &name, const std::string &output, float mean[3], float norm[3])
+{
+    ModelSpec spec;
+    spec.paramPath = std::string(TEST_ASSETS_DIR) + "model/" + name + ".param.bin";
+    spec.binPath = std::string(TEST_ASSETS_DIR) + "model/" + name + ".bin";
+    spec.outputBlob = output;
+    std::copy(mean, mean + 3, spec.mean);
+    std::copy(norm, norm + 3, spec.norm);
+    return spec;
+}
+
+//自动模式的引擎：中文主模型 + 拉丁文字模型
+class DetailsRouting : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        float detMean[3] = {123.675f, 116.28f, 103.53f};
+        float detNorm[3] = {0.01712475383f, 0.01750700280f, 0.01742919389f};
+        float recMean[3] = {127.5f, 127.5f, 127.5f};
+        float recNorm[3] = {0.007843137255f, 0.007843137255f, 0.007843137255f};
+
+        details.reset(new Details(modelSpec("det", "137", detMean, detNorm), modelSpec("rec_chi_sim", "78", recMean, recNorm),
+                                  loadDict("dict_chi_sim.txt")));
+        ASSERT_TRUE(details->isReady());
+        ASSERT_TRUE(details->loadLatinRecognizer(modelSpec("rec_eng", "146", recMean, recNorm), loadDict("dict_eng.txt")));
+    }
+
+    std::unique_ptr<Details> details;
+};
+
+//只有拉丁字母的图片：每列只穿过一两次笔画
+static cv::Mat latinImage()
+{
+    cv::Mat image(120, 640, CV_8UC3, cv::Scalar(255, 255, 255));
+    cv::putText(image, "HELLO WORLD", cv::Point(20, 80), cv::FONT_HERSHEY_SIMPLEX, 2.0, cv::Scalar(0, 0, 0), 3);
+    return image;
+}
+
+//只有笔画密集的方块字形的图片：每列穿过四五次笔画，按非拉丁文字处理
+static cv::Mat denseImage()
+{
+    cv::Mat image(120, 640, CV_8UC3, cv::Scalar(255, 255, 255));
+    for (int i = 0; i < 8; ++i) {
+        int x = 20 + i * 70;
+        cv::rectangle(image, cv::Rect(x, 30, 50, 56), cv::Scalar(0, 0, 0), 3);
+        for (int j = 1; j < 4; ++j) {
+            cv::line(image, cv::Point(x, 30 + j * 14), cv::Point(x + 50, 30 + j * 14), cv::Scalar(0, 0, 0), 3);
+        }
+    }
+    return image;
+}
+
+//整批都是拉丁文字时非拉丁组为空，不能交给识别
+TEST_F(DetailsRouting, allLatinBatch)
+{
+    std::vector<std::string> lines = details->run(latinImage());
+    EXPECT_FALSE(lines.empty());
+    EXPECT_GT(details->getStats().latinLines, 0u);
+    EXPECT_EQ(details->getStats().otherLines, 0u);
+}
+
+//整批都是非拉丁文字时拉丁组为空，不能交给识别
+TEST_F(DetailsRouting, allOtherBatch)
+{
+    std::vector<std::string> lines = details->run(denseImage());
+    EXPECT_FALSE(lines.empty());
+    EXPECT_EQ(details->getStats().latinLines, 0u);
+    EXPECT_GT(details->getStats().otherLines, 0u);
+}
+
+//预热等关闭指标的运行不计入请求数、文本行数和耗时
+TEST_F(DetailsRouting, disabledMetricsAreNotRecorded)
+{
+    EngineMetrics::Snapshot before = EngineMetrics::instance()->snapshot();
+    details->setMetricsEnabled(false);
+    EXPECT_FALSE(details->run(latinImage()).empty());
+    details->setMetricsEnabled(true);
+    EngineMetrics::Snapshot after = EngineMetrics::instance()->snapshot();
+
+    EXPECT_EQ(after.counters[EngineMetrics::Requests], before.counters[EngineMetrics::Requests]);
+    EXPECT_EQ(after.counters[EngineMetrics::TextLines], before.counters[EngineMetrics::TextLines]);
+    EXPECT_EQ(after.stages[EngineMetrics::RequestStage].count, before.stages[EngineMetrics::RequestStage].count);
+    EXPECT_EQ(after.stages[EngineMetrics::DetectStage].count, before.stages[EngineMetrics::DetectStage].count);
+
+    EXPECT_FALSE(details->run(latinImage()).empty());
+    EXPECT_EQ(EngineMetrics::instance()->snapshot().counters[EngineMetrics::Requests], before.counters[EngineMetrics::Requests] + 1);
+}
+
+//整页空白时跳过检测；关闭内容区域查找后整页作为一个区域检测
+TEST_F(DetailsRouting, inkRegionsOption)
+{
+    cv::Mat blank(120, 640, CV_8UC3, cv::Scalar(255, 255, 255));
+    EXPECT_TRUE(details->run(blank).empty());
+    EXPECT_EQ(details->getStats().inkBlankPages, 1u);
+    EXPECT_EQ(details->getStats().inkRegions, 0u);
+
+    EXPECT_FALSE(details->run(latinImage()).empty());
+    EXPECT_GE(details->getStats().inkRegions, 1u);
+
+    DetailsOptions options = details->getOptions();
+    options.inkRegions = false;
+    details->setOptions(options);
+    unsigned long long regions = details->getStats().inkRegions;
+    EXPECT_TRUE(details->run(blank).empty());
+    EXPECT_EQ(details->getStats().inkBlankPages, 1u);
+    EXPECT_EQ(details->getStats().inkRegions, regions + 1);
+}
+
+//运行中从文件加载词表，无法打开的文件保持原词表，空路径恢复贪心解码
+TEST_F(DetailsRouting, loadLexiconAtRuntime)
+{
+    std::string path = testing::TempDir() + "details_lexicon.txt";
+    {
+        std::ofstream file(path);
+        file << "HELLO WORLD\r\n\nGOODBYE\n";
+    }
+    auto constrained = [this]() {
+        return details->getStats().lexiconMatched + details->getStats().lexiconFallbacks;
+    };
+
+    EXPECT_FALSE(details->run(latinImage()).empty());
+    EXPECT_EQ(constrained(), 0u);
+
+    ASSERT_TRUE(details->loadLexicon(path));
+    EXPECT_FALSE(details->run(latinImage()).empty());
+    unsigned long long lines = constrained();
+    EXPECT_GT(lines, 0u);
+
+    EXPECT_FALSE(details->loadLexicon(path + ".missing"));
+    EXPECT_FALSE(details->run(latinImage()).empty());
+    EXPECT_GT(constrained(), lines);
+
+    lines = constrained();
+    EXPECT_TRUE(details->loadLexicon(""));
+    EXPECT_FALSE(details->run(latinImage()).empty());
+    EXPECT_EQ(constrained(), lines);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,274 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "httpserver.h"
+
+//识别结果为图片内容的长度和首字节，内容为"bad"时视为无法解码
+static bool fakeRecognize(const std::string &image, std::string &text)
+{
+    if (image == "bad") {
+        return false;
+    }
+    text = std::to_string(image.size()) + "\n" + image.substr(0, 1) + "\n";
+    return true;
+}
+
+static int connectUnix(const std::string &path)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int connectTcp(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+//分成很小的片段发送，检验服务端的流式解析
+static void sendPieces(int fd, const std::string &data, size_t piece)
+{
+    for (size_t pos = 0; pos < data.size(); pos += piece) {
+        size_t size = std::min(piece, data.size() - pos);
+        ASSERT_EQ(send(fd, data.data() + pos, size, MSG_NOSIGNAL), static_cast<ssize_t>(size));
+    }
+}
+
+//读取一个完整的响应，返回状态码，body为响应体
+static int readResponse(int fd, std::string &pending, std::string &body)
+{
+    size_t headerEnd;
+    char chunk[4096];
+    while ((headerEnd = pending.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t size = recv(fd, chunk, sizeof(chunk), 0);
+        if (size <= 0) {
+            return -1;
+        }
+        pending.append(chunk, static_cast<size_t>(size));
+    }
+    int status = atoi(pending.c_str() + 9);
+    size_t lengthPos = pending.find("Content-Length: ");
+    size_t length = lengthPos < headerEnd ? strtoul(pending.c_str() + lengthPos + 16, nullptr, 10) : 0;
+    while (pending.size() < headerEnd + 4 + length) {
+        ssize_t size = recv(fd, chunk, sizeof(chunk), 0);
+        if (size <= 0) {
+            return -1;
+        }
+        pending.append(chunk, static_cast<size_t>(size));
+    }
+    body = pending.substr(headerEnd + 4, length);
+    pending.erase(0, headerEnd + 4 + length);
+    return status;
+}
+
+TEST(OcrHttpServer, keepAliveOverUnixSocket)
+{
+    std::string path = "/tmp/lingmo-ocr-test-" + std::to_string(getpid()) + ".sock";
+    OcrHttpServer server(fakeRecognize);
+    ASSERT_TRUE(server.listenUnix(path));
+
+    int fd = connectUnix(path);
+    ASSERT_GE(fd, 0);
+    std::string pending;
+    std::string body;
+
+    sendPieces(fd, "GET /v1/health HTTP/1.1\r\nHost: x\r\n\r\n", 1024);
+    EXPECT_EQ(readResponse(fd, pending, body), 200);
+    EXPECT_EQ(body, "{\"status\":\"ok\"}");
+
+    //同一连接上的第二个请求：原始图片作为请求体
+    sendPieces(fd, "POST /v1/ocr HTTP/1.1\r\nContent-Type: image/png\r\nContent-Length: 5\r\n\r\nabcde", 1024);
+    EXPECT_EQ(readResponse(fd, pending, body), 200);
+    EXPECT_EQ(body, "{\"text\":\"5\\na\\n\",\"lines\":[\"5\",\"a\"]}");
+
+    sendPieces(fd, "POST /v1/ocr HTTP/1.1\r\nContent-Length: 3\r\n\r\nbad", 1024);
+    EXPECT_EQ(readResponse(fd, pending, body), 422);
+
+    close(fd);
+    server.stop();
+    EXPECT_NE(access(path.c_str(), F_OK), 0);
+}
+
+TEST(OcrHttpServer, chunkedMultipartUpload)
+{
+    OcrHttpServer server(fakeRecognize);
+    ASSERT_TRUE(server.listenTcp("127.0.0.1", 0));
+    ASSERT_GT(server.port(), 0);
+
+    //文件内容中带有与分隔符相似的片段
+    std::string file = "Z\r\n--bound\r\nnot a delimiter";
+    std::string multipart = "--XyZbound\r\n"
+                            "Content-Disposition: form-data; name=\"lang\"\r\n\r\n"
+                            "chi_sim\r\n"
+                            "--XyZbound\r\n"
+                            "Content-Disposition: form-data; name=\"upload\"; filename=\"a.png\"\r\n"
+                            "Content-Type: image/png\r\n\r\n"
+                            + file + "\r\n--XyZbound--\r\n";
+    std::string request = "POST /v1/ocr HTTP/1.1\r\n"
+                          "Content-Type: multipart/form-data; boundary=XyZbound\r\n"
+                          "Transfer-Encoding: chunked\r\n\r\n";
+    for (size_t pos = 0; pos < multipart.size(); pos += 10) {
+        std::string piece = multipart.substr(pos, 10);
+        char size[16];
+        snprintf(size, sizeof(size), "%zx\r\n", piece.size());
+        request += size + piece + "\r\n";
+    }
+    request += "0\r\n\r\n";
+
+    int fd = connectTcp(server.port());
+    ASSERT_GE(fd, 0);
+    sendPieces(fd, request, 7);
+    std::string pending;
+    std::string body;
+    EXPECT_EQ(readResponse(fd, pending, body), 200);
+    EXPECT_EQ(body, "{\"text\":\"" + std::to_string(file.size()) + "\\nZ\\n\",\"lines\":[\"" + std::to_string(file.size()) + "\",\"Z\"]}");
+    close(fd);
+}
+
+TEST(OcrHttpServer, rejectsBadRequests)
+{
+    OcrHttpServerOptions options;
+    options.maxBodySize = 16;
+    OcrHttpServer server(fakeRecognize, options);
+    ASSERT_TRUE(server.listenTcp("127.0.0.1", 0));
+
+    int fd = connectTcp(server.port());
+    ASSERT_GE(fd, 0);
+    std::string pending;
+    std::string body;
+    sendPieces(fd, "GET /nothing HTTP/1.1\r\n\r\n", 1024);
+    EXPECT_EQ(readResponse(fd, pending, body), 404);
+    sendPieces(fd, "GET /v1/ocr HTTP/1.1\r\n\r\n", 1024);
+    EXPECT_EQ(readResponse(fd, pending, body), 405);
+    sendPieces(fd, "POST /v1/ocr HTTP/1.1\r\nContent-Length: 100\r\n\r\n", 1024);
+    EXPECT_EQ(readResponse(fd, pending, body), 413);
+    close(fd);
+}
+
+TEST(OcrHttpServer, metricsEndpoint)
+{
+    //未设置指标来源时没有/metrics
+    OcrHttpServer plain(fakeRecognize);
+    ASSERT_TRUE(plain.listenTcp("127.0.0.1", 0));
+    int fd = connectTcp(plain.port());
+    ASSERT_GE(fd, 0);
+    std::string pending;
+    std::string body;
+    sendPieces(fd, "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n", 1024);
+    EXPECT_EQ(readResponse(fd, pending, body), 404);
+    close(fd);
+    plain.stop();
+
+    OcrHttpServerOptions options;
+    options.metrics = []() {
+        return std::string("lingmo_ocr_requests_total 7\n");
+    };
+    OcrHttpServer server(fakeRecognize, options);
+    ASSERT_TRUE(server.listenTcp("127.0.0.1", 0));
+    fd = connectTcp(server.port());
+    ASSERT_GE(fd, 0);
+    pending.clear();
+    sendPieces(fd, "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n", 1024);
+    EXPECT_EQ(readResponse(fd, pending, body), 200);
+    EXPECT_EQ(body, "lingmo_ocr_requests_total 7\n");
+    close(fd);
+    server.stop();
+}
+
+//同时识别的请求数达到上限后，后来的请求排队，排队超时返回503
+TEST(OcrHttpServer, admissionLimit)
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool release = false;
+    int running = 0;
+    OcrHttpServerOptions options;
+    options.maxRecognitions = 1;
+    options.admissionTimeoutMs = 200;
+    OcrHttpServer server([&](const std::string &image, std::string &text) {
+        std::unique_lock<std::mutex> locker(mutex);
+        ++running;
+        cond.notify_all();
+        cond.wait(locker, [&]() {
+            return release;
+        });
+        text = image;
+        return true;
+    }, options);
+    ASSERT_TRUE(server.listenTcp("127.0.0.1", 0));
+
+    std::string request = "POST /v1/ocr HTTP/1.1\r\nContent-Length: 1\r\n\r\nx";
+    int first = connectTcp(server.port());
+    ASSERT_GE(first, 0);
+    sendPieces(first, request, 1024);
+    {
+        std::unique_lock<std::mutex> locker(mutex);
+        cond.wait(locker, [&]() {
+            return running == 1;
+        });
+    }
+
+    int second = connectTcp(server.port());
+    ASSERT_GE(second, 0);
+    sendPieces(second, request, 1024);
+    std::string pending;
+    std::string body;
+    EXPECT_EQ(readResponse(second, pending, body), 503);
+
+    {
+        std::lock_guard<std::mutex> locker(mutex);
+        release = true;
+    }
+    cond.notify_all();
+    std::string firstPending;
+    EXPECT_EQ(readResponse(first, firstPending, body), 200);
+
+    //名额释放后同一连接上的请求可以识别
+    sendPieces(second, request, 1024);
+    EXPECT_EQ(readResponse(second, pending, body), 200);
+    EXPECT_EQ(running, 2);
+    close(first);
+    close(second);
+}
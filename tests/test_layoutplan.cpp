@@ -0,0 +1,83 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "layoutplan.h"
+
+// ncnn
+#include "net.h"
+
+//ReLU把不打包的输入转换成打包布局计算，后面的Squeeze只接受不打包的输入，每次推理都要来回转换两次
+static const char *RELU_SQUEEZE_PARAM =
+    "7767517\n"
+    "3 3\n"
+    "Input in0 0 1 in0\n"
+    "ReLU relu 1 1 in0 act\n"
+    "Squeeze squeeze 1 1 act out 1=1\n";
+
+static ncnn::Mat runNet(ncnn::Net &net, const ncnn::Mat &in)
+{
+    ncnn::Extractor ex = net.create_extractor();
+    ex.input("in0", in);
+    ncnn::Mat out;
+    ex.extract("out", out);
+    return out.clone();
+}
+
+TEST(LayoutPlan, removesConversionBeforePack1Layer)
+{
+    ncnn::Mat in(5, 1, 16);
+    for (int i = 0; i < static_cast<int>(in.total()); i++) {
+        in[i] = std::sin(i * 0.7f);
+    }
+
+    ncnn::Net net;
+    net.opt.use_packing_layout = true;
+    net.opt.num_threads = 1;
+    ASSERT_EQ(net.load_param_mem(RELU_SQUEEZE_PARAM), 0);
+    ncnn::Mat expected = runNet(net, in);
+
+    LayoutReport report = planLayout(&net, 0, 2, in);
+    EXPECT_GT(report.bytesBefore, 0u);
+    EXPECT_EQ(report.conversionsBefore, 2);
+    EXPECT_EQ(report.bytesAfter, 0u);
+    EXPECT_EQ(report.conversionsAfter, 0);
+    EXPECT_EQ(report.changedLayers, 1);
+    EXPECT_EQ(measureLayoutConversion(&net, 0, 2, in), 0u);
+
+    ncnn::Mat actual = runNet(net, in);
+    ASSERT_EQ(actual.w, expected.w);
+    ASSERT_EQ(actual.h, expected.h);
+    for (int i = 0; i < static_cast<int>(expected.total()); i++) {
+        EXPECT_EQ(actual[i], expected[i]);
+    }
+}
+
+TEST(LayoutPlan, keepsLayoutWithoutPacking)
+{
+    ncnn::Net net;
+    net.opt.use_packing_layout = false;
+    net.opt.num_threads = 1;
+    ASSERT_EQ(net.load_param_mem(RELU_SQUEEZE_PARAM), 0);
+
+    LayoutReport report = planLayout(&net, 0, 2, ncnn::Mat(5, 1, 16));
+    EXPECT_EQ(report.bytesBefore, 0u);
+    EXPECT_EQ(report.changedLayers, 0);
+}
@@ -0,0 +1,145 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+TEST(EngineMetrics, mergesThreadShards)
+{
+    //指标是进程共用的，只比较前后的差值
+    EngineMetrics *metrics = EngineMetrics::instance();
+    EngineMetrics::Snapshot before = metrics->snapshot();
+
+    //工作线程读取前都已退出，分片并入汇总；主线程的分片仍在使用，两部分都要计入
+    const int threads = 8;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([metrics]() {
+            for (int i = 0; i < 1000; i++) {
+                metrics->add(EngineMetrics::TextLines);
+            }
+            metrics->add(EngineMetrics::RequestsInFlight, 1);
+            metrics->add(EngineMetrics::RequestsInFlight, -1);
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    metrics->add(EngineMetrics::TextLines, 5);
+
+    EngineMetrics::Snapshot after = metrics->snapshot();
+    EXPECT_EQ(after.counters[EngineMetrics::TextLines] - before.counters[EngineMetrics::TextLines], threads * 1000 + 5);
+    EXPECT_EQ(after.counters[EngineMetrics::RequestsInFlight], before.counters[EngineMetrics::RequestsInFlight]);
+}
+
+TEST(EngineMetrics, histogramQuantiles)
+{
+    EngineMetrics::Histogram histogram;
+    EXPECT_EQ(histogram.quantileMs(0.5), 0);
+
+    //10个落在(50,100]毫秒，10个落在(100,200]毫秒
+    histogram.buckets[6] = 10;
+    histogram.buckets[7] = 10;
+    histogram.count = 20;
+    EXPECT_DOUBLE_EQ(histogram.quantileMs(0.25), 75);
+    EXPECT_DOUBLE_EQ(histogram.quantileMs(0.5), 100);
+    EXPECT_DOUBLE_EQ(histogram.quantileMs(1.0), 200);
+}
+
+TEST(EngineMetrics, prometheusText)
+{
+    EngineMetrics *metrics = EngineMetrics::instance();
+    metrics->observe(EngineMetrics::DetectStage, 30);
+    metrics->setGauge(EngineMetrics::WorkerThreads, 4);
+    metrics->setGauge(EngineMetrics::WatchQueueDepth, 3);
+
+    std::string text = metrics->prometheusText();
+    EXPECT_NE(text.find("# TYPE lingmo_ocr_requests_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("lingmo_ocr_cache_hits_total{cache=\"conv_tune\"} "), std::string::npos);
+    EXPECT_NE(text.find("lingmo_ocr_stage_duration_seconds_bucket{stage=\"detect\",le=\"+Inf\"} "), std::string::npos);
+    EXPECT_NE(text.find("lingmo_ocr_worker_threads 4\n"), std::string::npos);
+    EXPECT_NE(text.find("lingmo_ocr_queue_depth{queue=\"watch\"} 3\n"), std::string::npos);
+    EXPECT_EQ(text.find("# HELP lingmo_ocr_queue_depth"), text.rfind("# HELP lingmo_ocr_queue_depth"));
+    //同名指标的HELP只出现一次
+    EXPECT_EQ(text.find("# HELP lingmo_ocr_cache_hits_total"), text.rfind("# HELP lingmo_ocr_cache_hits_total"));
+}
+
+//多进程识别时工作进程的指标编码后交给主进程合并
+TEST(EngineMetrics, mergesWorkerSnapshots)
+{
+    EngineMetrics::Snapshot worker;
+    worker.counters[EngineMetrics::Requests] = 3;
+    worker.stages[EngineMetrics::DetectStage].buckets[5] = 3;
+    worker.stages[EngineMetrics::DetectStage].count = 3;
+    worker.stages[EngineMetrics::DetectStage].sumMs = 90;
+    worker.gauges[EngineMetrics::ModelBytes] = 1000;
+
+    EngineMetrics::Snapshot decoded;
+    ASSERT_TRUE(EngineMetrics::Snapshot::decode(worker.encode(), decoded));
+    EXPECT_FALSE(EngineMetrics::Snapshot::decode("short", decoded));
+
+    EngineMetrics::Snapshot total;
+    total.merge(decoded);
+    total.merge(decoded);
+    EXPECT_EQ(total.counters[EngineMetrics::Requests], 6);
+    EXPECT_EQ(total.stages[EngineMetrics::DetectStage].count, 6u);
+    EXPECT_DOUBLE_EQ(total.stages[EngineMetrics::DetectStage].sumMs, 180);
+    EXPECT_EQ(total.gauges[EngineMetrics::ModelBytes], 2000);
+
+    //退出的工作进程只并入计数和耗时分布
+    EngineMetrics *metrics = EngineMetrics::instance();
+    EngineMetrics::Snapshot before = metrics->snapshot();
+    metrics->absorb(worker);
+    EngineMetrics::Snapshot after = metrics->snapshot();
+    EXPECT_EQ(after.counters[EngineMetrics::Requests] - before.counters[EngineMetrics::Requests], 3);
+    EXPECT_EQ(after.stages[EngineMetrics::DetectStage].count - before.stages[EngineMetrics::DetectStage].count, 3u);
+    EXPECT_EQ(after.gauges[EngineMetrics::ModelBytes], before.gauges[EngineMetrics::ModelBytes]);
+}
+
+//文本文件整体替换，不留下临时文件
+TEST(EngineMetrics, writeTextFileReplacesAtomically)
+{
+    char dir[] = "/tmp/lingmo-ocr-metrics-XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    std::string path = std::string(dir) + "/ocr.prom";
+    ASSERT_TRUE(EngineMetrics::writeTextFile(path, "old\n"));
+    ASSERT_TRUE(EngineMetrics::writeTextFile(path, "new\n"));
+
+    std::ifstream file(path);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(text, "new\n");
+
+    int entries = 0;
+    DIR *listing = opendir(dir);
+    ASSERT_NE(listing, nullptr);
+    while (struct dirent *entry = readdir(listing)) {
+        entries += entry->d_name[0] != '.';
+    }
+    closedir(listing);
+    EXPECT_EQ(entries, 1);
+    unlink(path.c_str());
+    rmdir(dir);
+}
@@ -0,0 +1,146 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include "neckfusion.h"
+
+// ncnn
+#include "net.h"
+
+//缩小的FPN颈部：一路上采样后与侧向输入相加，另一路上采样后与相加结果拼接
+static std::string neckParam(int resizeType, int binaryOp)
+{
+    return "7767517\n"
+           "7 8\n"
+           "Input in0 0 1 in0\n"
+           "Input in1 0 1 in1\n"
+           "Split sp 1 2 in1 in1a in1b\n"
+           "Interp up1 1 1 in1a up1 0=" + std::to_string(resizeType) + " 1=2.0 2=2.0\n"
+           "BinaryOp add 2 1 in0 up1 sum 0=" + std::to_string(binaryOp) + "\n"
+           "Interp up2 1 1 in1b up2 0=" + std::to_string(resizeType) + " 1=2.0 2=2.0\n"
+           "Concat cat 2 1 up2 sum out 0=0\n";
+}
+
+static ncnn::Mat runNeck(const std::string &param, bool fuse, bool packing, int *fused = nullptr)
+{
+    ncnn::Net net;
+    net.opt.use_packing_layout = packing;
+    net.opt.num_threads = 1;
+    static const unsigned char noWeights[1] = {0};
+    EXPECT_EQ(net.load_param_mem(param.c_str()), 0);
+    net.load_model(noWeights);
+    int count = fuse ? fuseFpnNeck(&net) : 0;
+    if (fused) {
+        *fused = count;
+    }
+
+    ncnn::Mat in0(10, 6, 16);
+    ncnn::Mat in1(5, 3, 16);
+    for (int i = 0; i < static_cast<int>(in0.total()); i++) {
+        in0[i] = std::sin(i * 0.37f);
+    }
+    for (int i = 0; i < static_cast<int>(in1.total()); i++) {
+        in1[i] = std::cos(i * 0.91f);
+    }
+
+    ncnn::Extractor ex = net.create_extractor();
+    ex.input("in0", in0);
+    ex.input("in1", in1);
+    ncnn::Mat out;
+    ex.extract("out", out);
+    return out.clone();
+}
+
+static void expectSame(const ncnn::Mat &a, const ncnn::Mat &b)
+{
+    ASSERT_EQ(a.w, b.w);
+    ASSERT_EQ(a.h, b.h);
+    ASSERT_EQ(a.c, b.c);
+    for (int q = 0; q < a.c; q++) {
+        const float *pa = a.channel(q);
+        const float *pb = b.channel(q);
+        for (int i = 0; i < a.w * a.h; i++) {
+            ASSERT_EQ(pa[i], pb[i]) << "channel " << q << " index " << i;
+        }
+    }
+}
+
+TEST(NeckFusion, fusedMatchesLayers)
+{
+    for (bool packing : {false, true}) {
+        ncnn::Mat expected = runNeck(neckParam(1, 0), false, packing);
+        int fused = 0;
+        ncnn::Mat actual = runNeck(neckParam(1, 0), true, packing, &fused);
+        EXPECT_EQ(fused, 2);
+        EXPECT_EQ(actual.c, 32);
+        expectSame(expected, actual);
+    }
+}
+
+TEST(NeckFusion, skipsOtherOperators)
+{
+    //双线性上采样和相减都不满足融合条件，结果应与原网络一致
+    int fused = -1;
+    ncnn::Mat actual = runNeck(neckParam(2, 1), true, false, &fused);
+    EXPECT_EQ(fused, 0);
+    expectSame(runNeck(neckParam(2, 1), false, false), actual);
+
+    ncnn::Mat mixed = runNeck(neckParam(1, 1), true, false, &fused);
+    EXPECT_EQ(fused, 1); //只有拼接一侧被融合
+    expectSame(runNeck(neckParam(1, 1), false, false), mixed);
+}
+
+TEST(NeckFusion, concatWritesRequestedElempack)
+{
+    //两路pack4输入，一路2倍上采样，按不同的outElempack写出后应与先拼接再重新打包的结果一致
+    ncnn::Option opt;
+    opt.num_threads = 1;
+    std::vector<ncnn::Mat> bottoms = {ncnn::Mat(6, 4, 3, 16u, 4), ncnn::Mat(3, 2, 1, 16u, 4)};
+    for (ncnn::Mat &m : bottoms) {
+        float *ptr = m;
+        for (int i = 0; i < static_cast<int>(m.total() * m.elempack); i++) {
+            ptr[i] = std::sin(i * 0.53f + m.c);
+        }
+    }
+
+    FpnUpsampleFuse fuse;
+    fuse.mode = FpnUpsampleFuse::Concat;
+    fuse.scales = {1, 2};
+    fuse.interps = {nullptr, nullptr};
+
+    std::vector<ncnn::Mat> tops(1);
+    ASSERT_EQ(fuse.forward(bottoms, tops, opt), 0);
+    ASSERT_EQ(tops[0].elempack, 4);
+    const ncnn::Mat concat = tops[0].clone();
+
+    for (int outElempack : {1, 8, 16}) {
+        fuse.outElempack = outElempack;
+        ASSERT_EQ(fuse.forward(bottoms, tops, opt), 0);
+        EXPECT_EQ(tops[0].elempack, outElempack);
+
+        ncnn::Mat expected;
+        ncnn::convert_packing(concat, expected, outElempack, opt);
+        ASSERT_EQ(tops[0].c, expected.c);
+        for (int q = 0; q < expected.c; q++) {
+            EXPECT_EQ(memcmp(tops[0].channel(q).data, expected.channel(q).data, expected.w * expected.h * expected.elemsize), 0) << "outElempack " << outElempack << " channel " << q;
+        }
+    }
+}
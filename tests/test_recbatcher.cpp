@@ -0,0 +1,75 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "recbatcher.h"
+
+//每张图片的识别结果就是它的宽度，方便核对结果是否送回了正确的请求
+static std::vector<std::string> widthsOf(const std::vector<cv::Mat> &images)
+{
+    std::vector<std::string> texts;
+    for (const cv::Mat &image : images) {
+        texts.push_back(std::to_string(image.cols));
+    }
+    return texts;
+}
+
+TEST(RecBatcher, singleRequest)
+{
+    RecBatcher batcher(widthsOf, []() {
+        return 1;
+    }, 16, 1000);
+
+    std::vector<cv::Mat> images = {cv::Mat(1, 3, CV_8UC1), cv::Mat(1, 5, CV_8UC1)};
+    auto texts = batcher.recognize(images);
+    ASSERT_EQ(texts.size(), 2u);
+    EXPECT_EQ(texts[0], "3");
+    EXPECT_EQ(texts[1], "5");
+}
+
+TEST(RecBatcher, concurrentRequestsShareBatches)
+{
+    const int requests = 4;
+    std::atomic_int batches{0};
+    RecBatcher batcher([&batches](const std::vector<cv::Mat> &images) {
+        ++batches;
+        return widthsOf(images);
+    }, []() {
+        return requests;
+    }, 64, 1000);
+
+    std::vector<std::vector<std::string>> results(requests);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < requests; i++) {
+        threads.emplace_back([&batcher, &results, i]() {
+            std::vector<cv::Mat> images(2, cv::Mat(1, i + 1, CV_8UC1));
+            results[static_cast<size_t>(i)] = batcher.recognize(images);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    //所有请求都已提交才发车，因此只需要一批
+    EXPECT_EQ(batches, 1);
+    for (int i = 0; i < requests; i++) {
+        EXPECT_EQ(results[static_cast<size_t>(i)], std::vector<std::string>(2, std::to_string(i + 1)));
+    }
+}
@@ -0,0 +1,140 @@
+/*
+* Copyright (C) 2026 Lingmo OS Team <team@lingmo.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <signal.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "workerfarm.h"
+
+//工作进程就是重新执行的测试程序本身，命令行带上下面的参数时在进入测试之前转去执行假的工作进程
+static const char *fakeWorkerArg = "--fake-farm-worker";
+static const char *brokenWorkerArg = "--fake-farm-broken";
+
+//识别结果是图片内容加前缀；图片为crash时先让请求进入识别中，再模拟崩溃
+static bool fakeRecognize(const std::string &image, std::string &text)
+{
+    if (image == "crash") {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        raise(SIGKILL);
+    }
+    text = "text:" + image;
+    return true;
+}
+
+//上报的是这个工作进程识别成功的次数
+static int recognized = 0;
+
+static bool countingRecognize(const std::string &image, std::string &text)
+{
+    bool ok = fakeRecognize(image, text);
+    recognized += ok;
+    return ok;
+}
+
+static int runFakeWorker()
+{
+    std::ifstream file("/proc/self/cmdline");
+    std::string cmdline((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (cmdline.find(fakeWorkerArg) != std::string::npos) {
+        _exit(WorkerFarm::runWorker(3, countingRecognize, []() {
+            return std::to_string(recognized);
+        }));
+    }
+    //启动即退出，模拟模型缺失导致的反复崩溃
+    if (cmdline.find(brokenWorkerArg) != std::string::npos) {
+        _exit(1);
+    }
+    return 0;
+}
+static int fakeWorker = runFakeWorker();
+
+//识别中的工作进程崩溃：只有正在识别的请求失败，排队的请求由重启的进程完成
+TEST(WorkerFarmTest, CrashFailsOnlyTheRunningSlot)
+{
+    WorkerFarmOptions options;
+    options.workers = 1;
+    options.slotsPerWorker = 2;
+    options.slotCapacity = 4096;
+    WorkerFarm farm("/proc/self/exe", {fakeWorkerArg}, options);
+    ASSERT_TRUE(farm.start());
+
+    std::string text;
+    ASSERT_TRUE(farm.recognize("warm", text));
+    EXPECT_EQ(text, "text:warm");
+
+    bool crashed = true;
+    std::thread running([&]() {
+        std::string result;
+        crashed = !farm.recognize("crash", result);
+    });
+    //等请求进入识别中，再放入第二个请求排队
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::string queuedText;
+    bool queued = farm.recognize("queued", queuedText);
+    running.join();
+
+    EXPECT_TRUE(crashed);
+    EXPECT_TRUE(queued);
+    EXPECT_EQ(queuedText, "text:queued");
+    EXPECT_GE(farm.restarts(), 1u);
+}
+
+//识别完成时上报已经更新；退出的工作进程交出最后一次上报，新进程从头上报
+TEST(WorkerFarmTest, ReportsSurviveWorkerRestart)
+{
+    WorkerFarmOptions options;
+    options.workers = 1;
+    options.slotCapacity = 4096;
+    std::vector<std::string> retired;
+    options.reportRetired = [&retired](const std::string &report) {
+        retired.push_back(report);
+    };
+    WorkerFarm farm("/proc/self/exe", {fakeWorkerArg}, options);
+    ASSERT_TRUE(farm.start());
+
+    std::string text;
+    ASSERT_TRUE(farm.recognize("one", text));
+    ASSERT_TRUE(farm.recognize("two", text));
+    EXPECT_EQ(farm.reports(), std::vector<std::string>{"2"});
+
+    EXPECT_FALSE(farm.recognize("crash", text));
+    ASSERT_TRUE(farm.recognize("three", text));
+    EXPECT_EQ(retired, std::vector<std::string>{"2"});
+    EXPECT_EQ(farm.reports(), std::vector<std::string>{"1"});
+}
+
+//工作进程启动即崩溃时请求不会一直排队，超时后失败
+TEST(WorkerFarmTest, QueuedRequestTimesOutWhenWorkersCannotStart)
+{
+    WorkerFarmOptions options;
+    options.workers = 1;
+    options.slotCapacity = 4096;
+    options.requestTimeoutMs = 500;
+    WorkerFarm farm("/proc/self/exe", {brokenWorkerArg}, options);
+    ASSERT_TRUE(farm.start());
+
+    auto begin = std::chrono::steady_clock::now();
+    std::string text;
+    EXPECT_FALSE(farm.recognize("image", text));
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(5));
+}